@@ -0,0 +1,64 @@
+# Copyright (c) 2016 Andrew Kelley
+# This file is MIT licensed.
+# See http://opensource.org/licenses/MIT
+
+# LLD_FOUND
+# LLD_INCLUDE_DIRS
+# LLD_LIBRARIES
+
+# LLD must be the one built with the LLVM we link against, because its
+# libraries are linked into the same executable and its API changes with
+# every release.
+find_path(LLD_INCLUDE_DIRS NAMES lld/Driver/Driver.h
+    PATHS
+        ${LLVM_INCLUDE_DIR}
+        /usr/lib/llvm-3.7/include
+        /mingw64/include
+    NO_DEFAULT_PATH)
+
+macro(FIND_AND_ADD_LLD_LIB _libname_)
+    string(TOUPPER ${_libname_} _prettylibname_)
+    find_library(LLD_${_prettylibname_}_LIB NAMES ${_libname_}
+        PATHS
+            ${LLVM_LIBDIRS}
+            /usr/lib/llvm-3.7/lib
+            /mingw64/lib
+        NO_DEFAULT_PATH)
+    if(LLD_${_prettylibname_}_LIB)
+        set(LLD_LIBRARIES ${LLD_LIBRARIES} ${LLD_${_prettylibname_}_LIB})
+    endif()
+endmacro(FIND_AND_ADD_LLD_LIB)
+
+# the GNU ld driver and the flavors and targets it pulls in, in link order
+FIND_AND_ADD_LLD_LIB(lldDriver)
+FIND_AND_ADD_LLD_LIB(lldCOFF)
+FIND_AND_ADD_LLD_LIB(lldELF2)
+FIND_AND_ADD_LLD_LIB(lldMachO)
+FIND_AND_ADD_LLD_LIB(lldPECOFF)
+FIND_AND_ADD_LLD_LIB(lldAArch64ELFTarget)
+FIND_AND_ADD_LLD_LIB(lldAMDGPUELFTarget)
+FIND_AND_ADD_LLD_LIB(lldARMELFTarget)
+FIND_AND_ADD_LLD_LIB(lldHexagonELFTarget)
+FIND_AND_ADD_LLD_LIB(lldMipsELFTarget)
+FIND_AND_ADD_LLD_LIB(lldX86ELFTarget)
+FIND_AND_ADD_LLD_LIB(lldX86_64ELFTarget)
+FIND_AND_ADD_LLD_LIB(lldExampleSubTarget)
+FIND_AND_ADD_LLD_LIB(lldELF)
+FIND_AND_ADD_LLD_LIB(lldReaderWriter)
+FIND_AND_ADD_LLD_LIB(lldYAML)
+FIND_AND_ADD_LLD_LIB(lldCore)
+FIND_AND_ADD_LLD_LIB(lldConfig)
+
+if(LLD_INCLUDE_DIRS)
+    # zig calls lld::GnuLdDriver::linkELF, which LLD 3.9 removed
+    file(STRINGS "${LLD_INCLUDE_DIRS}/lld/Driver/Driver.h" LLD_GNU_LD_DRIVER REGEX "class GnuLdDriver")
+    if(NOT LLD_GNU_LD_DRIVER)
+        message(FATAL_ERROR "The LLD in ${LLD_INCLUDE_DIRS} does not match LLVM 3.7. "
+            "ZIG_LLD needs the LLD built with the same LLVM as zig.")
+    endif()
+endif()
+
+include(FindPackageHandleStandardArgs)
+find_package_handle_standard_args(LLD DEFAULT_MSG LLD_LIBRARIES LLD_INCLUDE_DIRS)
+
+mark_as_advanced(LLD_INCLUDE_DIRS LLD_LIBRARIES)
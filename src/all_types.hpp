@@ -15,6 +15,7 @@
 #include "errmsg.hpp"
 #include "bignum.hpp"
 #include "target.hpp"
+#include "timing.hpp"
 
 struct AstNode;
 struct ImportTableEntry;
@@ -28,6 +29,8 @@ struct BuiltinFnEntry;
 struct TypeStructField;
 struct CodeGen;
 struct ConstExprValue;
+struct CacheHash;
+struct ParseHJob;
 
 enum OutType {
     OutTypeUnknown,
@@ -36,6 +39,14 @@ enum OutType {
     OutTypeObj,
 };
 
+// which C macros a c_import translates
+enum CMacros {
+    // those named by the zig code and not declared by anything else
+    CMacrosReferenced,
+    CMacrosNone,
+    CMacrosAll,
+};
+
 struct ConstEnumValue {
     uint64_t tag;
     ConstExprValue *payload;
@@ -182,7 +193,7 @@ enum VisibMod {
 struct AstNodeFnProto {
     ZigList<AstNode *> *directives; // can be null if no directives
     VisibMod visib_mod;
-    Buf name;
+    Buf *name; // interned
     ZigList<AstNode *> params;
     AstNode *return_type;
     bool is_var_args;
@@ -215,7 +226,7 @@ struct AstNodeFnDecl {
 };
 
 struct AstNodeParamDecl {
-    Buf name;
+    Buf *name; // interned
     AstNode *type;
     bool is_noalias;
 
@@ -263,7 +274,7 @@ struct AstNodeDefer {
 };
 
 struct AstNodeVariableDeclaration {
-    Buf symbol;
+    Buf *symbol; // interned
     bool is_const;
     bool is_extern;
     VisibMod visib_mod;
@@ -281,7 +292,7 @@ struct AstNodeVariableDeclaration {
 struct AstNodeTypeDecl {
     VisibMod visib_mod;
     ZigList<AstNode *> *directives;
-    Buf symbol;
+    Buf *symbol; // interned
     AstNode *child_type;
 
     // populated by semantic analyzer
@@ -413,7 +424,7 @@ struct AstNodeSliceExpr {
 
 struct AstNodeFieldAccessExpr {
     AstNode *struct_expr;
-    Buf field_name;
+    Buf *field_name; // interned
 
     // populated by semantic analyzer
     TypeStructField *type_struct_field;
@@ -474,6 +485,11 @@ struct AstNodeCImport {
 
     // populated by semantic analyzer
     TopLevelDecl top_level_decl;
+    // set once the block has been evaluated and clang started on the result,
+    // which may happen before the declaration is resolved
+    bool begun;
+    ImportTableEntry *child_import;
+    ParseHJob *parse_h_job;
 };
 
 struct AstNodeIfBoolExpr {
@@ -691,7 +707,7 @@ struct AstNodeUndefinedLiteral {
 };
 
 struct AstNodeSymbolExpr {
-    Buf symbol;
+    Buf *symbol; // interned
 
     // populated by semantic analyzer
     Expr resolved_expr;
@@ -869,7 +885,7 @@ struct TypeTableEntryStruct {
     bool is_invalid; // true if any fields are invalid
     bool is_unknown_size_array;
     // reminder: hash tables must be initialized before use
-    HashMap<Buf *, FnTableEntry *, buf_hash, buf_eql_buf> fn_table;
+    HashMap<Buf *, FnTableEntry *, buf_interned_hash, buf_interned_eql> fn_table;
 
     // set this flag temporarily to detect infinite loops
     bool embedded_in_current;
@@ -896,7 +912,7 @@ struct TypeTableEntryEnum {
     TypeTableEntry *union_type;
 
     // reminder: hash tables must be initialized before use
-    HashMap<Buf *, FnTableEntry *, buf_hash, buf_eql_buf> fn_table;
+    HashMap<Buf *, FnTableEntry *, buf_interned_hash, buf_interned_eql> fn_table;
 
     // set this flag temporarily to detect infinite loops
     bool embedded_in_current;
@@ -994,9 +1010,11 @@ struct ImportTableEntry {
     ZigList<ImporterInfo> importers;
     AstNode *c_import_node;
     bool any_imports_failed;
+    // AST nodes of this import are allocated from here
+    Arena *arena;
 
     // reminder: hash tables must be initialized before use
-    HashMap<Buf *, FnTableEntry *, buf_hash, buf_eql_buf> fn_table;
+    HashMap<Buf *, FnTableEntry *, buf_interned_hash, buf_interned_eql> fn_table;
     HashMap<Buf *, TypeTableEntry *, buf_hash, buf_eql_buf> type_table;
     HashMap<Buf *, ErrorTableEntry *, buf_hash, buf_eql_buf> error_table;
 };
@@ -1064,10 +1082,13 @@ struct CodeGen {
     ZigList<Buf *> lib_search_paths;
     ZigList<Buf *> link_libs;
 
+    // type table entries and block contexts are allocated from here
+    Arena *arena;
+
     // reminder: hash tables must be initialized before use
     HashMap<Buf *, ImportTableEntry *, buf_hash, buf_eql_buf> import_table;
     HashMap<Buf *, BuiltinFnEntry *, buf_hash, buf_eql_buf> builtin_fn_table;
-    HashMap<Buf *, TypeTableEntry *, buf_hash, buf_eql_buf> primitive_type_table;
+    HashMap<Buf *, TypeTableEntry *, buf_interned_hash, buf_interned_eql> primitive_type_table;
     HashMap<Buf *, AstNode *, buf_hash, buf_eql_buf> unresolved_top_level_decls;
     HashMap<FnTypeId *, TypeTableEntry *, fn_type_id_hash, fn_type_id_eql> fn_type_table;
     HashMap<Buf *, ErrorTableEntry *, buf_hash, buf_eql_buf> error_table;
@@ -1175,11 +1196,33 @@ struct CodeGen {
     int clang_argv_len;
     ZigList<const char *> lib_dirs;
 
+    bool enable_cache;
+    Buf *cache_dir;
+    // set when the result of this compilation is looked up in and stored to
+    // the cache. if cache_hit is true, analysis and code generation were skipped
+    CacheHash *cache_hash;
+    bool cache_hit;
+    // headers clang opened for c_import blocks
+    ZigList<Buf *> c_import_files;
+
+    // null unless --time-report or --trace-out was given. shared with the
+    // child CodeGens of build_o so that their phases nest under the parent's
+    Timing *timing;
+    bool time_report;
+    Buf *trace_out;
+
+    // link ELF targets with the LLD built into zig rather than linker_path
+    bool use_lld;
+    // when more than 1, the module is split into this many parts which are
+    // optimized and emitted in parallel
+    int codegen_threads;
+    CMacros c_macros;
+
     uint32_t test_fn_count;
 };
 
 struct VariableTableEntry {
-    Buf name;
+    Buf *name; // interned
     TypeTableEntry *type;
     LLVMValueRef value_ref;
     bool is_const;
@@ -1202,7 +1245,7 @@ struct BlockContext {
     AstNode *node;
 
     // any variables that are introduced by this scope
-    HashMap<Buf *, VariableTableEntry *, buf_hash, buf_eql_buf> variable_table;
+    HashMap<Buf *, VariableTableEntry *, buf_interned_hash, buf_interned_eql> variable_table;
 
     // if the block is inside a function, this is the function it is in:
     FnTableEntry *fn_entry;
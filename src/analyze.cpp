@@ -109,8 +109,8 @@ ErrorMsg *add_node_error(CodeGen *g, AstNode *node, Buf *msg) {
     return err;
 }
 
-TypeTableEntry *new_type_table_entry(TypeTableEntryId id) {
-    TypeTableEntry *entry = allocate<TypeTableEntry>(1);
+TypeTableEntry *new_type_table_entry(CodeGen *g, TypeTableEntryId id) {
+    TypeTableEntry *entry = arena_allocate<TypeTableEntry>(g->arena, 1);
     entry->arrays_by_size.init(2);
     entry->id = id;
 
@@ -197,7 +197,7 @@ TypeTableEntry *get_pointer_to_type(CodeGen *g, TypeTableEntry *child_type, bool
     if (*parent_pointer) {
         return *parent_pointer;
     } else {
-        TypeTableEntry *entry = new_type_table_entry(TypeTableEntryIdPointer);
+        TypeTableEntry *entry = new_type_table_entry(g, TypeTableEntryIdPointer);
 
         const char *const_str = is_const ? "const " : "";
         buf_resize(&entry->name, 0);
@@ -236,7 +236,7 @@ TypeTableEntry *get_maybe_type(CodeGen *g, TypeTableEntry *child_type) {
         TypeTableEntry *entry = child_type->maybe_parent;
         return entry;
     } else {
-        TypeTableEntry *entry = new_type_table_entry(TypeTableEntryIdMaybe);
+        TypeTableEntry *entry = new_type_table_entry(g, TypeTableEntryIdMaybe);
         assert(child_type->type_ref);
         assert(child_type->di_type);
 
@@ -314,7 +314,7 @@ static TypeTableEntry *get_error_type(CodeGen *g, TypeTableEntry *child_type) {
     if (child_type->error_parent) {
         return child_type->error_parent;
     } else {
-        TypeTableEntry *entry = new_type_table_entry(TypeTableEntryIdErrorUnion);
+        TypeTableEntry *entry = new_type_table_entry(g, TypeTableEntryIdErrorUnion);
         assert(child_type->type_ref);
         assert(child_type->di_type);
 
@@ -391,7 +391,7 @@ TypeTableEntry *get_array_type(CodeGen *g, TypeTableEntry *child_type, uint64_t
         TypeTableEntry *entry = existing_entry->value;
         return entry;
     } else {
-        TypeTableEntry *entry = new_type_table_entry(TypeTableEntryIdArray);
+        TypeTableEntry *entry = new_type_table_entry(g, TypeTableEntryIdArray);
         entry->type_ref = LLVMArrayType(child_type->type_ref, array_size);
         entry->zero_bits = (array_size == 0) || child_type->zero_bits;
 
@@ -442,7 +442,7 @@ static TypeTableEntry *get_slice_type(CodeGen *g, TypeTableEntry *child_type, bo
         return *parent_pointer;
     } else if (is_const) {
         TypeTableEntry *var_peer = get_slice_type(g, child_type, false);
-        TypeTableEntry *entry = new_type_table_entry(TypeTableEntryIdStruct);
+        TypeTableEntry *entry = new_type_table_entry(g, TypeTableEntryIdStruct);
 
         buf_resize(&entry->name, 0);
         buf_appendf(&entry->name, "[]const %s", buf_ptr(&child_type->name));
@@ -456,7 +456,7 @@ static TypeTableEntry *get_slice_type(CodeGen *g, TypeTableEntry *child_type, bo
         *parent_pointer = entry;
         return entry;
     } else {
-        TypeTableEntry *entry = new_type_table_entry(TypeTableEntryIdStruct);
+        TypeTableEntry *entry = new_type_table_entry(g, TypeTableEntryIdStruct);
 
         buf_resize(&entry->name, 0);
         buf_appendf(&entry->name, "[]%s", buf_ptr(&child_type->name));
@@ -525,7 +525,7 @@ static TypeTableEntry *get_slice_type(CodeGen *g, TypeTableEntry *child_type, bo
 }
 
 TypeTableEntry *get_typedecl_type(CodeGen *g, const char *name, TypeTableEntry *child_type) {
-    TypeTableEntry *entry = new_type_table_entry(TypeTableEntryIdTypeDecl);
+    TypeTableEntry *entry = new_type_table_entry(g, TypeTableEntryIdTypeDecl);
 
     buf_init_from_str(&entry->name, name);
 
@@ -551,7 +551,7 @@ TypeTableEntry *get_fn_type(CodeGen *g, FnTypeId *fn_type_id) {
         return table_entry->value;
     }
 
-    TypeTableEntry *fn_type = new_type_table_entry(TypeTableEntryIdFn);
+    TypeTableEntry *fn_type = new_type_table_entry(g, TypeTableEntryIdFn);
     fn_type->data.fn.fn_type_id = *fn_type_id;
     if (fn_type_id->param_info == &fn_type_id->prealloc_param_info[0]) {
         fn_type->data.fn.fn_type_id.param_info = &fn_type->data.fn.fn_type_id.prealloc_param_info[0];
@@ -671,7 +671,7 @@ TypeTableEntry *get_partial_container_type(CodeGen *g, ImportTableEntry *import,
         ContainerKind kind, AstNode *decl_node, const char *name)
 {
     TypeTableEntryId type_id = container_to_type(kind);
-    TypeTableEntry *entry = new_type_table_entry(type_id);
+    TypeTableEntry *entry = new_type_table_entry(g, type_id);
 
     switch (kind) {
         case ContainerKindStruct:
@@ -984,7 +984,7 @@ static void resolve_function_proto(CodeGen *g, AstNode *node, FnTableEntry *fn_t
         fn_type->di_type, fn_table_entry->internal_linkage,
         is_definition, scope_line, flags, is_optimized, fn_table_entry->fn_value);
     if (fn_table_entry->fn_def_node) {
-        BlockContext *context = new_block_context(fn_table_entry->fn_def_node, import->block_context);
+        BlockContext *context = new_block_context(g, fn_table_entry->fn_def_node, import->block_context);
         fn_table_entry->fn_def_node->data.fn_def.block_context = context;
         context->di_scope = LLVMZigSubprogramToScope(subprogram);
     }
@@ -1312,7 +1312,7 @@ static void preview_fn_proto(CodeGen *g, ImportTableEntry *import,
         struct_type = nullptr;
     }
 
-    Buf *proto_name = &proto_node->data.fn_proto.name;
+    Buf *proto_name = proto_node->data.fn_proto.name;
 
     auto fn_table = struct_type ? &struct_type->data.structure.fn_table : &import->fn_table;
 
@@ -1362,7 +1362,7 @@ static void preview_fn_proto(CodeGen *g, ImportTableEntry *import,
         g->main_fn = fn_table_entry;
 
         if (g->bootstrap_import && !g->is_test_build) {
-            g->bootstrap_import->fn_table.put(buf_create_from_str("zig_user_main"), fn_table_entry);
+            g->bootstrap_import->fn_table.put(buf_intern_str("zig_user_main"), fn_table_entry);
         }
     }
     bool is_test_main_fn = !struct_type && (import == g->test_runner_import) && buf_eql_str(proto_name, "main");
@@ -1427,12 +1427,15 @@ static void resolve_error_value_decl(CodeGen *g, ImportTableEntry *import, AstNo
     }
 }
 
-static void resolve_c_import_decl(CodeGen *g, ImportTableEntry *parent_import, AstNode *node) {
+// Evaluates the c_import block and starts clang on the C source it produced.
+static void begin_c_import(CodeGen *g, ImportTableEntry *parent_import, AstNode *node) {
     assert(node->type == NodeTypeCImport);
+    assert(!node->data.c_import.begun);
+    node->data.c_import.begun = true;
 
     AstNode *block_node = node->data.c_import.block;
 
-    BlockContext *child_context = new_block_context(node, parent_import->block_context);
+    BlockContext *child_context = new_block_context(g, node, parent_import->block_context);
     child_context->c_import_buf = buf_alloc();
 
     TypeTableEntry *resolved_type = analyze_block_expr(g, parent_import, child_context,
@@ -1445,6 +1448,7 @@ static void resolve_c_import_decl(CodeGen *g, ImportTableEntry *parent_import, A
     find_libc_include_path(g);
 
     ImportTableEntry *child_import = allocate<ImportTableEntry>(1);
+    child_import->arena = arena_create();
     child_import->fn_table.init(32);
     child_import->type_table.init(8);
     child_import->error_table.init(8);
@@ -1459,12 +1463,31 @@ static void resolve_c_import_decl(CodeGen *g, ImportTableEntry *parent_import, A
         }
     }
 
+    node->data.c_import.child_import = child_import;
+    node->data.c_import.parse_h_job = parse_h_buf_begin(child_import, child_context->c_import_buf, g, node);
+}
+
+static void resolve_c_import_decl(CodeGen *g, ImportTableEntry *parent_import, AstNode *node) {
+    assert(node->type == NodeTypeCImport);
+
+    if (!node->data.c_import.begun) {
+        begin_c_import(g, parent_import, node);
+    }
+    ImportTableEntry *child_import = node->data.c_import.child_import;
+    if (!child_import) {
+        return;
+    }
+
     ZigList<ErrorMsg *> errors = {0};
 
     int err;
-    if ((err = parse_h_buf(child_import, &errors, child_context->c_import_buf, g, node))) {
+    timing_begin(g->timing, "c_import", parent_import->path);
+    err = parse_h_finish(node->data.c_import.parse_h_job, &errors);
+    node->data.c_import.parse_h_job = nullptr;
+    if (err) {
         zig_panic("unable to parse h file: %s\n", err_str(err));
     }
+    timing_end(g->timing);
 
     if (errors.length > 0) {
         ErrorMsg *parent_err_msg = add_node_error(g, node, buf_sprintf("C import failed"));
@@ -1486,7 +1509,7 @@ static void resolve_c_import_decl(CodeGen *g, ImportTableEntry *parent_import, A
     }
 
     child_import->di_file = parent_import->di_file;
-    child_import->block_context = new_block_context(child_import->root, nullptr);
+    child_import->block_context = new_block_context(g, child_import->root, nullptr);
 
     detect_top_level_decl_deps(g, child_import, child_import->root);
     analyze_top_level_decls_root(g, child_import, child_import->root);
@@ -1499,7 +1522,7 @@ static void satisfy_dep(CodeGen *g, AstNode *node) {
     }
 }
 
-static void resolve_top_level_decl(CodeGen *g, ImportTableEntry *import, AstNode *node) {
+static void resolve_top_level_decl_node(CodeGen *g, ImportTableEntry *import, AstNode *node) {
     switch (node->type) {
         case NodeTypeFnProto:
             preview_fn_proto(g, import, node);
@@ -1534,7 +1557,7 @@ static void resolve_top_level_decl(CodeGen *g, ImportTableEntry *import, AstNode
         case NodeTypeTypeDecl:
             {
                 AstNode *type_node = node->data.type_decl.child_type;
-                Buf *decl_name = &node->data.type_decl.symbol;
+                Buf *decl_name = node->data.type_decl.symbol;
 
                 TypeTableEntry *entry;
                 if (node->data.type_decl.override_type) {
@@ -1623,6 +1646,16 @@ static void resolve_top_level_decl(CodeGen *g, ImportTableEntry *import, AstNode
     satisfy_dep(g, node);
 }
 
+static void resolve_top_level_decl(CodeGen *g, ImportTableEntry *import, AstNode *node) {
+    Buf *name = nullptr;
+    if (node->type != NodeTypeRootExportDecl && node->type != NodeTypeImport) {
+        name = get_resolved_top_level_decl(node)->name;
+    }
+    timing_begin_detail(g->timing, "resolve decl", name);
+    resolve_top_level_decl_node(g, import, node);
+    timing_end_detail(g->timing);
+}
+
 static FnTableEntry *get_context_fn_entry(BlockContext *context) {
     assert(context->fn_entry);
     return context->fn_entry;
@@ -1963,7 +1996,7 @@ static bool types_match_with_implicit_cast(CodeGen *g, TypeTableEntry *expected_
 }
 
 static AstNode *create_ast_node(CodeGen *g, ImportTableEntry *import, NodeType kind) {
-    AstNode *node = allocate<AstNode>(1);
+    AstNode *node = arena_allocate<AstNode>(import->arena, 1);
     node->type = kind;
     node->owner = import;
     node->create_index = g->next_node_index;
@@ -2059,8 +2092,8 @@ static TypeTableEntry *resolve_peer_type_compatibility(CodeGen *g, ImportTableEn
     return expected_type;
 }
 
-BlockContext *new_block_context(AstNode *node, BlockContext *parent) {
-    BlockContext *context = allocate<BlockContext>(1);
+BlockContext *new_block_context(CodeGen *g, AstNode *node, BlockContext *parent) {
+    BlockContext *context = arena_allocate<BlockContext>(g->arena, 1);
     context->node = node;
     context->parent = parent;
     context->variable_table.init(4);
@@ -2104,6 +2137,14 @@ static TypeTableEntry *find_container(ImportTableEntry *import, Buf *name) {
         return nullptr;
 }
 
+// name must be interned
+static TypeTableEntry *find_type_by_name(CodeGen *g, ImportTableEntry *import, Buf *name) {
+    auto primitive_table_entry = g->primitive_type_table.maybe_get(name);
+    if (primitive_table_entry)
+        return primitive_table_entry->value;
+    return find_container(import, name);
+}
+
 static TypeEnumField *get_enum_field(TypeTableEntry *enum_type, Buf *name) {
     for (uint32_t i = 0; i < enum_type->data.enumeration.field_count; i += 1) {
         TypeEnumField *type_enum_field = &enum_type->data.enumeration.fields[i];
@@ -2332,7 +2373,7 @@ static TypeTableEntry *analyze_field_access_expr(CodeGen *g, ImportTableEntry *i
 
     AstNode *struct_expr_node = node->data.field_access_expr.struct_expr;
     TypeTableEntry *struct_type = analyze_expression(g, import, context, nullptr, struct_expr_node);
-    Buf *field_name = &node->data.field_access_expr.field_name;
+    Buf *field_name = node->data.field_access_expr.field_name;
 
     bool wrapped_in_fn_call = node->data.field_access_expr.is_fn_call;
 
@@ -2655,7 +2696,7 @@ static TypeTableEntry *analyze_symbol_expr(CodeGen *g, ImportTableEntry *import,
         return resolve_expr_const_val_as_type(g, node, node->data.symbol_expr.override_type_entry);
     }
 
-    Buf *variable_name = &node->data.symbol_expr.symbol;
+    Buf *variable_name = node->data.symbol_expr.symbol;
 
     auto primitive_table_entry = g->primitive_type_table.maybe_get(variable_name);
     if (primitive_table_entry) {
@@ -2760,7 +2801,7 @@ static TypeTableEntry *analyze_lvalue(CodeGen *g, ImportTableEntry *import, Bloc
     TypeTableEntry *expected_rhs_type = nullptr;
     lhs_node->block_context = block_context;
     if (lhs_node->type == NodeTypeSymbol) {
-        Buf *name = &lhs_node->data.symbol_expr.symbol;
+        Buf *name = lhs_node->data.symbol_expr.symbol;
         if (purpose == LValPurposeAddressOf) {
             expected_rhs_type = analyze_symbol_expr(g, import, block_context, nullptr, lhs_node);
         } else {
@@ -3175,7 +3216,7 @@ static VariableTableEntry *add_local_var(CodeGen *g, AstNode *source_node, Impor
     variable_entry->block_context = context;
 
     if (name) {
-        buf_init_from_buf(&variable_entry->name, name);
+        variable_entry->name = name;
         VariableTableEntry *existing_var;
 
         existing_var = find_variable(context, name, context->fn_entry != nullptr);
@@ -3197,9 +3238,9 @@ static VariableTableEntry *add_local_var(CodeGen *g, AstNode *source_node, Impor
             }
         }
 
-        context->variable_table.put(&variable_entry->name, variable_entry);
+        context->variable_table.put(variable_entry->name, variable_entry);
     } else {
-        buf_init_from_str(&variable_entry->name, "_anon");
+        variable_entry->name = buf_intern_str("_anon");
     }
     if (context->fn_entry) {
         context->fn_entry->variable_list.append(variable_entry);
@@ -3226,9 +3267,9 @@ static TypeTableEntry *analyze_unwrap_error_expr(CodeGen *g, ImportTableEntry *i
         TypeTableEntry *child_type = lhs_type->data.error.child_type;
         BlockContext *child_context;
         if (var_node) {
-            child_context = new_block_context(node, parent_context);
+            child_context = new_block_context(g, node, parent_context);
             var_node->block_context = child_context;
-            Buf *var_name = &var_node->data.symbol_expr.symbol;
+            Buf *var_name = var_node->data.symbol_expr.symbol;
             node->data.unwrap_err_expr.var = add_local_var(g, var_node, import, child_context, var_name,
                     g->builtin_types.entry_pure_error, true);
         } else {
@@ -3308,7 +3349,7 @@ static VariableTableEntry *analyze_variable_declaration_raw(CodeGen *g, ImportTa
     assert(type != nullptr); // should have been caught by the parser
 
     VariableTableEntry *var = add_local_var(g, source_node, import, context,
-            &variable_declaration->symbol, type, is_const);
+            variable_declaration->symbol, type, is_const);
 
     variable_declaration->variable = var;
 
@@ -3317,13 +3358,13 @@ static VariableTableEntry *analyze_variable_declaration_raw(CodeGen *g, ImportTa
     if (is_pub) {
         for (int i = 0; i < import->importers.length; i += 1) {
             ImporterInfo importer = import->importers.at(i);
-            auto table_entry = importer.import->block_context->variable_table.maybe_get(&var->name);
+            auto table_entry = importer.import->block_context->variable_table.maybe_get(var->name);
             if (table_entry) {
                 add_node_error(g, importer.source_node,
                     buf_sprintf("import of variable '%s' overrides existing definition",
-                        buf_ptr(&var->name)));
+                        buf_ptr(var->name)));
             } else {
-                importer.import->block_context->variable_table.put(&var->name, var);
+                importer.import->block_context->variable_table.put(var->name, var);
             }
         }
     }
@@ -3459,7 +3500,7 @@ static TypeTableEntry *analyze_while_expr(CodeGen *g, ImportTableEntry *import,
     TypeTableEntry *condition_type = analyze_expression(g, import, context,
             g->builtin_types.entry_bool, condition_node);
 
-    BlockContext *child_context = new_block_context(node, context);
+    BlockContext *child_context = new_block_context(g, node, context);
     child_context->parent_loop_node = node;
 
     analyze_expression(g, import, child_context, g->builtin_types.entry_void, while_body_node);
@@ -3510,17 +3551,17 @@ static TypeTableEntry *analyze_for_expr(CodeGen *g, ImportTableEntry *import, Bl
         child_type = g->builtin_types.entry_invalid;
     }
 
-    BlockContext *child_context = new_block_context(node, context);
+    BlockContext *child_context = new_block_context(g, node, context);
     child_context->parent_loop_node = node;
 
     AstNode *elem_var_node = node->data.for_expr.elem_node;
     elem_var_node->block_context = child_context;
-    Buf *elem_var_name = &elem_var_node->data.symbol_expr.symbol;
+    Buf *elem_var_name = elem_var_node->data.symbol_expr.symbol;
     node->data.for_expr.elem_var = add_local_var(g, elem_var_node, import, child_context, elem_var_name, child_type, true);
 
     AstNode *index_var_node = node->data.for_expr.index_node;
     if (index_var_node) {
-        Buf *index_var_name = &index_var_node->data.symbol_expr.symbol;
+        Buf *index_var_name = index_var_node->data.symbol_expr.symbol;
         index_var_node->block_context = child_context;
         node->data.for_expr.index_var = add_local_var(g, index_var_node, import, child_context, index_var_name,
                 g->builtin_types.entry_isize, true);
@@ -3588,11 +3629,11 @@ static TypeTableEntry *analyze_if(CodeGen *g, ImportTableEntry *import, BlockCon
     if (cond_is_const) {
         if (cond_bool_val) {
             then_context = parent_context;
-            else_context = new_block_context(node, parent_context);
+            else_context = new_block_context(g, node, parent_context);
 
             else_context->codegen_excluded = true;
         } else {
-            then_context = new_block_context(node, parent_context);
+            then_context = new_block_context(g, node, parent_context);
             else_context = parent_context;
 
             then_context->codegen_excluded = true;
@@ -3671,7 +3712,7 @@ static TypeTableEntry *analyze_if_var_expr(CodeGen *g, ImportTableEntry *import,
 {
     assert(node->type == NodeTypeIfVarExpr);
 
-    BlockContext *child_context = new_block_context(node, parent_context);
+    BlockContext *child_context = new_block_context(g, node, parent_context);
 
     analyze_variable_declaration_raw(g, import, child_context, node, &node->data.if_var_expr.var_decl, true);
     VariableTableEntry *var = node->data.if_var_expr.var_decl.variable;
@@ -4075,7 +4116,7 @@ static TypeTableEntry *analyze_builtin_fn_call_expr(CodeGen *g, ImportTableEntry
     assert(node->type == NodeTypeFnCallExpr);
 
     AstNode *fn_ref_expr = node->data.fn_call_expr.fn_ref_expr;
-    Buf *name = &fn_ref_expr->data.symbol_expr.symbol;
+    Buf *name = fn_ref_expr->data.symbol_expr.symbol;
 
     auto entry = g->builtin_fn_table.maybe_get(name);
 
@@ -4494,7 +4535,7 @@ static TypeTableEntry *analyze_fn_call_expr(CodeGen *g, ImportTableEntry *import
                 if (child_type->id == TypeTableEntryIdInvalid) {
                     return g->builtin_types.entry_invalid;
                 } else if (child_type->id == TypeTableEntryIdEnum) {
-                    Buf *field_name = &fn_ref_expr->data.field_access_expr.field_name;
+                    Buf *field_name = fn_ref_expr->data.field_access_expr.field_name;
                     int param_count = node->data.fn_call_expr.params.length;
                     if (param_count > 1) {
                         add_node_error(g, first_executing_node(node->data.fn_call_expr.params.at(1)),
@@ -4514,7 +4555,7 @@ static TypeTableEntry *analyze_fn_call_expr(CodeGen *g, ImportTableEntry *import
                                 child_type, field_name);
                     }
                 } else if (child_type->id == TypeTableEntryIdStruct) {
-                    Buf *field_name = &fn_ref_expr->data.field_access_expr.field_name;
+                    Buf *field_name = fn_ref_expr->data.field_access_expr.field_name;
                     auto entry = child_type->data.structure.fn_table.maybe_get(field_name);
                     if (entry) {
                         return analyze_fn_call_raw(g, import, context, expected_type, node,
@@ -4823,7 +4864,7 @@ static TypeTableEntry *analyze_switch_expr(CodeGen *g, ImportTableEntry *import,
 
                 if (expr_type->id == TypeTableEntryIdEnum) {
                     if (item_node->type == NodeTypeSymbol) {
-                        Buf *field_name = &item_node->data.symbol_expr.symbol;
+                        Buf *field_name = item_node->data.symbol_expr.symbol;
                         TypeEnumField *type_enum_field = get_enum_field(expr_type, field_name);
                         if (type_enum_field) {
                             item_node->data.symbol_expr.enum_field = type_enum_field;
@@ -4880,12 +4921,12 @@ static TypeTableEntry *analyze_switch_expr(CodeGen *g, ImportTableEntry *import,
             }
         }
 
-        BlockContext *child_context = new_block_context(node, context);
+        BlockContext *child_context = new_block_context(g, node, context);
         prong_node->data.switch_prong.block_context = child_context;
         AstNode *var_node = prong_node->data.switch_prong.var_symbol;
         if (var_node) {
             assert(var_node->type == NodeTypeSymbol);
-            Buf *var_name = &var_node->data.symbol_expr.symbol;
+            Buf *var_name = var_node->data.symbol_expr.symbol;
             var_node->block_context = child_context;
             prong_node->data.switch_prong.var = add_local_var(g, var_node, import,
                     child_context, var_name, var_type, true);
@@ -5005,7 +5046,7 @@ static TypeTableEntry *analyze_defer(CodeGen *g, ImportTableEntry *import, Block
         return g->builtin_types.entry_void;
     }
 
-    node->data.defer.child_block = new_block_context(node, parent_context);
+    node->data.defer.child_block = new_block_context(g, node, parent_context);
 
     TypeTableEntry *resolved_type = analyze_expression(g, import, parent_context, nullptr,
             node->data.defer.expr);
@@ -5027,7 +5068,7 @@ static TypeTableEntry *analyze_string_literal_expr(CodeGen *g, ImportTableEntry
 static TypeTableEntry *analyze_block_expr(CodeGen *g, ImportTableEntry *import, BlockContext *parent_context,
         TypeTableEntry *expected_type, AstNode *node)
 {
-    BlockContext *child_context = new_block_context(node, parent_context);
+    BlockContext *child_context = new_block_context(g, node, parent_context);
     node->data.block.child_block = child_context;
     TypeTableEntry *return_type = g->builtin_types.entry_void;
 
@@ -5093,7 +5134,7 @@ static TypeTableEntry *analyze_asm_expr(CodeGen *g, ImportTableEntry *import, Bl
                 break;
             }
         } else {
-            Buf *variable_name = &asm_output->variable_name;
+            Buf *variable_name = buf_intern(&asm_output->variable_name);
             VariableTableEntry *var = find_variable(context, variable_name, false);
             if (var) {
                 asm_output->variable = var;
@@ -5298,11 +5339,11 @@ static void analyze_top_level_fn_def(CodeGen *g, ImportTableEntry *import, AstNo
                 buf_sprintf("byvalue struct parameters not yet supported on extern functions"));
         }
 
-        if (buf_len(&param_decl->name) == 0) {
+        if (buf_len(param_decl->name) == 0) {
             add_node_error(g, param_decl_node, buf_sprintf("missing parameter name"));
         }
 
-        VariableTableEntry *var = add_local_var(g, param_decl_node, import, context, &param_decl->name, type, true);
+        VariableTableEntry *var = add_local_var(g, param_decl_node, import, context, param_decl->name, type, true);
         var->src_arg_index = i;
         param_decl_node->data.param_decl.variable = var;
 
@@ -5403,12 +5444,9 @@ static void collect_expr_decl_deps(CodeGen *g, ImportTableEntry *import, AstNode
                 if (node->data.symbol_expr.override_type_entry) {
                     break;
                 }
-                Buf *name = &node->data.symbol_expr.symbol;
-                auto table_entry = g->primitive_type_table.maybe_get(name);
-                if (!table_entry) {
-                    table_entry = import->type_table.maybe_get(name);
-                }
-                if (!table_entry || !type_is_complete(table_entry->value)) {
+                Buf *name = node->data.symbol_expr.symbol;
+                TypeTableEntry *type_entry = find_type_by_name(g, import, name);
+                if (!type_entry || !type_is_complete(type_entry)) {
                     decl_node->deps.put(name, node);
                 }
                 break;
@@ -5583,12 +5621,9 @@ static void detect_top_level_decl_deps(CodeGen *g, ImportTableEntry *import, Ast
         case NodeTypeStructDecl:
             {
                 Buf *name = &node->data.struct_decl.name;
-                auto table_entry = g->primitive_type_table.maybe_get(name);
-                if (!table_entry) {
-                    table_entry = import->type_table.maybe_get(name);
-                }
-                if (table_entry) {
-                    node->data.struct_decl.type_entry = table_entry->value;
+                TypeTableEntry *existing_type = find_type_by_name(g, import, buf_intern(name));
+                if (existing_type) {
+                    node->data.struct_decl.type_entry = existing_type;
                     add_node_error(g, node, buf_sprintf("redefinition of '%s'", buf_ptr(name)));
                 } else {
                     TypeTableEntry *entry;
@@ -5659,7 +5694,7 @@ static void detect_top_level_decl_deps(CodeGen *g, ImportTableEntry *import, Ast
                 if (node->data.variable_declaration.expr) {
                     collect_expr_decl_deps(g, import, node->data.variable_declaration.expr, decl_node);
                 }
-                Buf *name = &node->data.variable_declaration.symbol;
+                Buf *name = node->data.variable_declaration.symbol;
                 decl_node->name = name;
                 decl_node->import = import;
                 if (decl_node->deps.size() > 0) {
@@ -5676,7 +5711,7 @@ static void detect_top_level_decl_deps(CodeGen *g, ImportTableEntry *import, Ast
                 decl_node->deps.init(1);
                 collect_expr_decl_deps(g, import, node, decl_node);
 
-                Buf *name = &node->data.type_decl.symbol;
+                Buf *name = node->data.type_decl.symbol;
                 decl_node->name = name;
                 decl_node->import = import;
                 if (decl_node->deps.size() > 0) {
@@ -5689,7 +5724,7 @@ static void detect_top_level_decl_deps(CodeGen *g, ImportTableEntry *import, Ast
         case NodeTypeFnProto:
             {
                 // if the name is missing, we immediately announce an error
-                Buf *fn_name = &node->data.fn_proto.name;
+                Buf *fn_name = node->data.fn_proto.name;
                 if (buf_len(fn_name) == 0) {
                     node->data.fn_proto.skip = true;
                     add_node_error(g, node, buf_sprintf("missing function name"));
@@ -5855,6 +5890,27 @@ static void resolve_top_level_declarations_root(CodeGen *g, ImportTableEntry *im
     }
 }
 
+// Clang is the slowest part of a c_import, so before anything is resolved,
+// every c_import which depends on no other declaration is evaluated and its
+// header parsed on a thread of its own. The results are still translated
+// and analyzed one at a time, when each c_import is resolved.
+static void begin_c_imports(CodeGen *g, ImportTableEntry *import) {
+    AstNode *root = import->root;
+    for (int i = 0; i < root->data.root.top_level_decls.length; i += 1) {
+        AstNode *child = root->data.root.top_level_decls.at(i);
+        if (child->type != NodeTypeCImport)
+            continue;
+
+        TopLevelDecl decl = {};
+        decl.deps.init(1);
+        collect_expr_decl_deps(g, import, child->data.c_import.block, &decl);
+        if (decl.deps.size() == 0) {
+            begin_c_import(g, import, child);
+        }
+        decl.deps.deinit();
+    }
+}
+
 static void analyze_top_level_decls_root(CodeGen *g, ImportTableEntry *import, AstNode *node) {
     assert(node->type == NodeTypeRoot);
 
@@ -5904,6 +5960,19 @@ void semantic_analyze(CodeGen *g) {
         g->builtin_types.entry_pure_error->di_type = g->err_tag_type->di_type;
     }
 
+    {
+        auto it = g->import_table.entry_iterator();
+        for (;;) {
+            auto *entry = it.next();
+            if (!entry)
+                break;
+
+            ImportTableEntry *import = entry->value;
+
+            begin_c_imports(g, import);
+        }
+    }
+
     {
         auto it = g->import_table.entry_iterator();
         for (;;) {
@@ -6096,7 +6165,7 @@ bool is_node_void_expr(AstNode *node) {
     {
         AstNode *type_node = node->data.container_init_expr.type;
         if (type_node->type == NodeTypeSymbol &&
-            buf_eql_str(&type_node->data.symbol_expr.symbol, "void"))
+            buf_eql_str(type_node->data.symbol_expr.symbol, "void"))
         {
             return true;
         }
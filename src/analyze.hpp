@@ -12,9 +12,9 @@
 
 void semantic_analyze(CodeGen *g);
 ErrorMsg *add_node_error(CodeGen *g, AstNode *node, Buf *msg);
-TypeTableEntry *new_type_table_entry(TypeTableEntryId id);
+TypeTableEntry *new_type_table_entry(CodeGen *g, TypeTableEntryId id);
 TypeTableEntry *get_pointer_to_type(CodeGen *g, TypeTableEntry *child_type, bool is_const);
-BlockContext *new_block_context(AstNode *node, BlockContext *parent);
+BlockContext *new_block_context(CodeGen *g, AstNode *node, BlockContext *parent);
 Expr *get_resolved_expr(AstNode *node);
 TopLevelDecl *get_resolved_top_level_decl(AstNode *node);
 bool is_node_void_expr(AstNode *node);
@@ -229,7 +229,7 @@ void ast_print(FILE *f, AstNode *node, int indent) {
             }
         case NodeTypeFnProto:
             {
-                Buf *name_buf = &node->data.fn_proto.name;
+                Buf *name_buf = node->data.fn_proto.name;
                 fprintf(f, "%s '%s'\n", node_type_str(node->type), buf_ptr(name_buf));
 
                 for (int i = 0; i < node->data.fn_proto.params.length; i += 1) {
@@ -252,7 +252,7 @@ void ast_print(FILE *f, AstNode *node, int indent) {
             }
         case NodeTypeParamDecl:
             {
-                Buf *name_buf = &node->data.param_decl.name;
+                Buf *name_buf = node->data.param_decl.name;
                 fprintf(f, "%s '%s'\n", node_type_str(node->type), buf_ptr(name_buf));
 
                 ast_print(f, node->data.param_decl.type, indent + 2);
@@ -277,7 +277,7 @@ void ast_print(FILE *f, AstNode *node, int indent) {
             }
         case NodeTypeVariableDeclaration:
             {
-                Buf *name_buf = &node->data.variable_declaration.symbol;
+                Buf *name_buf = node->data.variable_declaration.symbol;
                 fprintf(f, "%s '%s'\n", node_type_str(node->type), buf_ptr(name_buf));
                 if (node->data.variable_declaration.type)
                     ast_print(f, node->data.variable_declaration.type, indent + 2);
@@ -287,7 +287,7 @@ void ast_print(FILE *f, AstNode *node, int indent) {
             }
         case NodeTypeTypeDecl:
             {
-                Buf *name_buf = &node->data.type_decl.symbol;
+                Buf *name_buf = node->data.type_decl.symbol;
                 fprintf(f, "%s '%s'\n", node_type_str(node->type), buf_ptr(name_buf));
                 ast_print(f, node->data.type_decl.child_type, indent + 2);
                 break;
@@ -370,7 +370,7 @@ void ast_print(FILE *f, AstNode *node, int indent) {
                 break;
             }
         case NodeTypeSymbol:
-            fprintf(f, "Symbol %s\n", buf_ptr(&node->data.symbol_expr.symbol));
+            fprintf(f, "Symbol %s\n", buf_ptr(node->data.symbol_expr.symbol));
             break;
         case NodeTypeImport:
             fprintf(f, "%s '%s'\n", node_type_str(node->type), buf_ptr(&node->data.import.path));
@@ -396,7 +396,7 @@ void ast_print(FILE *f, AstNode *node, int indent) {
             break;
         case NodeTypeIfVarExpr:
             {
-                Buf *name_buf = &node->data.if_var_expr.var_decl.symbol;
+                Buf *name_buf = node->data.if_var_expr.var_decl.symbol;
                 fprintf(f, "%s '%s'\n", node_type_str(node->type), buf_ptr(name_buf));
                 if (node->data.if_var_expr.var_decl.type)
                     ast_print(f, node->data.if_var_expr.var_decl.type, indent + 2);
@@ -465,7 +465,7 @@ void ast_print(FILE *f, AstNode *node, int indent) {
             break;
         case NodeTypeFieldAccessExpr:
             fprintf(f, "%s '%s'\n", node_type_str(node->type),
-                    buf_ptr(&node->data.field_access_expr.field_name));
+                    buf_ptr(node->data.field_access_expr.field_name));
             ast_print(f, node->data.field_access_expr.struct_expr, indent + 2);
             break;
         case NodeTypeStructDecl:
@@ -533,7 +533,7 @@ static bool is_node_void(AstNode *node) {
     if (node->type == NodeTypeSymbol) {
         if (node->data.symbol_expr.override_type_entry) {
             return node->data.symbol_expr.override_type_entry->id == TypeTableEntryIdVoid;
-        } else if (buf_eql_str(&node->data.symbol_expr.symbol, "void")) {
+        } else if (buf_eql_str(node->data.symbol_expr.symbol, "void")) {
             return true;
         }
     }
@@ -571,7 +571,7 @@ static void render_node(AstRender *ar, AstNode *node) {
             zig_panic("TODO");
         case NodeTypeFnProto:
             {
-                const char *fn_name = buf_ptr(&node->data.fn_proto.name);
+                const char *fn_name = buf_ptr(node->data.fn_proto.name);
                 const char *pub_str = visib_mod_string(node->data.fn_proto.visib_mod);
                 const char *extern_str = extern_string(node->data.fn_proto.is_extern);
                 const char *inline_str = inline_string(node->data.fn_proto.is_inline);
@@ -581,8 +581,8 @@ static void render_node(AstRender *ar, AstNode *node) {
                 for (int arg_i = 0; arg_i < arg_count; arg_i += 1) {
                     AstNode *param_decl = node->data.fn_proto.params.at(arg_i);
                     assert(param_decl->type == NodeTypeParamDecl);
-                    const char *arg_name = buf_ptr(&param_decl->data.param_decl.name);
-                    if (buf_len(&param_decl->data.param_decl.name) > 0) {
+                    const char *arg_name = buf_ptr(param_decl->data.param_decl.name);
+                    if (buf_len(param_decl->data.param_decl.name) > 0) {
                         const char *noalias_str = param_decl->data.param_decl.is_noalias ? "noalias " : "";
                         fprintf(ar->f, "%s%s: ", noalias_str, arg_name);
                     }
@@ -644,7 +644,7 @@ static void render_node(AstRender *ar, AstNode *node) {
             {
                 const char *pub_str = visib_mod_string(node->data.variable_declaration.visib_mod);
                 const char *extern_str = extern_string(node->data.variable_declaration.is_extern);
-                const char *var_name = buf_ptr(&node->data.variable_declaration.symbol);
+                const char *var_name = buf_ptr(node->data.variable_declaration.symbol);
                 const char *const_or_var = const_or_var_string(node->data.variable_declaration.is_const);
                 fprintf(ar->f, "%s%s%s %s", pub_str, extern_str, const_or_var, var_name);
                 if (node->data.variable_declaration.type) {
@@ -660,7 +660,7 @@ static void render_node(AstRender *ar, AstNode *node) {
         case NodeTypeTypeDecl:
             {
                 const char *pub_str = visib_mod_string(node->data.type_decl.visib_mod);
-                const char *var_name = buf_ptr(&node->data.type_decl.symbol);
+                const char *var_name = buf_ptr(node->data.type_decl.symbol);
                 fprintf(ar->f, "%stype %s = ", pub_str, var_name);
                 render_node(ar, node->data.type_decl.child_type);
                 break;
@@ -708,7 +708,7 @@ static void render_node(AstRender *ar, AstNode *node) {
                 if (override_type) {
                     fprintf(ar->f, "%s", buf_ptr(&override_type->name));
                 } else {
-                    fprintf(ar->f, "%s", buf_ptr(&node->data.symbol_expr.symbol));
+                    fprintf(ar->f, "%s", buf_ptr(node->data.symbol_expr.symbol));
                 }
             }
             break;
@@ -743,7 +743,7 @@ static void render_node(AstRender *ar, AstNode *node) {
         case NodeTypeFieldAccessExpr:
             {
                 AstNode *lhs = node->data.field_access_expr.struct_expr;
-                Buf *rhs = &node->data.field_access_expr.field_name;
+                Buf *rhs = node->data.field_access_expr.field_name;
                 render_node(ar, lhs);
                 fprintf(ar->f, ".%s", buf_ptr(rhs));
                 break;
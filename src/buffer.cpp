@@ -1,8 +1,19 @@
 #include "buffer.hpp"
+#include "hash_map.hpp"
 #include <stdarg.h>
 #include <stdlib.h>
 #include <stdio.h>
 
+#include <mutex>
+
+static thread_local Arena *buf_arena = nullptr;
+
+Buf *buf_alloc_header(void) {
+    if (!buf_arena)
+        buf_arena = arena_create();
+    return arena_allocate<Buf>(buf_arena, 1);
+}
+
 Buf *buf_vprintf(const char *format, va_list ap) {
     va_list ap2;
     va_copy(ap2, ap);
@@ -68,3 +79,57 @@ uint32_t buf_hash(Buf *buf) {
     }
     return h;
 }
+
+// shared by every thread so that interned pointers can be compared anywhere
+static std::mutex intern_mutex;
+static HashMap<Buf *, Buf *, buf_hash, buf_eql_buf> *intern_table = nullptr;
+
+Buf *buf_intern_mem(const char *ptr, int len) {
+    Buf key = BUF_INIT;
+    // a Buf which borrows ptr, only used for the lookup
+    key.list.items = const_cast<char *>(ptr);
+    key.list.length = len + 1;
+
+    std::lock_guard<std::mutex> lock(intern_mutex);
+    if (!intern_table) {
+        intern_table = allocate<HashMap<Buf *, Buf *, buf_hash, buf_eql_buf>>(1);
+        intern_table->init(1024);
+    }
+    auto entry = intern_table->maybe_get(&key);
+    if (entry)
+        return entry->value;
+
+    Buf *result = buf_create_from_mem(ptr, len);
+    intern_table->put(result, result);
+    return result;
+}
+
+Buf *buf_intern_str(const char *str) {
+    return buf_intern_mem(str, strlen(str));
+}
+
+Buf *buf_intern(Buf *buf) {
+    return buf_intern_mem(buf_ptr(buf), buf_len(buf));
+}
+
+bool buf_is_interned(Buf *buf) {
+    std::lock_guard<std::mutex> lock(intern_mutex);
+    if (!intern_table)
+        return false;
+    auto entry = intern_table->maybe_get(buf);
+    return entry && entry->value == buf;
+}
+
+// no assert(buf_is_interned(buf)) here: it would take the intern lock and
+// do a full hash on every call, which is what this hash exists to avoid
+uint32_t buf_interned_hash(Buf *buf) {
+    uint64_t x = (uint64_t)(uintptr_t)buf;
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdULL;
+    x ^= x >> 33;
+    return (uint32_t)x;
+}
+
+bool buf_interned_eql(Buf *buf, Buf *other) {
+    return buf == other;
+}
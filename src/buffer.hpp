@@ -42,14 +42,18 @@ static inline void buf_resize(Buf *buf, int new_len) {
     buf->list.at(buf_len(buf)) = 0;
 }
 
+// Buf headers are never freed, so they come from an arena rather than
+// one malloc each.
+Buf *buf_alloc_header(void);
+
 static inline Buf *buf_alloc(void) {
-    Buf *buf = allocate<Buf>(1);
+    Buf *buf = buf_alloc_header();
     buf_resize(buf, 0);
     return buf;
 }
 
 static inline Buf *buf_alloc_fixed(int size) {
-    Buf *buf = allocate<Buf>(1);
+    Buf *buf = buf_alloc_header();
     buf_resize(buf, size);
     return buf;
 }
@@ -75,7 +79,7 @@ static inline void buf_init_from_buf(Buf *buf, Buf *other) {
 
 static inline Buf *buf_create_from_mem(const char *ptr, int len) {
     assert(len >= 0);
-    Buf *buf = allocate<Buf>(1);
+    Buf *buf = buf_alloc_header();
     buf_init_from_mem(buf, ptr, len);
     return buf;
 }
@@ -94,7 +98,7 @@ static inline Buf *buf_slice(Buf *in_buf, int start, int end) {
     assert(end >= 0);
     assert(start < buf_len(in_buf));
     assert(end <= buf_len(in_buf));
-    Buf *out_buf = allocate<Buf>(1);
+    Buf *out_buf = buf_alloc_header();
     out_buf->list.resize(end - start + 1);
     memcpy(buf_ptr(out_buf), buf_ptr(in_buf) + start, end - start);
     out_buf->list.at(buf_len(out_buf)) = 0;
@@ -150,6 +154,18 @@ static inline bool buf_starts_with_buf(Buf *buf, Buf *sub) {
 bool buf_eql_buf(Buf *buf, Buf *other);
 uint32_t buf_hash(Buf *buf);
 
+// Interning returns the one canonical Buf for some contents, so that two
+// interned names are equal exactly when the pointers are. Interned Bufs are
+// shared and must never be modified.
+Buf *buf_intern_mem(const char *ptr, int len);
+Buf *buf_intern_str(const char *str);
+Buf *buf_intern(Buf *buf);
+bool buf_is_interned(Buf *buf);
+
+// for HashMaps whose keys are all interned
+uint32_t buf_interned_hash(Buf *buf);
+bool buf_interned_eql(Buf *buf, Buf *other);
+
 static inline void buf_upcase(Buf *buf) {
     for (int i = 0; i < buf_len(buf); i += 1) {
         buf_ptr(buf)[i] = toupper(buf_ptr(buf)[i]);
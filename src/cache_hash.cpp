@@ -0,0 +1,323 @@
+/*
+ * Copyright (c) 2016 Andrew Kelley
+ *
+ * This file is part of zig, which is MIT licensed.
+ * See http://opensource.org/licenses/MIT
+ */
+
+#include "cache_hash.hpp"
+#include "config.h"
+#include "os.hpp"
+#include "error.hpp"
+
+#include <inttypes.h>
+
+// SipHash-2-4 with 128 bit output. We don't need a cryptographic hash here,
+// just one where an accidental collision between two build inputs is not
+// going to happen.
+
+static const uint64_t cache_key_0 = 0x0706050403020100ULL;
+static const uint64_t cache_key_1 = 0x0f0e0d0c0b0a0908ULL;
+
+static inline uint64_t rotl64(uint64_t x, int b) {
+    return (x << b) | (x >> (64 - b));
+}
+
+static inline void sip_round(CacheHasher *h) {
+    h->v0 += h->v1; h->v1 = rotl64(h->v1, 13); h->v1 ^= h->v0; h->v0 = rotl64(h->v0, 32);
+    h->v2 += h->v3; h->v3 = rotl64(h->v3, 16); h->v3 ^= h->v2;
+    h->v0 += h->v3; h->v3 = rotl64(h->v3, 21); h->v3 ^= h->v0;
+    h->v2 += h->v1; h->v1 = rotl64(h->v1, 17); h->v1 ^= h->v2; h->v2 = rotl64(h->v2, 32);
+}
+
+static inline uint64_t read_u64_le(const uint8_t *p) {
+    uint64_t result = 0;
+    for (int i = 7; i >= 0; i -= 1) {
+        result = (result << 8) | p[i];
+    }
+    return result;
+}
+
+static void hasher_init(CacheHasher *h) {
+    h->v0 = cache_key_0 ^ 0x736f6d6570736575ULL;
+    h->v1 = cache_key_1 ^ 0x646f72616e646f6dULL ^ 0xee;
+    h->v2 = cache_key_0 ^ 0x6c7967656e657261ULL;
+    h->v3 = cache_key_1 ^ 0x7465646279746573ULL;
+    h->tail_len = 0;
+    h->total_len = 0;
+}
+
+static void hasher_block(CacheHasher *h, uint64_t m) {
+    h->v3 ^= m;
+    sip_round(h);
+    sip_round(h);
+    h->v0 ^= m;
+}
+
+static void hasher_update(CacheHasher *h, const uint8_t *ptr, size_t len) {
+    h->total_len += len;
+    while (len > 0 && h->tail_len > 0) {
+        h->tail[h->tail_len] = *ptr;
+        h->tail_len += 1;
+        ptr += 1;
+        len -= 1;
+        if (h->tail_len == 8) {
+            hasher_block(h, read_u64_le(h->tail));
+            h->tail_len = 0;
+        }
+    }
+    while (len >= 8) {
+        hasher_block(h, read_u64_le(ptr));
+        ptr += 8;
+        len -= 8;
+    }
+    for (size_t i = 0; i < len; i += 1) {
+        h->tail[h->tail_len] = ptr[i];
+        h->tail_len += 1;
+    }
+}
+
+static void write_u64_le(uint8_t *p, uint64_t x) {
+    for (int i = 0; i < 8; i += 1) {
+        p[i] = (uint8_t)(x >> (i * 8));
+    }
+}
+
+static void hasher_final(CacheHasher *h, uint8_t *out_digest) {
+    uint64_t b = h->total_len << 56;
+    for (int i = 0; i < h->tail_len; i += 1) {
+        b |= ((uint64_t)h->tail[i]) << (i * 8);
+    }
+    hasher_block(h, b);
+
+    h->v2 ^= 0xee;
+    for (int i = 0; i < 4; i += 1) {
+        sip_round(h);
+    }
+    write_u64_le(out_digest, h->v0 ^ h->v1 ^ h->v2 ^ h->v3);
+
+    h->v1 ^= 0xdd;
+    for (int i = 0; i < 4; i += 1) {
+        sip_round(h);
+    }
+    write_u64_le(out_digest + 8, h->v0 ^ h->v1 ^ h->v2 ^ h->v3);
+}
+
+void cache_hash_mem(const char *ptr, int len, uint8_t *out_digest) {
+    CacheHasher hasher;
+    hasher_init(&hasher);
+    hasher_update(&hasher, (const uint8_t *)ptr, len);
+    hasher_final(&hasher, out_digest);
+}
+
+static void digest_to_hex(const uint8_t *digest, Buf *out_hex) {
+    static const char hex_digits[] = "0123456789abcdef";
+    buf_resize(out_hex, CACHE_HEX_DIGEST_LEN);
+    for (int i = 0; i < CACHE_DIGEST_LEN; i += 1) {
+        buf_ptr(out_hex)[i * 2] = hex_digits[digest[i] >> 4];
+        buf_ptr(out_hex)[i * 2 + 1] = hex_digits[digest[i] & 0xf];
+    }
+}
+
+void cache_init(CacheHash *ch, Buf *cache_dir) {
+    ch->cache_dir = cache_dir;
+    hasher_init(&ch->hasher);
+    ch->files.clear();
+}
+
+void cache_mem(CacheHash *ch, const char *ptr, int len) {
+    assert(len >= 0);
+    // prefix the length so that adjacent values can't run together
+    uint32_t len_prefix = (uint32_t)len;
+    hasher_update(&ch->hasher, (const uint8_t *)&len_prefix, sizeof(len_prefix));
+    hasher_update(&ch->hasher, (const uint8_t *)ptr, len);
+}
+
+void cache_str(CacheHash *ch, const char *ptr) {
+    cache_mem(ch, ptr, strlen(ptr));
+}
+
+void cache_buf(CacheHash *ch, Buf *buf) {
+    if (buf) {
+        cache_mem(ch, buf_ptr(buf), buf_len(buf));
+    } else {
+        cache_mem(ch, "", 0);
+    }
+}
+
+void cache_int(CacheHash *ch, int x) {
+    hasher_update(&ch->hasher, (const uint8_t *)&x, sizeof(x));
+}
+
+void cache_bool(CacheHash *ch, bool x) {
+    uint8_t byte = x ? 1 : 0;
+    hasher_update(&ch->hasher, &byte, 1);
+}
+
+void cache_compiler_id(CacheHash *ch) {
+    // the version string stays the same from one build of zig to the next,
+    // the executable's size and modification time do not
+    static Buf *compiler_id = nullptr;
+    if (!compiler_id) {
+        Buf exe_path = BUF_INIT;
+        uint64_t size;
+        uint64_t mtime;
+        if (!os_self_exe_path(&exe_path) && !os_file_stamp(&exe_path, &size, &mtime)) {
+            compiler_id = buf_sprintf("%s %s %" PRIu64 " %" PRIu64, ZIG_VERSION_STRING,
+                    buf_ptr(&exe_path), size, mtime);
+        } else {
+            // without knowing which compiler this is, nothing it builds may
+            // be reused by another process
+            compiler_id = buf_sprintf("%s pid %d %f", ZIG_VERSION_STRING, os_get_pid(), os_get_time());
+        }
+        buf_deinit(&exe_path);
+    }
+    cache_buf(ch, compiler_id);
+}
+
+static int hex_value(char c) {
+    if (c >= '0' && c <= '9')
+        return c - '0';
+    if (c >= 'a' && c <= 'f')
+        return c - 'a' + 10;
+    return -1;
+}
+
+static bool parse_hex_digest(const char *ptr, uint8_t *out_digest) {
+    for (int i = 0; i < CACHE_DIGEST_LEN; i += 1) {
+        int hi = hex_value(ptr[i * 2]);
+        int lo = hex_value(ptr[i * 2 + 1]);
+        if (hi < 0 || lo < 0)
+            return false;
+        out_digest[i] = (uint8_t)((hi << 4) | lo);
+    }
+    return true;
+}
+
+// Each line of the manifest is the hex digest of a file's contents, a space,
+// and then the path of the file. The files are added to ch->files as they
+// are checked.
+static bool manifest_files_match(CacheHash *ch, Buf *manifest) {
+    Buf file_contents = BUF_INIT;
+    buf_resize(&file_contents, 0);
+    Buf file_path = BUF_INIT;
+    bool match = true;
+
+    char *ptr = buf_ptr(manifest);
+    char *end = ptr + buf_len(manifest);
+    while (ptr < end) {
+        char *line_end = (char *)memchr(ptr, '\n', end - ptr);
+        if (!line_end) {
+            match = false;
+            break;
+        }
+        uint8_t expected_digest[CACHE_DIGEST_LEN];
+        if (line_end - ptr <= CACHE_HEX_DIGEST_LEN + 1 ||
+            ptr[CACHE_HEX_DIGEST_LEN] != ' ' ||
+            !parse_hex_digest(ptr, expected_digest))
+        {
+            match = false;
+            break;
+        }
+        char *path_start = ptr + CACHE_HEX_DIGEST_LEN + 1;
+        buf_init_from_mem(&file_path, path_start, line_end - path_start);
+
+        if (os_fetch_file_path(&file_path, &file_contents)) {
+            match = false;
+            break;
+        }
+        uint8_t actual_digest[CACHE_DIGEST_LEN];
+        cache_hash_mem(buf_ptr(&file_contents), buf_len(&file_contents), actual_digest);
+        if (memcmp(expected_digest, actual_digest, CACHE_DIGEST_LEN) != 0) {
+            match = false;
+            break;
+        }
+        ch->files.add_one();
+        ch->files.last().path = buf_create_from_buf(&file_path);
+        memcpy(ch->files.last().digest, actual_digest, CACHE_DIGEST_LEN);
+
+        ptr = line_end + 1;
+    }
+
+    buf_deinit(&file_path);
+    buf_deinit(&file_contents);
+    return match;
+}
+
+int cache_hit(CacheHash *ch, bool *out_hit) {
+    *out_hit = false;
+
+    uint8_t digest[CACHE_DIGEST_LEN];
+    hasher_final(&ch->hasher, digest);
+    digest_to_hex(digest, &ch->hex_digest);
+
+    buf_resize(&ch->artifact_dir, 0);
+    buf_appendf(&ch->artifact_dir, "%s/o/%s", buf_ptr(ch->cache_dir), buf_ptr(&ch->hex_digest));
+    os_path_join(&ch->artifact_dir, buf_create_from_str("manifest"), &ch->manifest_path);
+
+    Buf manifest = BUF_INIT;
+    int err;
+    if ((err = os_fetch_file_path(&ch->manifest_path, &manifest))) {
+        if (err != ErrorFileNotFound)
+            return err;
+        return os_make_path(&ch->artifact_dir);
+    }
+
+    *out_hit = manifest_files_match(ch, &manifest);
+    if (!*out_hit) {
+        ch->files.clear();
+    }
+    buf_deinit(&manifest);
+    return 0;
+}
+
+void cache_add_file(CacheHash *ch, Buf *path, Buf *contents) {
+    ch->files.add_one();
+    CacheHashFile *file = &ch->files.last();
+    file->path = path;
+    cache_hash_mem(buf_ptr(contents), buf_len(contents), file->digest);
+}
+
+int cache_add_file_path(CacheHash *ch, Buf *path) {
+    Buf contents = BUF_INIT;
+    int err;
+    if ((err = os_fetch_file_path(path, &contents))) {
+        return err;
+    }
+    cache_add_file(ch, path, &contents);
+    buf_deinit(&contents);
+    return 0;
+}
+
+Buf *cache_artifact_path(CacheHash *ch, const char *basename) {
+    Buf *result = buf_alloc();
+    os_path_join(&ch->artifact_dir, buf_create_from_str(basename), result);
+    return result;
+}
+
+// Another compiler process may be populating the same cache entry, so
+// artifacts are written under a unique name and then renamed into place.
+Buf *cache_tmp_path(Buf *path) {
+    return buf_sprintf("%s.tmp%d", buf_ptr(path), os_get_pid());
+}
+
+int cache_final(CacheHash *ch) {
+    Buf contents = BUF_INIT;
+    buf_resize(&contents, 0);
+    Buf hex = BUF_INIT;
+    for (int i = 0; i < ch->files.length; i += 1) {
+        CacheHashFile *file = &ch->files.at(i);
+        digest_to_hex(file->digest, &hex);
+        buf_appendf(&contents, "%s %s\n", buf_ptr(&hex), buf_ptr(file->path));
+    }
+
+    Buf *tmp_path = cache_tmp_path(&ch->manifest_path);
+    int err;
+    if ((err = os_write_file_path(tmp_path, &contents)) || (err = os_rename(tmp_path, &ch->manifest_path))) {
+        os_delete_file(tmp_path);
+    }
+
+    buf_deinit(&hex);
+    buf_deinit(&contents);
+    return err;
+}
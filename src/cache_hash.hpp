@@ -0,0 +1,77 @@
+/*
+ * Copyright (c) 2016 Andrew Kelley
+ *
+ * This file is part of zig, which is MIT licensed.
+ * See http://opensource.org/licenses/MIT
+ */
+
+#ifndef ZIG_CACHE_HASH_HPP
+#define ZIG_CACHE_HASH_HPP
+
+#include "buffer.hpp"
+#include "list.hpp"
+
+#include <stdint.h>
+
+#define CACHE_DIGEST_LEN 16
+#define CACHE_HEX_DIGEST_LEN (CACHE_DIGEST_LEN * 2)
+
+struct CacheHasher {
+    uint64_t v0;
+    uint64_t v1;
+    uint64_t v2;
+    uint64_t v3;
+    uint8_t tail[8];
+    int tail_len;
+    uint64_t total_len;
+};
+
+struct CacheHashFile {
+    Buf *path;
+    uint8_t digest[CACHE_DIGEST_LEN];
+};
+
+// A CacheHash identifies one artifact directory in the cache. Everything that
+// is known before compilation (compiler version, flags, root source) goes into
+// the key with the cache_* functions. Files which are only discovered during
+// compilation (imports, headers) are recorded with cache_add_file and stored in
+// the manifest, and must still match for a later cache_hit to succeed.
+struct CacheHash {
+    Buf *cache_dir;
+    CacheHasher hasher;
+    ZigList<CacheHashFile> files;
+    Buf hex_digest;
+    Buf artifact_dir;
+    Buf manifest_path;
+};
+
+void cache_init(CacheHash *ch, Buf *cache_dir);
+
+void cache_mem(CacheHash *ch, const char *ptr, int len);
+void cache_str(CacheHash *ch, const char *ptr);
+void cache_buf(CacheHash *ch, Buf *buf);
+void cache_int(CacheHash *ch, int x);
+void cache_bool(CacheHash *ch, bool x);
+// Identifies the zig executable doing the build, so that artifacts built by
+// a previous build of the compiler are not reused.
+void cache_compiler_id(CacheHash *ch);
+
+// Finishes the key and checks the manifest. out_hit is set to true if the
+// artifact directory holds a valid result for this key, and then files holds
+// the files listed in the manifest. Afterwards artifact_dir exists and is the
+// directory results should be read from or written to.
+int cache_hit(CacheHash *ch, bool *out_hit);
+
+void cache_add_file(CacheHash *ch, Buf *path, Buf *contents);
+int cache_add_file_path(CacheHash *ch, Buf *path);
+
+// Writes the manifest for the files added with cache_add_file. Call this only
+// after all artifacts have been written into artifact_dir.
+int cache_final(CacheHash *ch);
+
+Buf *cache_artifact_path(CacheHash *ch, const char *basename);
+Buf *cache_tmp_path(Buf *path);
+
+void cache_hash_mem(const char *ptr, int len, uint8_t *out_digest);
+
+#endif
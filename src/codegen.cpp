@@ -17,6 +17,7 @@
 #include "ast_render.hpp"
 #include "target.hpp"
 #include "link.hpp"
+#include "cache_hash.hpp"
 
 #include <stdio.h>
 #include <errno.h>
@@ -49,6 +50,7 @@ static void init_darwin_native(CodeGen *g) {
 
 CodeGen *codegen_create(Buf *root_source_dir, const ZigTarget *target) {
     CodeGen *g = allocate<CodeGen>(1);
+    g->arena = arena_create();
     g->import_table.init(32);
     g->builtin_fn_table.init(32);
     g->primitive_type_table.init(32);
@@ -60,6 +62,12 @@ CodeGen *codegen_create(Buf *root_source_dir, const ZigTarget *target) {
     g->root_source_dir = root_source_dir;
     g->error_value_count = 1;
 
+    g->enable_cache = true;
+    g->cache_dir = buf_alloc();
+    if (os_get_app_cache_dir(g->cache_dir, "zig")) {
+        g->enable_cache = false;
+    }
+
     if (target) {
         // cross compiling, so we can't rely on all the configured stuff since
         // that's for native compilation
@@ -182,6 +190,45 @@ void codegen_set_rdynamic(CodeGen *g, bool rdynamic) {
     g->linker_rdynamic = rdynamic;
 }
 
+void codegen_set_enable_cache(CodeGen *g, bool enable_cache) {
+    g->enable_cache = enable_cache;
+}
+
+void codegen_set_cache_dir(CodeGen *g, Buf *cache_dir) {
+    g->cache_dir = cache_dir;
+    g->enable_cache = true;
+}
+
+void codegen_set_time_report(CodeGen *g, bool time_report) {
+    g->time_report = time_report;
+    if (time_report) {
+        if (!g->timing)
+            g->timing = timing_create();
+        LLVMZigEnableTimePasses();
+    }
+}
+
+void codegen_set_use_lld(CodeGen *g, bool use_lld) {
+    g->use_lld = use_lld;
+}
+
+void codegen_set_codegen_threads(CodeGen *g, int codegen_threads) {
+    g->codegen_threads = codegen_threads;
+}
+
+void codegen_set_c_macros(CodeGen *g, CMacros c_macros) {
+    g->c_macros = c_macros;
+}
+
+void codegen_set_trace_out(CodeGen *g, Buf *trace_out) {
+    g->trace_out = trace_out;
+    if (trace_out) {
+        if (!g->timing)
+            g->timing = timing_create();
+        g->timing->record_details = true;
+    }
+}
+
 static LLVMValueRef gen_expr(CodeGen *g, AstNode *expr_node);
 static LLVMValueRef gen_lvalue(CodeGen *g, AstNode *expr_node, AstNode *node, TypeTableEntry **out_type_entry);
 static LLVMValueRef gen_field_access_expr(CodeGen *g, AstNode *node, bool is_lvalue);
@@ -988,7 +1035,7 @@ static LLVMValueRef gen_field_access_expr(CodeGen *g, AstNode *node, bool is_lva
 
     AstNode *struct_expr = node->data.field_access_expr.struct_expr;
     TypeTableEntry *struct_type = get_expr_type(struct_expr);
-    Buf *name = &node->data.field_access_expr.field_name;
+    Buf *name = node->data.field_access_expr.field_name;
 
     if (struct_type->id == TypeTableEntryIdArray) {
         if (buf_eql_str(name, "len")) {
@@ -3003,7 +3050,7 @@ static void do_code_gen(CodeGen *g) {
 
         LLVMValueRef global_value;
         if (var->decl_node->data.variable_declaration.is_extern) {
-            global_value = LLVMAddGlobal(g->module, var->type->type_ref, buf_ptr(&var->name));
+            global_value = LLVMAddGlobal(g->module, var->type->type_ref, buf_ptr(var->name));
 
             LLVMSetLinkage(global_value, LLVMExternalLinkage);
         } else {
@@ -3019,7 +3066,7 @@ static void do_code_gen(CodeGen *g) {
                 init_val = LLVMConstNull(var->type->type_ref);
             }
 
-            global_value = LLVMAddGlobal(g->module, LLVMTypeOf(init_val), buf_ptr(&var->name));
+            global_value = LLVMAddGlobal(g->module, LLVMTypeOf(init_val), buf_ptr(var->name));
             LLVMSetInitializer(global_value, init_val);
             LLVMSetLinkage(global_value, LLVMInternalLinkage);
             LLVMSetUnnamedAddr(global_value, true);
@@ -3138,6 +3185,8 @@ static void do_code_gen(CodeGen *g) {
             continue;
         }
 
+        timing_begin_detail(g->timing, "gen fn", &fn_table_entry->symbol_name);
+
         ImportTableEntry *import = fn_table_entry->import_entry;
         AstNode *fn_def_node = fn_table_entry->fn_def_node;
         LLVMValueRef fn = fn_table_entry->fn_value;
@@ -3197,7 +3246,7 @@ static void do_code_gen(CodeGen *g) {
                 arg_no = 0;
 
                 add_debug_source_node(g, var->decl_node);
-                var->value_ref = LLVMBuildAlloca(g->builder, var->type->type_ref, buf_ptr(&var->name));
+                var->value_ref = LLVMBuildAlloca(g->builder, var->type->type_ref, buf_ptr(var->name));
                 uint64_t align_bytes = LLVMABISizeOfType(g->target_data_ref, var->type->type_ref);
                 LLVMSetAlignment(var->value_ref, align_bytes);
 
@@ -3205,7 +3254,7 @@ static void do_code_gen(CodeGen *g) {
             }
 
             var->di_loc_var = LLVMZigCreateLocalVariable(g->dbuilder, tag,
-                    var->block_context->di_scope, buf_ptr(&var->name),
+                    var->block_context->di_scope, buf_ptr(var->name),
                     import->di_file, var->decl_node->line + 1,
                     gen_type->di_type, !g->strip_debug_symbols, 0, arg_no);
         }
@@ -3247,6 +3296,7 @@ static void do_code_gen(CodeGen *g) {
         TypeTableEntry *implicit_return_type = fn_def_node->data.fn_def.implicit_return_type;
         gen_block(g, fn_def_node->data.fn_def.body, implicit_return_type);
 
+        timing_end_detail(g->timing);
     }
     assert(!g->errors.length);
 
@@ -3291,25 +3341,25 @@ static const CIntTypeInfo c_int_type_infos[] = {
 static void define_builtin_types(CodeGen *g) {
     {
         // if this type is anywhere in the AST, we should never hit codegen.
-        TypeTableEntry *entry = new_type_table_entry(TypeTableEntryIdInvalid);
+        TypeTableEntry *entry = new_type_table_entry(g, TypeTableEntryIdInvalid);
         buf_init_from_str(&entry->name, "(invalid)");
         entry->zero_bits = true;
         g->builtin_types.entry_invalid = entry;
     }
     {
-        TypeTableEntry *entry = new_type_table_entry(TypeTableEntryIdNumLitFloat);
+        TypeTableEntry *entry = new_type_table_entry(g, TypeTableEntryIdNumLitFloat);
         buf_init_from_str(&entry->name, "(float literal)");
         entry->zero_bits = true;
         g->builtin_types.entry_num_lit_float = entry;
     }
     {
-        TypeTableEntry *entry = new_type_table_entry(TypeTableEntryIdNumLitInt);
+        TypeTableEntry *entry = new_type_table_entry(g, TypeTableEntryIdNumLitInt);
         buf_init_from_str(&entry->name, "(integer literal)");
         entry->zero_bits = true;
         g->builtin_types.entry_num_lit_int = entry;
     }
     {
-        TypeTableEntry *entry = new_type_table_entry(TypeTableEntryIdUndefLit);
+        TypeTableEntry *entry = new_type_table_entry(g, TypeTableEntryIdUndefLit);
         buf_init_from_str(&entry->name, "(undefined)");
         g->builtin_types.entry_undef = entry;
     }
@@ -3318,7 +3368,7 @@ static void define_builtin_types(CodeGen *g) {
         int size_in_bits = int_sizes_in_bits[i];
         bool is_signed = true;
         for (;;) {
-            TypeTableEntry *entry = new_type_table_entry(TypeTableEntryIdInt);
+            TypeTableEntry *entry = new_type_table_entry(g, TypeTableEntryIdInt);
             entry->type_ref = LLVMIntType(size_in_bits);
 
             const char u_or_i = is_signed ? 'i' : 'u';
@@ -3346,7 +3396,7 @@ static void define_builtin_types(CodeGen *g) {
                     debug_size_in_bits, debug_align_in_bits, dwarf_tag);
             entry->data.integral.is_signed = is_signed;
             entry->data.integral.bit_count = size_in_bits;
-            g->primitive_type_table.put(&entry->name, entry);
+            g->primitive_type_table.put(buf_intern(&entry->name), entry);
 
             get_int_type_ptr(g, is_signed, size_in_bits)[0] = entry;
 
@@ -3363,7 +3413,7 @@ static void define_builtin_types(CodeGen *g) {
         uint64_t size_in_bits = get_c_type_size_in_bits(&g->zig_target, info->id);
         bool is_signed = info->is_signed;
 
-        TypeTableEntry *entry = new_type_table_entry(TypeTableEntryIdInt);
+        TypeTableEntry *entry = new_type_table_entry(g, TypeTableEntryIdInt);
         entry->type_ref = LLVMIntType(size_in_bits);
 
         buf_init_from_str(&entry->name, info->name);
@@ -3376,13 +3426,13 @@ static void define_builtin_types(CodeGen *g) {
                 is_signed ? LLVMZigEncoding_DW_ATE_signed() : LLVMZigEncoding_DW_ATE_unsigned());
         entry->data.integral.is_signed = is_signed;
         entry->data.integral.bit_count = size_in_bits;
-        g->primitive_type_table.put(&entry->name, entry);
+        g->primitive_type_table.put(buf_intern(&entry->name), entry);
 
         get_c_int_type_ptr(g, info->id)[0] = entry;
     }
 
     {
-        TypeTableEntry *entry = new_type_table_entry(TypeTableEntryIdBool);
+        TypeTableEntry *entry = new_type_table_entry(g, TypeTableEntryIdBool);
         entry->type_ref = LLVMInt1Type();
         buf_init_from_str(&entry->name, "bool");
         uint64_t debug_size_in_bits = 8*LLVMStoreSizeOfType(g->target_data_ref, entry->type_ref);
@@ -3392,10 +3442,10 @@ static void define_builtin_types(CodeGen *g) {
                 debug_align_in_bits,
                 LLVMZigEncoding_DW_ATE_boolean());
         g->builtin_types.entry_bool = entry;
-        g->primitive_type_table.put(&entry->name, entry);
+        g->primitive_type_table.put(buf_intern(&entry->name), entry);
     }
     {
-        TypeTableEntry *entry = new_type_table_entry(TypeTableEntryIdInt);
+        TypeTableEntry *entry = new_type_table_entry(g, TypeTableEntryIdInt);
         entry->type_ref = LLVMIntType(g->pointer_size_bytes * 8);
         buf_init_from_str(&entry->name, "isize");
         entry->data.integral.is_signed = true;
@@ -3408,10 +3458,10 @@ static void define_builtin_types(CodeGen *g) {
                 debug_align_in_bits,
                 LLVMZigEncoding_DW_ATE_signed());
         g->builtin_types.entry_isize = entry;
-        g->primitive_type_table.put(&entry->name, entry);
+        g->primitive_type_table.put(buf_intern(&entry->name), entry);
     }
     {
-        TypeTableEntry *entry = new_type_table_entry(TypeTableEntryIdInt);
+        TypeTableEntry *entry = new_type_table_entry(g, TypeTableEntryIdInt);
         entry->type_ref = LLVMIntType(g->pointer_size_bytes * 8);
         buf_init_from_str(&entry->name, "usize");
         entry->data.integral.is_signed = false;
@@ -3424,10 +3474,10 @@ static void define_builtin_types(CodeGen *g) {
                 debug_align_in_bits,
                 LLVMZigEncoding_DW_ATE_unsigned());
         g->builtin_types.entry_usize = entry;
-        g->primitive_type_table.put(&entry->name, entry);
+        g->primitive_type_table.put(buf_intern(&entry->name), entry);
     }
     {
-        TypeTableEntry *entry = new_type_table_entry(TypeTableEntryIdFloat);
+        TypeTableEntry *entry = new_type_table_entry(g, TypeTableEntryIdFloat);
         entry->type_ref = LLVMFloatType();
         buf_init_from_str(&entry->name, "f32");
         entry->data.floating.bit_count = 32;
@@ -3439,10 +3489,10 @@ static void define_builtin_types(CodeGen *g) {
                 debug_align_in_bits,
                 LLVMZigEncoding_DW_ATE_float());
         g->builtin_types.entry_f32 = entry;
-        g->primitive_type_table.put(&entry->name, entry);
+        g->primitive_type_table.put(buf_intern(&entry->name), entry);
     }
     {
-        TypeTableEntry *entry = new_type_table_entry(TypeTableEntryIdFloat);
+        TypeTableEntry *entry = new_type_table_entry(g, TypeTableEntryIdFloat);
         entry->type_ref = LLVMDoubleType();
         buf_init_from_str(&entry->name, "f64");
         entry->data.floating.bit_count = 64;
@@ -3454,10 +3504,10 @@ static void define_builtin_types(CodeGen *g) {
                 debug_align_in_bits,
                 LLVMZigEncoding_DW_ATE_float());
         g->builtin_types.entry_f64 = entry;
-        g->primitive_type_table.put(&entry->name, entry);
+        g->primitive_type_table.put(buf_intern(&entry->name), entry);
     }
     {
-        TypeTableEntry *entry = new_type_table_entry(TypeTableEntryIdFloat);
+        TypeTableEntry *entry = new_type_table_entry(g, TypeTableEntryIdFloat);
         entry->type_ref = LLVMX86FP80Type();
         buf_init_from_str(&entry->name, "c_long_double");
         entry->data.floating.bit_count = 80;
@@ -3469,10 +3519,10 @@ static void define_builtin_types(CodeGen *g) {
                 debug_align_in_bits,
                 LLVMZigEncoding_DW_ATE_float());
         g->builtin_types.entry_c_long_double = entry;
-        g->primitive_type_table.put(&entry->name, entry);
+        g->primitive_type_table.put(buf_intern(&entry->name), entry);
     }
     {
-        TypeTableEntry *entry = new_type_table_entry(TypeTableEntryIdVoid);
+        TypeTableEntry *entry = new_type_table_entry(g, TypeTableEntryIdVoid);
         entry->type_ref = LLVMVoidType();
         entry->zero_bits = true;
         buf_init_from_str(&entry->name, "void");
@@ -3481,31 +3531,31 @@ static void define_builtin_types(CodeGen *g) {
                 0,
                 LLVMZigEncoding_DW_ATE_unsigned());
         g->builtin_types.entry_void = entry;
-        g->primitive_type_table.put(&entry->name, entry);
+        g->primitive_type_table.put(buf_intern(&entry->name), entry);
     }
     {
-        TypeTableEntry *entry = new_type_table_entry(TypeTableEntryIdUnreachable);
+        TypeTableEntry *entry = new_type_table_entry(g, TypeTableEntryIdUnreachable);
         entry->type_ref = LLVMVoidType();
         entry->zero_bits = true;
         buf_init_from_str(&entry->name, "unreachable");
         entry->di_type = g->builtin_types.entry_void->di_type;
         g->builtin_types.entry_unreachable = entry;
-        g->primitive_type_table.put(&entry->name, entry);
+        g->primitive_type_table.put(buf_intern(&entry->name), entry);
     }
     {
-        TypeTableEntry *entry = new_type_table_entry(TypeTableEntryIdMetaType);
+        TypeTableEntry *entry = new_type_table_entry(g, TypeTableEntryIdMetaType);
         buf_init_from_str(&entry->name, "type");
         entry->zero_bits = true;
         g->builtin_types.entry_type = entry;
-        g->primitive_type_table.put(&entry->name, entry);
+        g->primitive_type_table.put(buf_intern(&entry->name), entry);
     }
     {
         // partially complete the error type. we complete it later after we know
         // error_value_count.
-        TypeTableEntry *entry = new_type_table_entry(TypeTableEntryIdPureError);
+        TypeTableEntry *entry = new_type_table_entry(g, TypeTableEntryIdPureError);
         buf_init_from_str(&entry->name, "error");
         g->builtin_types.entry_pure_error = entry;
-        g->primitive_type_table.put(&entry->name, entry);
+        g->primitive_type_table.put(buf_intern(&entry->name), entry);
     }
 
     g->builtin_types.entry_u8 = get_int_type(g, false, 8);
@@ -3518,7 +3568,7 @@ static void define_builtin_types(CodeGen *g) {
     g->builtin_types.entry_i64 = get_int_type(g, true, 64);
 
     {
-        TypeTableEntry *entry = new_type_table_entry(TypeTableEntryIdEnum);
+        TypeTableEntry *entry = new_type_table_entry(g, TypeTableEntryIdEnum);
         entry->zero_bits = true; // only allowed at compile time
         buf_init_from_str(&entry->name, "@OS");
         uint32_t field_count = target_os_count();
@@ -3543,7 +3593,7 @@ static void define_builtin_types(CodeGen *g) {
     }
 
     {
-        TypeTableEntry *entry = new_type_table_entry(TypeTableEntryIdEnum);
+        TypeTableEntry *entry = new_type_table_entry(g, TypeTableEntryIdEnum);
         entry->zero_bits = true; // only allowed at compile time
         buf_init_from_str(&entry->name, "@Arch");
         uint32_t field_count = target_arch_count();
@@ -3574,7 +3624,7 @@ static void define_builtin_types(CodeGen *g) {
     }
 
     {
-        TypeTableEntry *entry = new_type_table_entry(TypeTableEntryIdEnum);
+        TypeTableEntry *entry = new_type_table_entry(g, TypeTableEntryIdEnum);
         entry->zero_bits = true; // only allowed at compile time
         buf_init_from_str(&entry->name, "@Environ");
         uint32_t field_count = target_environ_count();
@@ -3753,25 +3803,34 @@ static void init(CodeGen *g, Buf *source_path) {
 
 }
 
-void codegen_parseh(CodeGen *g, Buf *src_dirname, Buf *src_basename, Buf *source_code) {
-    find_libc_include_path(g);
-    Buf *full_path = buf_alloc();
-    os_path_join(src_dirname, src_basename, full_path);
-
+static ImportTableEntry *create_parseh_import(CodeGen *g, Buf *src_dirname, Buf *src_basename,
+        Buf *full_path)
+{
     ImportTableEntry *import = allocate<ImportTableEntry>(1);
-    import->source_code = source_code;
     import->path = full_path;
+    import->arena = arena_create();
     import->fn_table.init(32);
     import->type_table.init(8);
     import->error_table.init(8);
-    g->root_import = import;
+    import->di_file = LLVMZigCreateFile(g->dbuilder, buf_ptr(src_basename), buf_ptr(src_dirname));
+    return import;
+}
+
+void codegen_parseh(CodeGen *g, Buf *src_dirname, Buf *src_basename, Buf *source_code) {
+    find_libc_include_path(g);
+    Buf *full_path = buf_alloc();
+    os_path_join(src_dirname, src_basename, full_path);
 
     init(g, full_path);
 
-    import->di_file = LLVMZigCreateFile(g->dbuilder, buf_ptr(src_basename), buf_ptr(src_dirname));
+    ImportTableEntry *import = create_parseh_import(g, src_dirname, src_basename, full_path);
+    import->source_code = source_code;
+    g->root_import = import;
 
     ZigList<ErrorMsg *> errors = {0};
+    timing_begin(g->timing, "c_import", full_path);
     int err = parse_h_buf(import, &errors, source_code, g, nullptr);
+    timing_end(g->timing);
     if (err) {
         fprintf(stderr, "unable to parse .h file: %s\n", err_str(err));
         exit(1);
@@ -3786,6 +3845,114 @@ void codegen_parseh(CodeGen *g, Buf *src_dirname, Buf *src_basename, Buf *source
     }
 }
 
+struct ParseHBatchEntry {
+    Buf *header_path;
+    Buf *out_path;
+    ImportTableEntry *import;
+    ParseHJob *job;
+};
+
+static void begin_parseh_batch_entry(CodeGen *g, ParseHBatchEntry *entry) {
+    Buf dirname = BUF_INIT;
+    Buf basename = BUF_INIT;
+    os_path_split(entry->header_path, &dirname, &basename);
+    entry->import = create_parseh_import(g, &dirname, &basename, entry->header_path);
+    entry->job = parse_h_file_begin(entry->import, buf_ptr(entry->header_path), g, nullptr);
+}
+
+static void split_words(const char *ptr, const char *end, ZigList<Buf *> *out_words) {
+    while (ptr < end) {
+        if (*ptr == ' ' || *ptr == '\t' || *ptr == '\r') {
+            ptr += 1;
+            continue;
+        }
+        const char *word = ptr;
+        while (ptr < end && *ptr != ' ' && *ptr != '\t' && *ptr != '\r') {
+            ptr += 1;
+        }
+        out_words->append(buf_create_from_mem(word, ptr - word));
+    }
+}
+
+// Each line of the manifest is a header followed by the file to write its
+// zig declarations to. The target, the LLVM setup and the CodeGen are made
+// once for all of them. Clang parses up to job_count headers at once, each
+// on a thread of its own, while the results are translated and written
+// here in manifest order. Returns how many headers failed.
+int codegen_parseh_batch(CodeGen *g, Buf *manifest_path, Buf *manifest, int job_count) {
+    find_libc_include_path(g);
+    init(g, manifest_path);
+
+    ZigList<ParseHBatchEntry> entries = {0};
+    const char *ptr = buf_ptr(manifest);
+    const char *end = ptr + buf_len(manifest);
+    int line = 1;
+    while (ptr < end) {
+        const char *line_end = (const char *)memchr(ptr, '\n', end - ptr);
+        if (!line_end)
+            line_end = end;
+
+        ZigList<Buf *> words = {0};
+        split_words(ptr, line_end, &words);
+        if (words.length == 2) {
+            entries.add_one();
+            ParseHBatchEntry *entry = &entries.last();
+            entry->header_path = words.at(0);
+            entry->out_path = words.at(1);
+        } else if (words.length != 0) {
+            fprintf(stderr, "%s:%d: expected a header and an output path\n", buf_ptr(manifest_path), line);
+            exit(1);
+        }
+        words.deinit();
+        ptr = line_end + 1;
+        line += 1;
+    }
+
+    int next_begin = 0;
+    int failed_count = 0;
+    for (int i = 0; i < entries.length; i += 1) {
+        // keep job_count headers parsing, counting the one we wait for next
+        while (next_begin < entries.length && next_begin < i + job_count) {
+            begin_parseh_batch_entry(g, &entries.at(next_begin));
+            next_begin += 1;
+        }
+
+        ParseHBatchEntry *entry = &entries.at(i);
+        ZigList<ErrorMsg *> errors = {0};
+        timing_begin(g->timing, "c_import", entry->header_path);
+        int err = parse_h_finish(entry->job, &errors);
+        timing_end(g->timing);
+        entry->job = nullptr;
+        if (err) {
+            fprintf(stderr, "unable to parse '%s': %s\n", buf_ptr(entry->header_path), err_str(err));
+            failed_count += 1;
+            continue;
+        }
+        if (errors.length > 0) {
+            for (int j = 0; j < errors.length; j += 1) {
+                print_err_msg(errors.at(j), g->err_color);
+            }
+            failed_count += 1;
+            continue;
+        }
+
+        FILE *f = fopen(buf_ptr(entry->out_path), "wb");
+        if (!f) {
+            fprintf(stderr, "unable to open '%s': %s\n", buf_ptr(entry->out_path), strerror(errno));
+            failed_count += 1;
+            continue;
+        }
+        ast_render(f, entry->import->root, 4);
+        if (fclose(f)) {
+            fprintf(stderr, "unable to write '%s': %s\n", buf_ptr(entry->out_path), strerror(errno));
+            failed_count += 1;
+        }
+    }
+
+    entries.deinit();
+    return failed_count;
+}
+
 void codegen_render_ast(CodeGen *g, FILE *f, int indent_size) {
     ast_render(stdout, g->root_import->root, 4);
 }
@@ -3832,7 +3999,9 @@ static ImportTableEntry *codegen_add_code(CodeGen *g, Buf *abs_full_path,
     }
 
     Tokenization tokenization = {0};
+    timing_begin(g->timing, "tokenize", full_path);
     tokenize(source_code, &tokenization);
+    timing_end(g->timing);
 
     if (tokenization.err) {
         ErrorMsg *err = err_msg_create_with_line(full_path, tokenization.err_line, tokenization.err_column,
@@ -3853,12 +4022,15 @@ static ImportTableEntry *codegen_add_code(CodeGen *g, Buf *abs_full_path,
     import_entry->source_code = source_code;
     import_entry->line_offsets = tokenization.line_offsets;
     import_entry->path = full_path;
+    import_entry->arena = arena_create();
     import_entry->fn_table.init(32);
     import_entry->type_table.init(8);
     import_entry->error_table.init(8);
 
+    timing_begin(g->timing, "parse", full_path);
     import_entry->root = ast_parse(source_code, tokenization.tokens, import_entry, g->err_color,
             &g->next_node_index);
+    timing_end(g->timing);
     assert(import_entry->root);
     if (g->verbose) {
         ast_print(stderr, import_entry->root, 0);
@@ -3867,11 +4039,13 @@ static ImportTableEntry *codegen_add_code(CodeGen *g, Buf *abs_full_path,
     import_entry->di_file = LLVMZigCreateFile(g->dbuilder, buf_ptr(src_basename), buf_ptr(src_dirname));
     g->import_table.put(abs_full_path, import_entry);
 
-    import_entry->block_context = new_block_context(import_entry->root, nullptr);
+    import_entry->block_context = new_block_context(g, import_entry->root, nullptr);
     import_entry->block_context->di_scope = LLVMZigFileToScope(import_entry->di_file);
 
 
     assert(import_entry->root->type == NodeTypeRoot);
+    // most top level declarations are functions; size the table once up front
+    import_entry->fn_table.reserve(import_entry->root->data.root.top_level_decls.length);
     for (int decl_i = 0; decl_i < import_entry->root->data.root.top_level_decls.length; decl_i += 1) {
         AstNode *top_level_decl = import_entry->root->data.root.top_level_decls.at(decl_i);
 
@@ -3959,7 +4133,7 @@ static ImportTableEntry *codegen_add_code(CodeGen *g, Buf *abs_full_path,
                     found_it = true;
                     top_level_decl->data.import.import = entry->value;
                 } else {
-                    if ((err = os_fetch_file_path(abs_full_path, import_code))) {
+                    if ((err = os_map_file_path(abs_full_path, import_code))) {
                         if (err == ErrorFileNotFound) {
                             continue;
                         } else {
@@ -3983,7 +4157,7 @@ static ImportTableEntry *codegen_add_code(CodeGen *g, Buf *abs_full_path,
         } else if (top_level_decl->type == NodeTypeFnDef) {
             AstNode *proto_node = top_level_decl->data.fn_def.fn_proto;
             assert(proto_node->type == NodeTypeFnProto);
-            Buf *proto_name = &proto_node->data.fn_proto.name;
+            Buf *proto_name = proto_node->data.fn_proto.name;
 
             bool is_private = (proto_node->data.fn_proto.visib_mod == VisibModPrivate);
 
@@ -4009,13 +4183,179 @@ static ImportTableEntry *add_special_code(CodeGen *g, const char *basename) {
         zig_panic("unable to open '%s': %s", buf_ptr(&path_to_code_src), err_str(err));
     }
     Buf *import_code = buf_alloc();
-    if ((err = os_fetch_file_path(abs_full_path, import_code))) {
+    if ((err = os_map_file_path(abs_full_path, import_code))) {
         zig_panic("unable to open '%s': %s", buf_ptr(&path_to_code_src), err_str(err));
     }
 
     return codegen_add_code(g, abs_full_path, std_dir, code_basename, import_code);
 }
 
+static void add_root_code_cache_key(CodeGen *g, CacheHash *ch, Buf *abs_full_path, Buf *source_code) {
+    cache_compiler_id(ch);
+    cache_buf(ch, abs_full_path);
+    cache_buf(ch, source_code);
+    cache_buf(ch, &g->triple_str);
+    cache_bool(ch, g->is_native_target);
+    if (g->is_native_target) {
+        cache_str(ch, LLVMZigGetHostCPUName());
+        cache_str(ch, LLVMZigGetNativeFeatures());
+        char *parseh_cflags = getenv("ZIG_NATIVE_PARSEH_CFLAGS");
+        cache_str(ch, parseh_cflags ? parseh_cflags : "");
+    }
+    cache_int(ch, g->out_type);
+    cache_buf(ch, g->root_out_name);
+    cache_bool(ch, g->link_libc);
+    cache_bool(ch, g->is_release_build);
+    cache_bool(ch, g->is_test_build);
+    cache_bool(ch, g->strip_debug_symbols);
+    cache_bool(ch, g->is_static);
+    // the number of objects in the cache depends on it
+    cache_int(ch, g->codegen_threads);
+    // whether a macro the code uses exists depends on it
+    cache_int(ch, g->c_macros);
+    cache_buf(ch, g->libc_include_dir);
+    cache_int(ch, g->clang_argv_len);
+    for (int i = 0; i < g->clang_argv_len; i += 1) {
+        cache_str(ch, g->clang_argv[i]);
+    }
+    cache_buf(ch, g->mmacosx_version_min);
+    cache_buf(ch, g->mios_version_min);
+}
+
+// Everything codegen_link needs to know which is otherwise learned by
+// analyzing the root export declaration.
+static Buf *serialize_link_info(CodeGen *g) {
+    Buf *contents = buf_alloc();
+    buf_appendf(contents, "out_type %d\n", (int)g->out_type);
+    buf_appendf(contents, "version %d %d %d\n", g->version_major, g->version_minor, g->version_patch);
+    buf_appendf(contents, "link_libc %d\n", g->link_libc ? 1 : 0);
+    buf_appendf(contents, "out_name %s\n", buf_ptr(g->root_out_name));
+    for (int i = 0; i < g->link_libs.length; i += 1) {
+        buf_appendf(contents, "link_lib %s\n", buf_ptr(g->link_libs.at(i)));
+    }
+    return contents;
+}
+
+static bool parse_link_info(CodeGen *g, Buf *contents) {
+    int out_type;
+    int version_major, version_minor, version_patch;
+    int link_libc;
+    int name_start = -1;
+    if (sscanf(buf_ptr(contents), "out_type %d\nversion %d %d %d\nlink_libc %d\nout_name %n",
+                &out_type, &version_major, &version_minor, &version_patch, &link_libc, &name_start) != 5 ||
+        name_start < 0)
+    {
+        return false;
+    }
+    ZigList<Buf *> lines = {0};
+    char *ptr = buf_ptr(contents) + name_start;
+    char *end = buf_ptr(contents) + buf_len(contents);
+    while (ptr < end) {
+        char *line_end = (char *)memchr(ptr, '\n', end - ptr);
+        if (!line_end)
+            return false;
+        lines.append(buf_create_from_mem(ptr, line_end - ptr));
+        ptr = line_end + 1;
+    }
+    if (lines.length == 0)
+        return false;
+
+    ZigList<Buf *> link_libs = {0};
+    for (int i = 1; i < lines.length; i += 1) {
+        Buf *line = lines.at(i);
+        if (!buf_starts_with_buf(line, buf_create_from_str("link_lib "))) {
+            link_libs.deinit();
+            return false;
+        }
+        link_libs.append(buf_slice(line, strlen("link_lib "), buf_len(line)));
+    }
+
+    g->out_type = (OutType)out_type;
+    g->version_major = version_major;
+    g->version_minor = version_minor;
+    g->version_patch = version_patch;
+    g->link_libc = (link_libc != 0);
+    g->root_out_name = lines.at(0);
+    // the saved list is every library of the build which saved it, the ones
+    // we already have included, so it replaces ours rather than adding to it
+    g->link_libs.deinit();
+    g->link_libs = link_libs;
+    lines.deinit();
+    return true;
+}
+
+static bool check_root_code_cache(CodeGen *g, Buf *abs_full_path, Buf *source_code) {
+    CacheHash *ch = allocate<CacheHash>(1);
+    cache_init(ch, g->cache_dir);
+    add_root_code_cache_key(g, ch, abs_full_path, source_code);
+
+    bool hit;
+    if (cache_hit(ch, &hit)) {
+        return false;
+    }
+    g->cache_hash = ch;
+    if (!hit) {
+        return false;
+    }
+
+    Buf link_info = BUF_INIT;
+    if (os_fetch_file_path(cache_artifact_path(ch, "link_info"), &link_info) ||
+        !parse_link_info(g, &link_info))
+    {
+        // the dependencies listed in the manifest belong to the build we're
+        // not going to reuse; codegen_cache_final records our own
+        ch->files.clear();
+        return false;
+    }
+
+    g->cache_hit = true;
+    if (g->verbose) {
+        fprintf(stderr, "\nusing cached %s\n", buf_ptr(&ch->artifact_dir));
+    }
+    return true;
+}
+
+void codegen_cache_final(CodeGen *g) {
+    CacheHash *ch = g->cache_hash;
+    assert(ch);
+    assert(!g->cache_hit);
+
+    auto it = g->import_table.entry_iterator();
+    for (;;) {
+        auto *entry = it.next();
+        if (!entry)
+            break;
+
+        cache_add_file(ch, entry->key, entry->value->source_code);
+    }
+
+    int err;
+    for (int i = 0; i < g->c_import_files.length; i += 1) {
+        if ((err = cache_add_file_path(ch, g->c_import_files.at(i)))) {
+            // we can't tell whether this header changes, so leave the
+            // manifest out and this cache entry will never be used
+            return;
+        }
+    }
+
+    Buf *link_info_path = cache_artifact_path(ch, "link_info");
+    Buf *tmp_path = cache_tmp_path(link_info_path);
+    if ((err = os_write_file_path(tmp_path, serialize_link_info(g))) ||
+        (err = os_rename(tmp_path, link_info_path)))
+    {
+        // without link info a manifest hit can't be used anyway
+        os_delete_file(tmp_path);
+        if (g->verbose) {
+            fprintf(stderr, "unable to write %s: %s\n", buf_ptr(link_info_path), err_str(err));
+        }
+        return;
+    }
+
+    if ((err = cache_final(ch)) && g->verbose) {
+        fprintf(stderr, "unable to write cache manifest: %s\n", err_str(err));
+    }
+}
+
 void codegen_add_root_code(CodeGen *g, Buf *src_dir, Buf *src_basename, Buf *source_code) {
     Buf source_path = BUF_INIT;
     os_path_join(src_dir, src_basename, &source_path);
@@ -4027,6 +4367,10 @@ void codegen_add_root_code(CodeGen *g, Buf *src_dir, Buf *src_basename, Buf *sou
         zig_panic("unable to open '%s': %s", buf_ptr(&source_path), err_str(err));
     }
 
+    if (g->enable_cache && check_root_code_cache(g, abs_full_path, source_code)) {
+        return;
+    }
+
     g->root_import = codegen_add_code(g, abs_full_path, src_dir, src_basename, source_code);
 
     if (!g->root_out_name) {
@@ -4048,7 +4392,9 @@ void codegen_add_root_code(CodeGen *g, Buf *src_dir, Buf *src_basename, Buf *sou
         fprintf(stderr, "--------------------\n");
     }
     if (!g->error_during_imports) {
+        timing_begin(g->timing, "semantic analysis", nullptr);
         semantic_analyze(g);
+        timing_end(g->timing);
     }
 
     if (g->errors.length == 0) {
@@ -4068,7 +4414,24 @@ void codegen_add_root_code(CodeGen *g, Buf *src_dir, Buf *src_basename, Buf *sou
         fprintf(stderr, "------------------\n");
     }
 
+    timing_begin(g->timing, "code generation", nullptr);
     do_code_gen(g);
+    timing_end(g->timing);
+}
+
+void codegen_finish_timing(CodeGen *g) {
+    if (g->trace_out) {
+        int err;
+        if ((err = timing_write_trace(g->timing, g->trace_out))) {
+            fprintf(stderr, "unable to write trace to '%s': %s\n", buf_ptr(g->trace_out), err_str(err));
+        }
+    }
+    if (g->time_report) {
+        timing_print_report(g->timing, stderr);
+        fprintf(stderr, "\n");
+        fflush(stderr);
+        LLVMShutdown();
+    }
 }
 
 static void to_c_type(CodeGen *g, AstNode *type_node, Buf *out_buf) {
@@ -4129,7 +4492,7 @@ void codegen_generate_h_file(CodeGen *g) {
         buf_appendf(&h_buf, "%s %s %s(",
                 buf_ptr(export_macro),
                 buf_ptr(&return_type_c),
-                buf_ptr(&fn_proto->name));
+                buf_ptr(fn_proto->name));
 
         Buf param_type_c = BUF_INIT;
         if (fn_proto->params.length) {
@@ -4139,7 +4502,7 @@ void codegen_generate_h_file(CodeGen *g) {
                 to_c_type(g, param_type, &param_type_c);
                 buf_appendf(&h_buf, "%s %s",
                         buf_ptr(&param_type_c),
-                        buf_ptr(&param_decl_node->data.param_decl.name));
+                        buf_ptr(param_decl_node->data.param_decl.name));
                 if (param_i < fn_proto->params.length - 1)
                     buf_appendf(&h_buf, ", ");
             }
@@ -38,12 +38,26 @@ void codegen_set_mlinker_version(CodeGen *g, Buf *darwin_linker_version);
 void codegen_set_rdynamic(CodeGen *g, bool rdynamic);
 void codegen_set_mmacosx_version_min(CodeGen *g, Buf *mmacosx_version_min);
 void codegen_set_mios_version_min(CodeGen *g, Buf *mios_version_min);
+void codegen_set_enable_cache(CodeGen *g, bool enable_cache);
+void codegen_set_cache_dir(CodeGen *g, Buf *cache_dir);
+void codegen_set_time_report(CodeGen *g, bool time_report);
+void codegen_set_trace_out(CodeGen *g, Buf *trace_out);
+void codegen_set_use_lld(CodeGen *g, bool use_lld);
+void codegen_set_codegen_threads(CodeGen *g, int codegen_threads);
+void codegen_set_c_macros(CodeGen *g, CMacros c_macros);
 
 void codegen_add_root_code(CodeGen *g, Buf *source_dir, Buf *source_basename, Buf *source_code);
+void codegen_cache_final(CodeGen *g);
 
 void codegen_parseh(CodeGen *g, Buf *src_dirname, Buf *src_basename, Buf *source_code);
+int codegen_parseh_batch(CodeGen *g, Buf *manifest_path, Buf *manifest, int job_count);
 void codegen_render_ast(CodeGen *g, FILE *f, int indent_size);
 
 void codegen_generate_h_file(CodeGen *g);
 
+// writes the trace and prints the time report, if they were asked for.
+// printing the LLVM pass timings requires shutting LLVM down, so this must
+// be the last thing done with g
+void codegen_finish_timing(CodeGen *g);
+
 #endif
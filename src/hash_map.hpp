@@ -16,25 +16,32 @@ template<typename K, typename V, uint32_t (*HashFunction)(K key), bool (*EqualFn
 class HashMap {
 public:
     void init(int capacity) {
-        init_capacity(capacity);
+        int power_of_two = 1;
+        while (power_of_two < capacity) {
+            power_of_two *= 2;
+        }
+        init_capacity(power_of_two);
     }
     void deinit(void) {
         free(_entries);
     }
 
     struct Entry {
-        bool used;
-        int distance_from_start_index;
         K key;
         V value;
+        // the result of HashFunction(key), kept so that probing can skip
+        // most EqualFn calls and growing never needs to hash again
+        uint32_t hash;
+        // 0 for an unused slot, otherwise the distance from the slot that
+        // hash maps to plus one
+        uint32_t probe;
     };
 
     void clear() {
         for (int i = 0; i < _capacity; i += 1) {
-            _entries[i].used = false;
+            _entries[i].probe = 0;
         }
         _size = 0;
-        _max_distance_from_start_index = 0;
         _modification_count += 1;
     }
 
@@ -42,22 +49,20 @@ public:
         return _size;
     }
 
+    // make sure that count entries fit without the table having to grow
+    void reserve(int count) {
+        int new_capacity = capacity_for_count(count);
+        if (new_capacity > _capacity)
+            grow(new_capacity);
+    }
+
     void put(const K &key, const V &value) {
         _modification_count += 1;
-        internal_put(key, value);
+        internal_put(key, HashFunction(key), value);
 
         // if we get too full (80%), double the capacity
         if (_size * 5 >= _capacity * 4) {
-            Entry *old_entries = _entries;
-            int old_capacity = _capacity;
-            init_capacity(_capacity * 2);
-            // dump all of the old elements into the new table
-            for (int i = 0; i < old_capacity; i += 1) {
-                Entry *old_entry = &old_entries[i];
-                if (old_entry->used)
-                    internal_put(old_entry->key, old_entry->value);
-            }
-            free(old_entries);
+            grow(_capacity * 2);
         }
     }
 
@@ -73,39 +78,19 @@ public:
     }
 
     void maybe_remove(const K &key) {
-        if (maybe_get(key)) {
-            remove(key);
+        Entry *entry = internal_get(key);
+        if (entry) {
+            _modification_count += 1;
+            remove_entry(entry);
         }
     }
 
     void remove(const K &key) {
+        Entry *entry = internal_get(key);
+        if (!entry)
+            zig_panic("key not found");
         _modification_count += 1;
-        int start_index = key_to_index(key);
-        for (int roll_over = 0; roll_over <= _max_distance_from_start_index; roll_over += 1) {
-            int index = (start_index + roll_over) % _capacity;
-            Entry *entry = &_entries[index];
-
-            if (!entry->used)
-                zig_panic("key not found");
-
-            if (!EqualFn(entry->key, key))
-                continue;
-
-            for (; roll_over < _capacity; roll_over += 1) {
-                int next_index = (start_index + roll_over + 1) % _capacity;
-                Entry *next_entry = &_entries[next_index];
-                if (!next_entry->used || next_entry->distance_from_start_index == 0) {
-                    entry->used = false;
-                    _size -= 1;
-                    return;
-                }
-                *entry = *next_entry;
-                entry->distance_from_start_index -= 1;
-                entry = next_entry;
-            }
-            zig_panic("shifting everything in the table");
-        }
-        zig_panic("key not found");
+        remove_entry(entry);
     }
 
     class Iterator {
@@ -117,7 +102,7 @@ public:
                 return NULL;
             for (; _index < _table->_capacity; _index += 1) {
                 Entry *entry = &_table->_entries[_index];
-                if (entry->used) {
+                if (entry->probe) {
                     _index += 1;
                     _count += 1;
                     return entry;
@@ -147,86 +132,107 @@ public:
 private:
 
     Entry *_entries;
+    // always a power of two, so that _capacity - 1 can be used as a mask
     int _capacity;
     int _size;
-    int _max_distance_from_start_index;
     // this is used to detect bugs where a hashtable is edited while an iterator is running.
     uint32_t _modification_count;
 
+    // smallest power of two capacity which holds count entries below 80% full
+    static int capacity_for_count(int count) {
+        int capacity = 1;
+        while (count * 5 >= capacity * 4) {
+            capacity *= 2;
+        }
+        return capacity;
+    }
+
     void init_capacity(int capacity) {
+        assert((capacity & (capacity - 1)) == 0);
         _capacity = capacity;
         _entries = allocate<Entry>(_capacity);
         _size = 0;
-        _max_distance_from_start_index = 0;
-        for (int i = 0; i < _capacity; i += 1) {
-            _entries[i].used = false;
+    }
+
+    void grow(int new_capacity) {
+        Entry *old_entries = _entries;
+        int old_capacity = _capacity;
+        init_capacity(new_capacity);
+        // dump all of the old elements into the new table
+        for (int i = 0; i < old_capacity; i += 1) {
+            Entry *old_entry = &old_entries[i];
+            if (old_entry->probe)
+                internal_put(old_entry->key, old_entry->hash, old_entry->value);
         }
+        free(old_entries);
     }
 
-    void internal_put(K key, V value) {
-        int start_index = key_to_index(key);
-        for (int roll_over = 0, distance_from_start_index = 0;
-                roll_over < _capacity; roll_over += 1, distance_from_start_index += 1)
-        {
-            int index = (start_index + roll_over) % _capacity;
+    void internal_put(K key, uint32_t hash, V value) {
+        uint32_t mask = (uint32_t)_capacity - 1;
+        uint32_t index = hash & mask;
+        for (uint32_t probe = 1; probe <= (uint32_t)_capacity; probe += 1, index = (index + 1) & mask) {
             Entry *entry = &_entries[index];
 
-            if (entry->used && !EqualFn(entry->key, key)) {
-                if (entry->distance_from_start_index < distance_from_start_index) {
-                    // robin hood to the rescue
-                    Entry tmp = *entry;
-                    if (distance_from_start_index > _max_distance_from_start_index)
-                        _max_distance_from_start_index = distance_from_start_index;
-                    *entry = {
-                        true,
-                        distance_from_start_index,
-                        key,
-                        value,
-                    };
-                    key = tmp.key;
-                    value = tmp.value;
-                    distance_from_start_index = tmp.distance_from_start_index;
-                }
-                continue;
+            if (!entry->probe) {
+                // adding an entry
+                _size += 1;
+                *entry = {key, value, hash, probe};
+                return;
             }
 
-            if (!entry->used) {
-                // adding an entry. otherwise overwriting old value with
-                // same key
-                _size += 1;
+            if (entry->hash == hash && EqualFn(entry->key, key)) {
+                // overwriting old value with same key
+                entry->value = value;
+                return;
             }
 
-            if (distance_from_start_index > _max_distance_from_start_index)
-                _max_distance_from_start_index = distance_from_start_index;
-            *entry = {
-                true,
-                distance_from_start_index,
-                key,
-                value,
-            };
-            return;
+            if (entry->probe < probe) {
+                // robin hood to the rescue
+                Entry tmp = *entry;
+                *entry = {key, value, hash, probe};
+                key = tmp.key;
+                value = tmp.value;
+                hash = tmp.hash;
+                probe = tmp.probe;
+            }
         }
         zig_panic("put into a full HashMap");
     }
 
-
     Entry *internal_get(const K &key) const {
-        int start_index = key_to_index(key);
-        for (int roll_over = 0; roll_over <= _max_distance_from_start_index; roll_over += 1) {
-            int index = (start_index + roll_over) % _capacity;
+        uint32_t hash = HashFunction(key);
+        uint32_t mask = (uint32_t)_capacity - 1;
+        uint32_t index = hash & mask;
+        for (uint32_t probe = 1;; probe += 1, index = (index + 1) & mask) {
             Entry *entry = &_entries[index];
 
-            if (!entry->used)
+            // entries are ordered by distance, so once we see one which is
+            // closer to its home slot than we are to ours, the key is absent
+            if (entry->probe < probe)
                 return NULL;
 
-            if (EqualFn(entry->key, key))
+            if (entry->hash == hash && EqualFn(entry->key, key))
                 return entry;
         }
-        return NULL;
     }
 
-    int key_to_index(const K &key) const {
-        return (int)(HashFunction(key) % ((uint32_t)_capacity));
+    // backward shift deletion: pull each following displaced entry one slot
+    // closer to its home slot until we hit an empty slot or one already home
+    void remove_entry(Entry *entry) {
+        uint32_t mask = (uint32_t)_capacity - 1;
+        uint32_t index = (uint32_t)(entry - _entries);
+        for (;;) {
+            uint32_t next_index = (index + 1) & mask;
+            Entry *next_entry = &_entries[next_index];
+            if (next_entry->probe <= 1) {
+                _entries[index].probe = 0;
+                _size -= 1;
+                return;
+            }
+            _entries[index] = *next_entry;
+            _entries[index].probe -= 1;
+            index = next_index;
+        }
     }
 };
 
@@ -10,6 +10,8 @@
 #include "config.h"
 #include "codegen.hpp"
 #include "analyze.hpp"
+#include "cache_hash.hpp"
+#include "error.hpp"
 
 struct LinkJob {
     CodeGen *codegen;
@@ -17,6 +19,12 @@ struct LinkJob {
     ZigList<const char *> args;
     bool link_in_crt;
     Buf out_file_o;
+    // paths of the objects produced from the root module. more than one with
+    // --codegen-threads
+    ZigList<Buf *> objects;
+    // objects written only so that the linker can read them, deleted
+    // once linking is done
+    ZigList<Buf *> tmp_files;
 };
 
 static const char *get_libc_file(CodeGen *g, const char *file) {
@@ -31,10 +39,62 @@ static const char *get_libc_static_file(CodeGen *g, const char *file) {
     return buf_ptr(out_buf);
 }
 
-static Buf *build_o(CodeGen *parent_gen, const char *oname) {
+static void add_build_o_cache_key(CacheHash *ch, CodeGen *parent_gen, const char *oname, Buf *source_code) {
+    cache_compiler_id(ch);
+    cache_str(ch, oname);
+    cache_buf(ch, source_code);
+    cache_buf(ch, &parent_gen->triple_str);
+    cache_bool(ch, parent_gen->is_native_target);
+    if (parent_gen->is_native_target) {
+        // native builds are tuned for the host CPU
+        cache_str(ch, LLVMZigGetHostCPUName());
+        cache_str(ch, LLVMZigGetNativeFeatures());
+    }
+    cache_bool(ch, parent_gen->link_libc);
+    cache_bool(ch, parent_gen->is_release_build);
+    cache_bool(ch, parent_gen->strip_debug_symbols);
+    cache_bool(ch, parent_gen->is_static);
+    cache_buf(ch, parent_gen->mmacosx_version_min);
+    cache_buf(ch, parent_gen->mios_version_min);
+}
+
+static Buf *build_o(LinkJob *lj, const char *oname) {
+    CodeGen *parent_gen = lj->codegen;
+    timing_begin(parent_gen->timing, "build_o", buf_create_from_str(oname));
+
     Buf *source_basename = buf_sprintf("%s.zig", oname);
     Buf *std_dir_path = buf_create_from_str(ZIG_STD_DIR);
 
+    Buf *full_path = buf_alloc();
+    os_path_join(std_dir_path, source_basename, full_path);
+    Buf source_code = BUF_INIT;
+    if (os_map_file_path(full_path, &source_code)) {
+        zig_panic("unable to fetch file: %s\n", buf_ptr(full_path));
+    }
+
+    Buf *o_out = buf_sprintf("%s.o", oname);
+
+    CacheHash ch = {0};
+    bool use_cache = parent_gen->enable_cache;
+    if (use_cache) {
+        cache_init(&ch, parent_gen->cache_dir);
+        add_build_o_cache_key(&ch, parent_gen, oname, &source_code);
+
+        bool hit;
+        if (cache_hit(&ch, &hit)) {
+            use_cache = false;
+        } else {
+            o_out = cache_artifact_path(&ch, buf_ptr(o_out));
+            if (hit) {
+                if (parent_gen->verbose) {
+                    fprintf(stderr, "\nusing cached %s\n", buf_ptr(o_out));
+                }
+                timing_end(parent_gen->timing);
+                return o_out;
+            }
+        }
+    }
+
     ZigTarget *child_target = parent_gen->is_native_target ? nullptr : &parent_gen->zig_target;
     CodeGen *child_gen = codegen_create(std_dir_path, child_target);
     child_gen->link_libc = parent_gen->link_libc;
@@ -52,18 +112,53 @@ static Buf *build_o(CodeGen *parent_gen, const char *oname) {
 
     codegen_set_mmacosx_version_min(child_gen, parent_gen->mmacosx_version_min);
     codegen_set_mios_version_min(child_gen, parent_gen->mios_version_min);
+    child_gen->timing = parent_gen->timing;
 
-    Buf *full_path = buf_alloc();
-    os_path_join(std_dir_path, source_basename, full_path);
-    Buf source_code = BUF_INIT;
-    if (os_fetch_file_path(full_path, &source_code)) {
-        zig_panic("unable to fetch file: %s\n", buf_ptr(full_path));
-    }
+    // build_o does its own caching of the object
+    codegen_set_enable_cache(child_gen, false);
 
     codegen_add_root_code(child_gen, std_dir_path, source_basename, &source_code);
-    Buf *o_out = buf_sprintf("%s.o", oname);
-    codegen_link(child_gen, buf_ptr(o_out));
 
+    // the object is always linked outside the cache first, so that a cache
+    // directory we can't write to only costs us the reuse
+    int err;
+    Buf *tmp_o_out = buf_alloc();
+    if ((err = os_buf_to_tmp_file(buf_create_from_str(""), buf_sprintf("-%s.o", oname), tmp_o_out))) {
+        zig_panic("unable to create temporary file: %s", err_str(err));
+    }
+    codegen_link(child_gen, buf_ptr(tmp_o_out));
+
+    if (use_cache) {
+        Buf *cache_tmp = cache_tmp_path(o_out);
+        if ((err = os_copy_file(tmp_o_out, cache_tmp)) || (err = os_rename(cache_tmp, o_out))) {
+            os_delete_file(cache_tmp);
+            if (parent_gen->verbose) {
+                fprintf(stderr, "unable to cache %s: %s\n", buf_ptr(o_out), err_str(err));
+            }
+            use_cache = false;
+        }
+    }
+    if (!use_cache) {
+        // nobody else will use this object, so it goes away with the link job
+        lj->tmp_files.append(tmp_o_out);
+        timing_end(parent_gen->timing);
+        return tmp_o_out;
+    }
+    os_delete_file(tmp_o_out);
+
+    auto it = child_gen->import_table.entry_iterator();
+    for (;;) {
+        auto *entry = it.next();
+        if (!entry)
+            break;
+
+        cache_add_file(&ch, entry->key, entry->value->source_code);
+    }
+    if ((err = cache_final(&ch)) && parent_gen->verbose) {
+        fprintf(stderr, "unable to write cache manifest: %s\n", err_str(err));
+    }
+
+    timing_end(parent_gen->timing);
     return o_out;
 }
 
@@ -220,19 +315,21 @@ static void construct_linker_job_linux(LinkJob *lj) {
     }
 
     // .o files
-    lj->args.append((const char *)buf_ptr(&lj->out_file_o));
+    for (int i = 0; i < lj->objects.length; i += 1) {
+        lj->args.append((const char *)buf_ptr(lj->objects.at(i)));
+    }
 
     if (g->is_test_build) {
         const char *test_runner_name = g->link_libc ? "test_runner_libc" : "test_runner_nolibc";
-        Buf *test_runner_o_path = build_o(g, test_runner_name);
+        Buf *test_runner_o_path = build_o(lj, test_runner_name);
         lj->args.append(buf_ptr(test_runner_o_path));
     }
 
     if (!g->link_libc && (g->out_type == OutTypeExe || g->out_type == OutTypeLib)) {
-        Buf *builtin_o_path = build_o(g, "builtin");
+        Buf *builtin_o_path = build_o(lj, "builtin");
         lj->args.append(buf_ptr(builtin_o_path));
 
-        Buf *compiler_rt_o_path = build_o(g, "compiler_rt");
+        Buf *compiler_rt_o_path = build_o(lj, "compiler_rt");
         lj->args.append(buf_ptr(compiler_rt_o_path));
     }
 
@@ -354,19 +451,21 @@ static void construct_linker_job_mingw(LinkJob *lj) {
         lj->args.append(buf_ptr(g->libc_static_lib_dir));
     }
 
-    lj->args.append((const char *)buf_ptr(&lj->out_file_o));
+    for (int i = 0; i < lj->objects.length; i += 1) {
+        lj->args.append((const char *)buf_ptr(lj->objects.at(i)));
+    }
 
     if (g->is_test_build) {
         const char *test_runner_name = g->link_libc ? "test_runner_libc" : "test_runner_nolibc";
-        Buf *test_runner_o_path = build_o(g, test_runner_name);
+        Buf *test_runner_o_path = build_o(lj, test_runner_name);
         lj->args.append(buf_ptr(test_runner_o_path));
     }
 
     if (!g->link_libc && (g->out_type == OutTypeExe || g->out_type == OutTypeLib)) {
-        Buf *builtin_o_path = build_o(g, "builtin");
+        Buf *builtin_o_path = build_o(lj, "builtin");
         lj->args.append(buf_ptr(builtin_o_path));
 
-        Buf *compiler_rt_o_path = build_o(g, "compiler_rt");
+        Buf *compiler_rt_o_path = build_o(lj, "compiler_rt");
         lj->args.append(buf_ptr(compiler_rt_o_path));
     }
 
@@ -631,7 +730,9 @@ static void construct_linker_job_darwin(LinkJob *lj) {
         lj->args.append(lib_dir);
     }
 
-    lj->args.append((const char *)buf_ptr(&lj->out_file_o));
+    for (int i = 0; i < lj->objects.length; i += 1) {
+        lj->args.append((const char *)buf_ptr(lj->objects.at(i)));
+    }
 
     for (int i = 0; i < g->link_libs.length; i += 1) {
         Buf *link_lib = g->link_libs.at(i);
@@ -737,6 +838,275 @@ static void ensure_we_have_linker_path(CodeGen *g) {
     }
 }
 
+static void add_cache_artifact(CodeGen *g, Buf *path, const char *basename) {
+    Buf *cache_path = cache_artifact_path(g->cache_hash, basename);
+    Buf *tmp_path = cache_tmp_path(cache_path);
+    int err;
+    if ((err = os_copy_file(path, tmp_path)) || (err = os_rename(tmp_path, cache_path))) {
+        if (g->verbose) {
+            fprintf(stderr, "unable to add %s to the cache: %s\n", buf_ptr(path), err_str(err));
+        }
+        g->cache_hash = nullptr;
+    }
+}
+
+// Writes the object straight into the cache instead of copying a file there.
+// Returns null if the cache could not be written.
+static Buf *add_cache_artifact_buf(CodeGen *g, Buf *contents, const char *basename) {
+    Buf *cache_path = cache_artifact_path(g->cache_hash, basename);
+    Buf *tmp_path = cache_tmp_path(cache_path);
+    int err;
+    if ((err = os_write_file_path(tmp_path, contents)) || (err = os_rename(tmp_path, cache_path))) {
+        os_delete_file(tmp_path);
+        if (g->verbose) {
+            fprintf(stderr, "unable to add %s to the cache: %s\n", buf_ptr(cache_path), err_str(err));
+        }
+        g->cache_hash = nullptr;
+        return nullptr;
+    }
+    return cache_path;
+}
+
+static void emit_object_to_buf(CodeGen *g, Buf *out_object) {
+    char *err_msg = nullptr;
+    LLVMMemoryBufferRef mem_buf;
+    if (LLVMTargetMachineEmitToMemoryBuffer(g->target_machine, g->module, LLVMObjectFile,
+                &err_msg, &mem_buf))
+    {
+        zig_panic("unable to emit object file: %s", err_msg);
+    }
+    buf_init_from_mem(out_object, LLVMGetBufferStart(mem_buf), LLVMGetBufferSize(mem_buf));
+    LLVMDisposeMemoryBuffer(mem_buf);
+}
+
+// Splits the module into part_count modules which are optimized and emitted
+// on their own threads.
+static void emit_objects_parallel(CodeGen *g, int part_count, ZigList<Buf *> *out_objects) {
+    Buf err_msg = BUF_INIT;
+    if (!ZigLLVMEmitObjectsParallel(g->target_machine, g->module, part_count, g->is_release_build,
+                out_objects, &err_msg))
+    {
+        zig_panic("unable to emit object files: %s", buf_ptr(&err_msg));
+    }
+}
+
+static const char *cached_o_basename(int part_count, int part_index) {
+    if (part_count == 1) {
+        return "root.o";
+    }
+    return buf_ptr(buf_sprintf("root.%d.o", part_index));
+}
+
+// Puts an object where the linker can read it: in the cache if there is
+// one, otherwise in a temporary file.
+static void add_link_object(LinkJob *lj, Buf *object, const char *cache_basename) {
+    CodeGen *g = lj->codegen;
+    Buf *path = g->cache_hash ? add_cache_artifact_buf(g, object, cache_basename) : nullptr;
+    if (!path) {
+        path = buf_alloc();
+        int err;
+        if ((err = os_buf_to_tmp_file(object, buf_create_from_str(get_o_file_extension(g)), path))) {
+            zig_panic("unable to write object file: %s", err_str(err));
+        }
+        lj->tmp_files.append(path);
+    }
+    lj->objects.append(path);
+}
+
+static void delete_tmp_files(LinkJob *lj) {
+    for (int i = 0; i < lj->tmp_files.length; i += 1) {
+        os_delete_file(lj->tmp_files.at(i));
+    }
+}
+
+static void ar_append_header(Buf *archive, const char *name, int size) {
+    // the timestamp, owner and group are left 0 so that archives are
+    // reproducible
+    buf_appendf(archive, "%-16s%-12d%-6d%-6d%-8o%-10d`\n", name, 0, 0, 0, 0644, size);
+}
+
+static void ar_append_u32_be(Buf *archive, uint32_t x) {
+    uint8_t bytes[4] = {(uint8_t)(x >> 24), (uint8_t)(x >> 16), (uint8_t)(x >> 8), (uint8_t)x};
+    buf_append_mem(archive, (const char *)bytes, 4);
+}
+
+static void ar_append_member(Buf *archive, const char *name, Buf *contents) {
+    ar_append_header(archive, name, buf_len(contents));
+    buf_append_buf(archive, contents);
+    // members start on even offsets
+    if (buf_len(contents) % 2 != 0) {
+        buf_append_char(archive, '\n');
+    }
+}
+
+struct ArMember {
+    Buf *name;
+    Buf *header_name;
+    Buf *contents;
+    ZigList<Buf *> symbols;
+    int offset;
+};
+
+static void add_ar_member(ZigList<ArMember> *members, Buf *name, Buf *contents) {
+    members->add_one();
+    ArMember *member = &members->last();
+    memset(member, 0, sizeof(ArMember));
+    member->name = name;
+    member->contents = contents;
+    if (!ZigLLVMGetObjectSymbols(contents, &member->symbols)) {
+        zig_panic("unable to read the symbols of %s", buf_ptr(name));
+    }
+}
+
+// Writes a static library in the GNU/System V ar format, with a symbol index
+// so that linkers need not run ranlib on it.
+static void write_static_lib(LinkJob *lj, Buf *object) {
+    CodeGen *g = lj->codegen;
+
+    buf_resize(&lj->out_file, 0);
+    buf_appendf(&lj->out_file, "lib%s.a", buf_ptr(g->root_out_name));
+
+    const char *o_ext = get_o_file_extension(g);
+    ZigList<ArMember> members = {0};
+    add_ar_member(&members, buf_sprintf("%s%s", buf_ptr(g->root_out_name), o_ext), object);
+
+    // without libc, whoever links the library needs the same builtin and
+    // compiler_rt objects an executable or shared library gets linked with
+    if (!g->link_libc) {
+        const char *onames[] = {"builtin", "compiler_rt"};
+        for (int i = 0; i < 2; i += 1) {
+            Buf *o_path = build_o(lj, onames[i]);
+            Buf *contents = buf_alloc();
+            int err;
+            if ((err = os_fetch_file_path(o_path, contents))) {
+                zig_panic("unable to read %s: %s", buf_ptr(o_path), err_str(err));
+            }
+            add_ar_member(&members, buf_sprintf("%s%s", onames[i], o_ext), contents);
+        }
+    }
+
+    // names which do not fit in a header go in the "//" member and are
+    // referred to by their offset there
+    Buf long_names = BUF_INIT;
+    buf_resize(&long_names, 0);
+    int symbol_count = 0;
+    int symbol_names_len = 0;
+    for (int i = 0; i < members.length; i += 1) {
+        ArMember *member = &members.at(i);
+        if (buf_len(member->name) < 16) {
+            member->header_name = buf_sprintf("%s/", buf_ptr(member->name));
+        } else {
+            member->header_name = buf_sprintf("/%d", buf_len(&long_names));
+            buf_appendf(&long_names, "%s/\n", buf_ptr(member->name));
+        }
+        symbol_count += member->symbols.length;
+        for (int sym_i = 0; sym_i < member->symbols.length; sym_i += 1) {
+            symbol_names_len += buf_len(member->symbols.at(sym_i)) + 1;
+        }
+    }
+
+    int offset = 8 + 60 + 4 + 4 * symbol_count + symbol_names_len;
+    offset += offset % 2;
+    if (buf_len(&long_names) > 0) {
+        offset += 60 + buf_len(&long_names) + buf_len(&long_names) % 2;
+    }
+
+    Buf symbol_index = BUF_INIT;
+    buf_resize(&symbol_index, 0);
+    ar_append_u32_be(&symbol_index, symbol_count);
+    for (int i = 0; i < members.length; i += 1) {
+        ArMember *member = &members.at(i);
+        member->offset = offset;
+        for (int sym_i = 0; sym_i < member->symbols.length; sym_i += 1) {
+            ar_append_u32_be(&symbol_index, offset);
+        }
+        offset += 60 + buf_len(member->contents) + buf_len(member->contents) % 2;
+    }
+    for (int i = 0; i < members.length; i += 1) {
+        ArMember *member = &members.at(i);
+        for (int sym_i = 0; sym_i < member->symbols.length; sym_i += 1) {
+            Buf *symbol = member->symbols.at(sym_i);
+            buf_append_mem(&symbol_index, buf_ptr(symbol), buf_len(symbol) + 1);
+        }
+    }
+
+    Buf archive = BUF_INIT;
+    buf_init_from_str(&archive, "!<arch>\n");
+    ar_append_member(&archive, "/", &symbol_index);
+    if (buf_len(&long_names) > 0) {
+        ar_append_member(&archive, "//", &long_names);
+    }
+    for (int i = 0; i < members.length; i += 1) {
+        ArMember *member = &members.at(i);
+        assert(buf_len(&archive) == member->offset);
+        ar_append_member(&archive, buf_ptr(member->header_name), member->contents);
+    }
+
+    timing_begin(g->timing, "archive", &lj->out_file);
+    os_write_file(&lj->out_file, &archive);
+    timing_end(g->timing);
+
+    // build_o leaves its objects in temporary files when there's no cache
+    delete_tmp_files(lj);
+
+    buf_deinit(&archive);
+    buf_deinit(&symbol_index);
+    buf_deinit(&long_names);
+}
+
+static void run_linker(LinkJob *lj) {
+    CodeGen *g = lj->codegen;
+
+    lj->link_in_crt = (g->link_libc && g->out_type == OutTypeExe);
+    // other object formats still go to the external linker
+    bool use_lld = g->use_lld && g->zig_target.oformat == ZigLLVM_ELF;
+    if (!use_lld) {
+        ensure_we_have_linker_path(g);
+    }
+
+    construct_linker_job(lj);
+
+    Buf *linker_name = use_lld ? buf_create_from_str("ld.lld") : g->linker_path;
+
+    if (g->verbose) {
+        fprintf(stderr, "%s", buf_ptr(linker_name));
+        for (int i = 0; i < lj->args.length; i += 1) {
+            fprintf(stderr, " %s", lj->args.at(i));
+        }
+        fprintf(stderr, "\n");
+    }
+
+    int return_code;
+    Buf ld_stderr = BUF_INIT;
+    Buf ld_stdout = BUF_INIT;
+    timing_begin(g->timing, "link", linker_name);
+    if (use_lld) {
+        return_code = ZigLLDLinkELF(lj->args.items, lj->args.length, &ld_stderr) ? 0 : 1;
+    } else {
+        int err = os_exec_process(buf_ptr(g->linker_path), lj->args, &return_code, &ld_stderr, &ld_stdout);
+        if (err) {
+            delete_tmp_files(lj);
+            fprintf(stderr, "linker not found: '%s'\n", buf_ptr(g->linker_path));
+            exit(1);
+        }
+    }
+    timing_end(g->timing);
+
+    delete_tmp_files(lj);
+
+    if (return_code != 0) {
+        fprintf(stderr, "linker failed with return code %d\n", return_code);
+        fprintf(stderr, "%s ", buf_ptr(linker_name));
+        for (int i = 0; i < lj->args.length; i += 1) {
+            fprintf(stderr, "%s ", lj->args.at(i));
+        }
+        fprintf(stderr, "\n%s\n", buf_ptr(&ld_stderr));
+        exit(1);
+    } else if (buf_len(&ld_stderr)) {
+        fprintf(stderr, "%s\n", buf_ptr(&ld_stderr));
+    }
+}
+
 void codegen_link(CodeGen *g, const char *out_file) {
     LinkJob lj = {0};
     lj.codegen = g;
@@ -746,14 +1116,24 @@ void codegen_link(CodeGen *g, const char *out_file) {
         buf_resize(&lj.out_file, 0);
     }
 
+    bool is_static_lib = (g->out_type == OutTypeLib && g->is_static);
+    // the parts can only be put back together by a linker
+    int part_count = 1;
+    if (g->codegen_threads > 1 && g->out_type != OutTypeObj && !is_static_lib) {
+        part_count = g->codegen_threads;
+    }
+
     bool is_optimized = g->is_release_build;
-    if (is_optimized) {
+    // with more than one part, each part is optimized on its own thread
+    if (is_optimized && !g->cache_hit && part_count == 1) {
         if (g->verbose) {
             fprintf(stderr, "\nOptimization:\n");
             fprintf(stderr, "---------------\n");
         }
 
+        timing_begin(g->timing, "llvm optimization", nullptr);
         LLVMZigOptimizeModule(g->target_machine, g->module);
+        timing_end(g->timing);
 
         if (g->verbose) {
             LLVMDumpModule(g->module);
@@ -777,66 +1157,95 @@ void codegen_link(CodeGen *g, const char *out_file) {
         buf_append_str(&lj.out_file_o, o_ext);
     }
 
-    char *err_msg = nullptr;
-    if (LLVMTargetMachineEmitToFile(g->target_machine, g->module, buf_ptr(&lj.out_file_o),
-                LLVMObjectFile, &err_msg))
-    {
-        zig_panic("unable to write object file: %s", err_msg);
+    Buf object = BUF_INIT;
+
+    int err;
+    if (g->cache_hit) {
+        Buf *cached_o = cache_artifact_path(g->cache_hash, "root.o");
+        if (g->out_type == OutTypeObj) {
+            if ((err = os_copy_file(cached_o, &lj.out_file_o))) {
+                zig_panic("unable to copy %s: %s", buf_ptr(cached_o), err_str(err));
+            }
+        } else if (is_static_lib) {
+            if ((err = os_fetch_file_path(cached_o, &object))) {
+                zig_panic("unable to read %s: %s", buf_ptr(cached_o), err_str(err));
+            }
+        } else {
+            // no need to copy them out of the cache just to hand them to the linker
+            for (int i = 0; i < part_count; i += 1) {
+                lj.objects.append(cache_artifact_path(g->cache_hash, cached_o_basename(part_count, i)));
+            }
+        }
+    } else {
+        // the object is only written out where it is needed: the requested
+        // file for --export obj, otherwise the cache or a temporary file
+        // which the linker reads
+        ZigList<Buf *> parts = {0};
+        timing_begin(g->timing, "emit object", &lj.out_file);
+        if (part_count == 1) {
+            emit_object_to_buf(g, &object);
+        } else {
+            emit_objects_parallel(g, part_count, &parts);
+        }
+        timing_end(g->timing);
+
+        if (g->out_type == OutTypeObj) {
+            if ((err = os_write_file_path(&lj.out_file_o, &object))) {
+                zig_panic("unable to write %s: %s", buf_ptr(&lj.out_file_o), err_str(err));
+            }
+            if (g->cache_hash) {
+                add_cache_artifact_buf(g, &object, "root.o");
+            }
+        } else if (is_static_lib) {
+            // the archive is built from the object in memory
+            if (g->cache_hash) {
+                add_cache_artifact_buf(g, &object, "root.o");
+            }
+        } else if (part_count == 1) {
+            add_link_object(&lj, &object, "root.o");
+        } else {
+            for (int i = 0; i < parts.length; i += 1) {
+                add_link_object(&lj, parts.at(i), cached_o_basename(part_count, i));
+                buf_deinit(parts.at(i));
+            }
+        }
+        parts.deinit();
     }
 
     if (g->out_type == OutTypeObj) {
+        if (g->cache_hash && !g->cache_hit) {
+            codegen_cache_final(g);
+        }
         if (g->verbose) {
             fprintf(stderr, "OK\n");
         }
         return;
     }
 
-    if (g->out_type == OutTypeLib && g->is_static) {
-        // invoke `ar`
-        // example:
-        // # static link into libfoo.a
-        // ar rcs libfoo.a foo1.o foo2.o
-        zig_panic("TODO invoke ar");
-        return;
-    }
-
-    lj.link_in_crt = (g->link_libc && g->out_type == OutTypeExe);
-    ensure_we_have_linker_path(g);
-
-    construct_linker_job(&lj);
-
-
-    if (g->verbose) {
-        fprintf(stderr, "%s", buf_ptr(g->linker_path));
-        for (int i = 0; i < lj.args.length; i += 1) {
-            fprintf(stderr, " %s", lj.args.at(i));
-        }
-        fprintf(stderr, "\n");
-    }
-
-    int return_code;
-    Buf ld_stderr = BUF_INIT;
-    Buf ld_stdout = BUF_INIT;
-    int err = os_exec_process(buf_ptr(g->linker_path), lj.args, &return_code, &ld_stderr, &ld_stdout);
-    if (err) {
-        fprintf(stderr, "linker not found: '%s'\n", buf_ptr(g->linker_path));
-        exit(1);
+    if (is_static_lib) {
+        write_static_lib(&lj, &object);
+    } else {
+        run_linker(&lj);
     }
+    buf_deinit(&object);
 
-    if (return_code != 0) {
-        fprintf(stderr, "linker failed with return code %d\n", return_code);
-        fprintf(stderr, "%s ", buf_ptr(g->linker_path));
-        for (int i = 0; i < lj.args.length; i += 1) {
-            fprintf(stderr, "%s ", lj.args.at(i));
+    if (g->out_type == OutTypeLib) {
+        Buf *h_file_path = buf_sprintf("%s.h", buf_ptr(g->root_out_name));
+        if (g->cache_hit) {
+            Buf *cached_h = cache_artifact_path(g->cache_hash, "root.h");
+            if ((err = os_copy_file(cached_h, h_file_path))) {
+                zig_panic("unable to copy %s: %s", buf_ptr(cached_h), err_str(err));
+            }
+        } else {
+            codegen_generate_h_file(g);
+            if (g->cache_hash) {
+                add_cache_artifact(g, h_file_path, "root.h");
+            }
         }
-        fprintf(stderr, "\n%s\n", buf_ptr(&ld_stderr));
-        exit(1);
-    } else if (buf_len(&ld_stderr)) {
-        fprintf(stderr, "%s\n", buf_ptr(&ld_stderr));
     }
 
-    if (g->out_type == OutTypeLib) {
-        codegen_generate_h_file(g);
+    if (g->cache_hash && !g->cache_hit) {
+        codegen_cache_final(g);
     }
 
     if (g->verbose) {
@@ -62,6 +62,15 @@ struct ZigList {
         length = 0;
     }
 
+    // unlike ensure_capacity, allocates exactly this much. use it when the
+    // final length is known or can be estimated up front.
+    void reserve(int new_capacity) {
+        if (new_capacity > capacity) {
+            items = reallocate_nonzero(items, new_capacity);
+            capacity = new_capacity;
+        }
+    }
+
     void ensure_capacity(int new_capacity) {
         int better_capacity = max(capacity, 16);
         while (better_capacity < new_capacity)
@@ -15,12 +15,21 @@
 
 #include <stdio.h>
 
+#if !defined(_WIN32)
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/wait.h>
+#endif
+
 static int usage(const char *arg0) {
     fprintf(stderr, "Usage: %s [command] [options]\n"
         "Commands:\n"
         "  build [source]               create executable, object, or library from source\n"
         "  test [source]                create and run a test build\n"
         "  parseh [source]              convert a c header file to zig extern declarations\n"
+        "  parseh-batch [file]          parseh each header in file, a header and output path per line\n"
+        "  batch [file] [-j N]          run the commands listed in file, one per line\n"
         "  version                      print version number and exit\n"
         "  targets                      list available compilation targets\n"
         "Options:\n"
@@ -31,12 +40,20 @@ static int usage(const char *arg0) {
         "  --name [name]                override output name\n"
         "  --output [file]              override destination path\n"
         "  --verbose                    turn on compiler debug output\n"
+        "  --time-report                print how long each compilation phase took\n"
+        "  --trace-out [file]           write a Chrome trace of the compilation to file\n"
         "  --color [auto|off|on]        enable or disable colored error messages\n"
+        "  --cache [on|off]             reuse previously built objects from the cache\n"
+        "  --cache-dir [path]           override the directory used for the build cache\n"
         "  --libc-lib-dir [path]        directory where libc crt1.o resides\n"
         "  --libc-static-lib-dir [path] directory where libc crtbegin.o resides\n"
         "  --libc-include-dir [path]    directory where libc stdlib.h resides\n"
         "  --dynamic-linker [path]      set the path to ld.so\n"
         "  --ld-path [path]             set the path to the linker\n"
+        "  --lld                        link ELF targets with the built in LLD\n"
+        "  --codegen-threads [N]        optimize and emit N parts of the program in parallel\n"
+        "  --c-macros [referenced|none|all] which C macros c_import translates\n"
+        "  -j [N]                       (parseh-batch only) parse N headers at once\n"
         "  -isystem [dir]               add additional search path for other .h files\n"
         "  -dirafter [dir]              same as -isystem but do it last\n"
         "  --library-path [dir]         add a directory to the library search path\n"
@@ -94,12 +111,11 @@ enum Cmd {
     CmdTest,
     CmdVersion,
     CmdParseH,
+    CmdParseHBatch,
     CmdTargets,
 };
 
-int main(int argc, char **argv) {
-    os_init();
-
+static int run_command(int argc, char **argv) {
     char *arg0 = argv[0];
     Cmd cmd = CmdInvalid;
     const char *in_file = nullptr;
@@ -110,7 +126,16 @@ int main(int argc, char **argv) {
     OutType out_type = OutTypeUnknown;
     const char *out_name = nullptr;
     bool verbose = false;
+    bool time_report = false;
+    bool use_lld = false;
+    int codegen_threads = 1;
+    CMacros c_macros = CMacrosReferenced;
+    // 0 when -j isn't given
+    int parseh_job_count = 0;
+    const char *trace_out = nullptr;
     ErrColor color = ErrColorAuto;
+    bool enable_cache = true;
+    const char *cache_dir = nullptr;
     const char *libc_lib_dir = nullptr;
     const char *libc_static_lib_dir = nullptr;
     const char *libc_include_dir = nullptr;
@@ -142,6 +167,10 @@ int main(int argc, char **argv) {
                 is_static = true;
             } else if (strcmp(arg, "--verbose") == 0) {
                 verbose = true;
+            } else if (strcmp(arg, "--time-report") == 0) {
+                time_report = true;
+            } else if (strcmp(arg, "--lld") == 0) {
+                use_lld = true;
             } else if (strcmp(arg, "-mwindows") == 0) {
                 mwindows = true;
             } else if (strcmp(arg, "-mconsole") == 0) {
@@ -178,6 +207,38 @@ int main(int argc, char **argv) {
                     } else {
                         return usage(arg0);
                     }
+                } else if (strcmp(arg, "--cache") == 0) {
+                    if (strcmp(argv[i], "on") == 0) {
+                        enable_cache = true;
+                    } else if (strcmp(argv[i], "off") == 0) {
+                        enable_cache = false;
+                    } else {
+                        return usage(arg0);
+                    }
+                } else if (strcmp(arg, "--cache-dir") == 0) {
+                    cache_dir = argv[i];
+                } else if (strcmp(arg, "--codegen-threads") == 0) {
+                    codegen_threads = atoi(argv[i]);
+                    if (codegen_threads < 1) {
+                        return usage(arg0);
+                    }
+                } else if (strcmp(arg, "--c-macros") == 0) {
+                    if (strcmp(argv[i], "referenced") == 0) {
+                        c_macros = CMacrosReferenced;
+                    } else if (strcmp(argv[i], "none") == 0) {
+                        c_macros = CMacrosNone;
+                    } else if (strcmp(argv[i], "all") == 0) {
+                        c_macros = CMacrosAll;
+                    } else {
+                        return usage(arg0);
+                    }
+                } else if (strcmp(arg, "-j") == 0) {
+                    parseh_job_count = atoi(argv[i]);
+                    if (parseh_job_count < 1) {
+                        return usage(arg0);
+                    }
+                } else if (strcmp(arg, "--trace-out") == 0) {
+                    trace_out = argv[i];
                 } else if (strcmp(arg, "--name") == 0) {
                     out_name = argv[i];
                 } else if (strcmp(arg, "--libc-lib-dir") == 0) {
@@ -222,6 +283,8 @@ int main(int argc, char **argv) {
                 cmd = CmdVersion;
             } else if (strcmp(arg, "parseh") == 0) {
                 cmd = CmdParseH;
+            } else if (strcmp(arg, "parseh-batch") == 0) {
+                cmd = CmdParseHBatch;
             } else if (strcmp(arg, "test") == 0) {
                 cmd = CmdTest;
             } else if (strcmp(arg, "targets") == 0) {
@@ -234,6 +297,7 @@ int main(int argc, char **argv) {
             switch (cmd) {
                 case CmdBuild:
                 case CmdParseH:
+                case CmdParseHBatch:
                 case CmdTest:
                     if (!in_file) {
                         in_file = arg;
@@ -253,11 +317,17 @@ int main(int argc, char **argv) {
     switch (cmd) {
     case CmdBuild:
     case CmdParseH:
+    case CmdParseHBatch:
     case CmdTest:
         {
             if (!in_file)
                 return usage(arg0);
 
+            if (parseh_job_count != 0 && cmd != CmdParseHBatch) {
+                fprintf(stderr, "-j is only valid with parseh-batch\n");
+                return usage(arg0);
+            }
+
             init_all_targets();
 
             ZigTarget alloc_target;
@@ -303,7 +373,7 @@ int main(int argc, char **argv) {
                 buf_init_from_str(&root_source_name, "");
             } else {
                 os_path_split(&in_file_buf, &root_source_dir, &root_source_name);
-                if ((err = os_fetch_file_path(buf_create_from_str(in_file), &root_source_code))) {
+                if ((err = os_map_file_path(buf_create_from_str(in_file), &root_source_code))) {
                     fprintf(stderr, "unable to open '%s': %s\n", in_file, err_str(err));
                     return 1;
                 }
@@ -336,8 +406,24 @@ int main(int argc, char **argv) {
                 codegen_set_dynamic_linker(g, buf_create_from_str(dynamic_linker));
             if (linker_path)
                 codegen_set_linker_path(g, buf_create_from_str(linker_path));
+            if (use_lld) {
+                if (!ZigLLDIsAvailable()) {
+                    fprintf(stderr, "--lld: this zig was built without LLD (see ZIG_LLD in CMakeLists.txt)\n");
+                    return EXIT_FAILURE;
+                }
+                codegen_set_use_lld(g, true);
+            }
+            codegen_set_codegen_threads(g, codegen_threads);
+            codegen_set_c_macros(g, c_macros);
             codegen_set_verbose(g, verbose);
+            codegen_set_time_report(g, time_report);
+            if (trace_out)
+                codegen_set_trace_out(g, buf_create_from_str(trace_out));
             codegen_set_errmsg_color(g, color);
+            if (cache_dir)
+                codegen_set_cache_dir(g, buf_create_from_str(cache_dir));
+            if (!enable_cache)
+                codegen_set_enable_cache(g, false);
 
             for (int i = 0; i < lib_dirs.length; i += 1) {
                 codegen_add_lib_dir(g, lib_dirs.at(i));
@@ -363,14 +449,22 @@ int main(int argc, char **argv) {
             if (cmd == CmdBuild) {
                 codegen_add_root_code(g, &root_source_dir, &root_source_name, &root_source_code);
                 codegen_link(g, out_file);
+                codegen_finish_timing(g);
                 return EXIT_SUCCESS;
             } else if (cmd == CmdParseH) {
                 codegen_parseh(g, &root_source_dir, &root_source_name, &root_source_code);
                 codegen_render_ast(g, stdout, 4);
+                codegen_finish_timing(g);
                 return EXIT_SUCCESS;
+            } else if (cmd == CmdParseHBatch) {
+                int failed_count = codegen_parseh_batch(g, &in_file_buf, &root_source_code,
+                        (parseh_job_count != 0) ? parseh_job_count : 1);
+                codegen_finish_timing(g);
+                return (failed_count == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
             } else if (cmd == CmdTest) {
                 codegen_add_root_code(g, &root_source_dir, &root_source_name, &root_source_code);
                 codegen_link(g, "./test");
+                codegen_finish_timing(g);
                 ZigList<const char *> args = {0};
                 int return_code;
                 os_spawn_process("./test", args, &return_code);
@@ -392,3 +486,149 @@ int main(int argc, char **argv) {
         return usage(arg0);
     }
 }
+
+#if !defined(_WIN32)
+struct BatchCommand {
+    const char *dir;
+    ZigList<char *> argv;
+    pid_t pid;
+    int return_code;
+};
+
+static void start_batch_command(BatchCommand *command) {
+    fflush(stdout);
+    fflush(stderr);
+    command->pid = fork();
+    if (command->pid == -1)
+        zig_panic("fork failed: %s", strerror(errno));
+    if (command->pid != 0)
+        return;
+
+    // child
+    if (chdir(command->dir) == -1) {
+        fprintf(stderr, "unable to enter '%s': %s\n", command->dir, strerror(errno));
+        _exit(1);
+    }
+    int stdout_fd = open("zig.stdout", O_WRONLY|O_CREAT|O_TRUNC, 0644);
+    int stderr_fd = open("zig.stderr", O_WRONLY|O_CREAT|O_TRUNC, 0644);
+    if (stdout_fd == -1 || stderr_fd == -1 ||
+        dup2(stdout_fd, STDOUT_FILENO) == -1 || dup2(stderr_fd, STDERR_FILENO) == -1)
+    {
+        _exit(1);
+    }
+    close(stdout_fd);
+    close(stderr_fd);
+    int return_code = run_command(command->argv.length - 1, command->argv.items);
+    fflush(stdout);
+    fflush(stderr);
+    _exit(return_code);
+}
+
+// Each line of the batch file is a directory followed by the arguments of
+// a zig command, separated by spaces. Every command runs in a child forked
+// from this process, inside that directory, with its output written to
+// zig.stdout and zig.stderr there. The children share the LLVM targets we
+// initialize here, and once the first of them has built the std objects
+// the rest find them in the cache. A compile error exits the child, not
+// us. For each line, in order, prints the directory and the exit code.
+static int run_batch(char *arg0, int argc, char **argv) {
+    const char *batch_file = nullptr;
+    int job_count = 1;
+    for (int i = 0; i < argc; i += 1) {
+        if (strcmp(argv[i], "-j") == 0 && i + 1 < argc) {
+            i += 1;
+            job_count = atoi(argv[i]);
+            if (job_count < 1)
+                return usage(arg0);
+        } else if (!batch_file) {
+            batch_file = argv[i];
+        } else {
+            return usage(arg0);
+        }
+    }
+    if (!batch_file)
+        return usage(arg0);
+
+    Buf contents = BUF_INIT;
+    int err;
+    if ((err = os_fetch_file_path(buf_create_from_str(batch_file), &contents))) {
+        fprintf(stderr, "unable to open '%s': %s\n", batch_file, err_str(err));
+        return EXIT_FAILURE;
+    }
+
+    // split the file in place into null terminated words
+    ZigList<BatchCommand> commands = {0};
+    char *ptr = buf_ptr(&contents);
+    char *end = ptr + buf_len(&contents);
+    while (ptr < end) {
+        char *line_end = (char *)memchr(ptr, '\n', end - ptr);
+        if (!line_end)
+            line_end = end;
+        *line_end = 0;
+
+        ZigList<char *> words = {0};
+        for (char *word = strtok(ptr, " \t\r"); word; word = strtok(nullptr, " \t\r")) {
+            words.append(word);
+        }
+        if (words.length >= 2) {
+            commands.add_one();
+            BatchCommand *command = &commands.last();
+            command->dir = words.at(0);
+            command->argv.append(arg0);
+            for (int i = 1; i < words.length; i += 1) {
+                command->argv.append(words.at(i));
+            }
+            command->argv.append(nullptr);
+        }
+        words.deinit();
+        ptr = line_end + 1;
+    }
+
+    init_all_targets();
+
+    int next_start = 0;
+    int running = 0;
+    while (next_start < commands.length || running > 0) {
+        while (running < job_count && next_start < commands.length) {
+            start_batch_command(&commands.at(next_start));
+            next_start += 1;
+            running += 1;
+        }
+
+        int status;
+        pid_t pid = waitpid(-1, &status, 0);
+        if (pid == -1) {
+            if (errno == EINTR)
+                continue;
+            zig_panic("waitpid failed: %s", strerror(errno));
+        }
+        running -= 1;
+        for (int i = 0; i < commands.length; i += 1) {
+            BatchCommand *command = &commands.at(i);
+            if (command->pid == pid) {
+                command->return_code = WIFEXITED(status) ? WEXITSTATUS(status) : 128 + WTERMSIG(status);
+                break;
+            }
+        }
+    }
+
+    for (int i = 0; i < commands.length; i += 1) {
+        printf("%s %d\n", commands.at(i).dir, commands.at(i).return_code);
+    }
+    return EXIT_SUCCESS;
+}
+#endif
+
+int main(int argc, char **argv) {
+    os_init();
+
+    if (argc >= 2 && strcmp(argv[1], "batch") == 0) {
+#if defined(_WIN32)
+        fprintf(stderr, "batch is not supported on Windows\n");
+        return EXIT_FAILURE;
+#else
+        return run_batch(argv[0], argc - 2, argv + 2);
+#endif
+    }
+    return run_command(argc, argv);
+}
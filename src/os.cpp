@@ -25,7 +25,10 @@
 #endif
 
 #include <windows.h>
+#include <psapi.h>
 #include <io.h>
+#include <direct.h>
+#include <process.h>
 #else
 #define ZIG_OS_POSIX
 
@@ -33,8 +36,18 @@
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <sys/wait.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
 #include <fcntl.h>
 #include <limits.h>
+#include <poll.h>
+#include <spawn.h>
+
+#if defined(__APPLE__)
+#include <mach-o/dyld.h>
+#endif
+
+extern char **environ;
 
 #endif
 
@@ -48,25 +61,34 @@
 
 
 #if defined(ZIG_OS_POSIX)
-static void os_spawn_process_posix(const char *exe, ZigList<const char *> &args, int *return_code) {
-    pid_t pid = fork();
-    if (pid == -1)
-        zig_panic("fork failed");
-    if (pid == 0) {
-        // child
-        const char **argv = allocate<const char *>(args.length + 2);
-        argv[0] = exe;
-        argv[args.length + 1] = nullptr;
-        for (int i = 0; i < args.length; i += 1) {
-            argv[i + 1] = args.at(i);
-        }
-        execvp(exe, const_cast<char * const *>(argv));
-        zig_panic("execvp failed: %s", strerror(errno));
-    } else {
-        // parent
-        waitpid(pid, return_code, 0);
+static char **os_make_argv(const char *exe, ZigList<const char *> &args) {
+    const char **argv = allocate<const char *>(args.length + 2);
+    argv[0] = exe;
+    argv[args.length + 1] = nullptr;
+    for (int i = 0; i < args.length; i += 1) {
+        argv[i + 1] = args.at(i);
+    }
+    return const_cast<char **>(argv);
+}
+
+static void os_wait_child(pid_t pid, int *return_code) {
+    while (waitpid(pid, return_code, 0) == -1) {
+        if (errno != EINTR)
+            zig_panic("waitpid failed: %s", strerror(errno));
     }
 }
+
+// posix_spawn rather than fork, so that we don't have to duplicate the page
+// tables of a compiler process which may be very large by now
+static void os_spawn_process_posix(const char *exe, ZigList<const char *> &args, int *return_code) {
+    char **argv = os_make_argv(exe, args);
+    pid_t pid;
+    int err = posix_spawnp(&pid, exe, nullptr, nullptr, argv, environ);
+    free(argv);
+    if (err)
+        zig_panic("posix_spawn failed: %s", strerror(err));
+    os_wait_child(pid, return_code);
+}
 #endif
 
 #if defined(ZIG_OS_WINDOWS)
@@ -176,53 +198,89 @@ static int os_exec_process_posix(const char *exe, ZigList<const char *> &args,
     int stdout_pipe[2];
     int stderr_pipe[2];
 
-    int err;
-    if ((err = pipe(stdin_pipe)))
+    if (pipe(stdin_pipe))
         zig_panic("pipe failed");
-    if ((err = pipe(stdout_pipe)))
+    if (pipe(stdout_pipe))
         zig_panic("pipe failed");
-    if ((err = pipe(stderr_pipe)))
+    if (pipe(stderr_pipe))
         zig_panic("pipe failed");
 
-    pid_t pid = fork();
-    if (pid == -1)
-        zig_panic("fork failed");
-    if (pid == 0) {
-        // child
-        if (dup2(stdin_pipe[0], STDIN_FILENO) == -1)
-            zig_panic("dup2 failed");
-
-        if (dup2(stdout_pipe[1], STDOUT_FILENO) == -1)
-            zig_panic("dup2 failed");
-
-        if (dup2(stderr_pipe[1], STDERR_FILENO) == -1)
-            zig_panic("dup2 failed");
-
-        const char **argv = allocate<const char *>(args.length + 2);
-        argv[0] = exe;
-        argv[args.length + 1] = nullptr;
-        for (int i = 0; i < args.length; i += 1) {
-            argv[i + 1] = args.at(i);
-        }
-        execvp(exe, const_cast<char * const *>(argv));
-        if (errno == ENOENT) {
+    posix_spawn_file_actions_t actions;
+    if (posix_spawn_file_actions_init(&actions))
+        zig_panic("posix_spawn_file_actions_init failed");
+    posix_spawn_file_actions_adddup2(&actions, stdin_pipe[0], STDIN_FILENO);
+    posix_spawn_file_actions_adddup2(&actions, stdout_pipe[1], STDOUT_FILENO);
+    posix_spawn_file_actions_adddup2(&actions, stderr_pipe[1], STDERR_FILENO);
+    int pipe_fds[] = {
+        stdin_pipe[0], stdin_pipe[1],
+        stdout_pipe[0], stdout_pipe[1],
+        stderr_pipe[0], stderr_pipe[1],
+    };
+    for (int i = 0; i < array_length(pipe_fds); i += 1) {
+        posix_spawn_file_actions_addclose(&actions, pipe_fds[i]);
+    }
+
+    char **argv = os_make_argv(exe, args);
+    pid_t pid;
+    int err = posix_spawnp(&pid, exe, &actions, nullptr, argv, environ);
+    free(argv);
+    posix_spawn_file_actions_destroy(&actions);
+
+    // the child has its own copies now. closing our end of stdin means the
+    // child sees end of file rather than waiting for input forever.
+    close(stdin_pipe[0]);
+    close(stdin_pipe[1]);
+    close(stdout_pipe[1]);
+    close(stderr_pipe[1]);
+
+    if (err) {
+        close(stdout_pipe[0]);
+        close(stderr_pipe[0]);
+        if (err == ENOENT)
             return ErrorFileNotFound;
-        } else {
-            zig_panic("execvp failed: %s", strerror(errno));
+        zig_panic("posix_spawn failed: %s", strerror(err));
+    }
+
+    // Drain both pipes as data arrives. Waiting for the child first, or
+    // reading one pipe to the end before the other, deadlocks as soon as
+    // the child fills the pipe buffer we are not reading.
+    buf_resize(out_stdout, 0);
+    buf_resize(out_stderr, 0);
+    struct pollfd poll_fds[2] = {
+        {stdout_pipe[0], POLLIN, 0},
+        {stderr_pipe[0], POLLIN, 0},
+    };
+    Buf *out_bufs[2] = {out_stdout, out_stderr};
+    int open_count = 2;
+    while (open_count > 0) {
+        if (poll(poll_fds, 2, -1) == -1) {
+            if (errno == EINTR)
+                continue;
+            zig_panic("poll failed: %s", strerror(errno));
+        }
+        for (int i = 0; i < 2; i += 1) {
+            if (poll_fds[i].fd == -1 || !poll_fds[i].revents)
+                continue;
+            char chunk[0x2000];
+            ssize_t amt_read = read(poll_fds[i].fd, chunk, sizeof(chunk));
+            if (amt_read == -1) {
+                if (errno == EINTR || errno == EAGAIN)
+                    continue;
+                zig_panic("read failed: %s", strerror(errno));
+            }
+            if (amt_read == 0) {
+                // end of file. poll ignores negative file descriptors.
+                close(poll_fds[i].fd);
+                poll_fds[i].fd = -1;
+                open_count -= 1;
+                continue;
+            }
+            buf_append_mem(out_bufs[i], chunk, amt_read);
         }
-    } else {
-        // parent
-        close(stdin_pipe[0]);
-        close(stdout_pipe[1]);
-        close(stderr_pipe[1]);
-
-        waitpid(pid, return_code, 0);
-
-        os_fetch_file(fdopen(stdout_pipe[0], "rb"), out_stdout);
-        os_fetch_file(fdopen(stderr_pipe[0], "rb"), out_stderr);
-
-        return 0;
     }
+
+    os_wait_child(pid, return_code);
+    return 0;
 }
 #endif
 
@@ -396,28 +454,140 @@ void os_write_file(Buf *full_path, Buf *contents) {
         zig_panic("close failed");
 }
 
-int os_fetch_file_path(Buf *full_path, Buf *out_contents) {
-    FILE *f = fopen(buf_ptr(full_path), "rb");
-    if (!f) {
-        switch (errno) {
-            case EACCES:
-                return ErrorAccess;
-            case EINTR:
-                return ErrorInterrupted;
-            case EINVAL:
-                zig_unreachable();
-            case ENFILE:
-            case ENOMEM:
-                return ErrorSystemResources;
-            case ENOENT:
-                return ErrorFileNotFound;
-            default:
-                return ErrorFileSystem;
+static int os_open_error(void) {
+    switch (errno) {
+        case EACCES:
+            return ErrorAccess;
+        case EINTR:
+            return ErrorInterrupted;
+        case EINVAL:
+            zig_unreachable();
+        case ENFILE:
+        case EMFILE:
+        case ENOMEM:
+            return ErrorSystemResources;
+        case ENOENT:
+            return ErrorFileNotFound;
+        default:
+            return ErrorFileSystem;
+    }
+}
+
+int os_write_file_path(Buf *full_path, Buf *contents) {
+    FILE *f = fopen(buf_ptr(full_path), "wb");
+    if (!f)
+        return os_open_error();
+    size_t amt_written = fwrite(buf_ptr(contents), 1, buf_len(contents), f);
+    if (fclose(f) || amt_written != (size_t)buf_len(contents))
+        return ErrorFileSystem;
+    return 0;
+}
+
+#if defined(ZIG_OS_POSIX)
+// regular files are read with a single allocation of the size fstat reports;
+// anything else (pipes, devices, files like /proc which report a size of 0)
+// falls back to os_fetch_file
+static int os_fetch_file_fd(int fd, struct stat *st, Buf *out_contents) {
+    if (!S_ISREG(st->st_mode) || st->st_size == 0) {
+        FILE *f = fdopen(fd, "rb");
+        if (!f) {
+            close(fd);
+            return ErrorSystemResources;
+        }
+        int result = os_fetch_file(f, out_contents);
+        fclose(f);
+        return result;
+    }
+
+    if (st->st_size >= INT_MAX) {
+        close(fd);
+        return ErrorFileTooBig;
+    }
+    int size = (int)st->st_size;
+    buf_resize(out_contents, size);
+    int amt_total = 0;
+    while (amt_total < size) {
+        ssize_t amt_read = read(fd, buf_ptr(out_contents) + amt_total, size - amt_total);
+        if (amt_read == -1) {
+            if (errno == EINTR)
+                continue;
+            close(fd);
+            return ErrorFileSystem;
+        }
+        if (amt_read == 0) {
+            // the file got shorter since we called fstat
+            buf_resize(out_contents, amt_total);
+            break;
         }
+        amt_total += amt_read;
     }
+    close(fd);
+    return 0;
+}
+#endif
+
+int os_fetch_file_path(Buf *full_path, Buf *out_contents) {
+#if defined(ZIG_OS_POSIX)
+    int fd = open(buf_ptr(full_path), O_RDONLY|O_CLOEXEC);
+    if (fd == -1)
+        return os_open_error();
+    struct stat st;
+    if (fstat(fd, &st) == -1) {
+        close(fd);
+        return ErrorFileSystem;
+    }
+    return os_fetch_file_fd(fd, &st, out_contents);
+#else
+    FILE *f = fopen(buf_ptr(full_path), "rb");
+    if (!f)
+        return os_open_error();
     int result = os_fetch_file(f, out_contents);
     fclose(f);
     return result;
+#endif
+}
+
+int os_map_file_path(Buf *full_path, Buf *out_contents) {
+#if defined(ZIG_OS_POSIX)
+    int fd = open(buf_ptr(full_path), O_RDONLY|O_CLOEXEC);
+    if (fd == -1)
+        return os_open_error();
+    struct stat st;
+    if (fstat(fd, &st) == -1) {
+        close(fd);
+        return ErrorFileSystem;
+    }
+
+    // The bytes between the end of the file and the end of its last page
+    // read as zero, which gives us the null terminator for free. When the
+    // size is an exact multiple of the page size there is no such byte, so
+    // read the file into memory instead.
+    //
+    // A mapped file which is truncated while we still use it raises SIGBUS
+    // where a copy would have been unaffected. Small files are copied, which
+    // costs next to nothing; only large ones, where avoiding the copy pays
+    // off, take that risk.
+    const off_t min_map_size = 64 * 1024;
+    long page_size = sysconf(_SC_PAGESIZE);
+    if (!S_ISREG(st.st_mode) || st.st_size < min_map_size || st.st_size >= INT_MAX ||
+        page_size <= 0 || st.st_size % page_size == 0)
+    {
+        return os_fetch_file_fd(fd, &st, out_contents);
+    }
+
+    // private and writable so that a stray write only touches our copy
+    void *mapping = mmap(nullptr, st.st_size, PROT_READ|PROT_WRITE, MAP_PRIVATE, fd, 0);
+    if (mapping == MAP_FAILED)
+        return os_fetch_file_fd(fd, &st, out_contents);
+    close(fd);
+
+    out_contents->list.items = (char *)mapping;
+    out_contents->list.length = (int)st.st_size + 1;
+    out_contents->list.capacity = out_contents->list.length;
+    return 0;
+#else
+    return os_fetch_file_path(full_path, out_contents);
+#endif
 }
 
 int os_get_cwd(Buf *out_cwd) {
@@ -534,6 +704,228 @@ int os_delete_file(Buf *path) {
     }
 }
 
+bool os_file_exists(Buf *full_path) {
+#if defined(ZIG_OS_WINDOWS)
+    return GetFileAttributes(buf_ptr(full_path)) != INVALID_FILE_ATTRIBUTES;
+#elif defined(ZIG_OS_POSIX)
+    return access(buf_ptr(full_path), F_OK) != -1;
+#else
+#error "missing os_file_exists implementation"
+#endif
+}
+
+int os_self_exe_path(Buf *out_path) {
+#if defined(ZIG_OS_WINDOWS)
+    char path[MAX_PATH];
+    DWORD len = GetModuleFileName(nullptr, path, MAX_PATH);
+    if (len == 0 || len >= MAX_PATH)
+        return ErrorFileNotFound;
+    buf_init_from_mem(out_path, path, len);
+    return 0;
+#elif defined(__APPLE__)
+    uint32_t size = 0;
+    _NSGetExecutablePath(nullptr, &size);
+    buf_resize(out_path, size);
+    if (_NSGetExecutablePath(buf_ptr(out_path), &size))
+        return ErrorFileNotFound;
+    buf_resize(out_path, strlen(buf_ptr(out_path)));
+    return 0;
+#elif defined(ZIG_OS_POSIX)
+    char path[PATH_MAX];
+    ssize_t len = readlink("/proc/self/exe", path, sizeof(path));
+    if (len == -1 || len >= (ssize_t)sizeof(path))
+        return ErrorFileNotFound;
+    buf_init_from_mem(out_path, path, len);
+    return 0;
+#else
+#error "missing os_self_exe_path implementation"
+#endif
+}
+
+int os_file_stamp(Buf *path, uint64_t *out_size, uint64_t *out_mtime) {
+#if defined(ZIG_OS_WINDOWS)
+    struct __stat64 st;
+    if (_stat64(buf_ptr(path), &st))
+        return ErrorFileNotFound;
+    *out_size = st.st_size;
+    *out_mtime = (uint64_t)st.st_mtime * 1000000000ULL;
+    return 0;
+#elif defined(ZIG_OS_POSIX)
+    struct stat st;
+    if (stat(buf_ptr(path), &st))
+        return ErrorFileNotFound;
+    *out_size = st.st_size;
+#if defined(__APPLE__)
+    *out_mtime = (uint64_t)st.st_mtimespec.tv_sec * 1000000000ULL + st.st_mtimespec.tv_nsec;
+#else
+    *out_mtime = (uint64_t)st.st_mtim.tv_sec * 1000000000ULL + st.st_mtim.tv_nsec;
+#endif
+    return 0;
+#else
+#error "missing os_file_stamp implementation"
+#endif
+}
+
+int os_rename(Buf *src_path, Buf *dest_path) {
+#if defined(ZIG_OS_WINDOWS)
+    if (!MoveFileEx(buf_ptr(src_path), buf_ptr(dest_path), MOVEFILE_REPLACE_EXISTING)) {
+        return ErrorFileSystem;
+    }
+    return 0;
+#elif defined(ZIG_OS_POSIX)
+    if (rename(buf_ptr(src_path), buf_ptr(dest_path)) == -1) {
+        return ErrorFileSystem;
+    }
+    return 0;
+#else
+#error "missing os_rename implementation"
+#endif
+}
+
+int os_copy_file(Buf *src_path, Buf *dest_path) {
+    Buf contents = BUF_INIT;
+    int err;
+    if ((err = os_fetch_file_path(src_path, &contents))) {
+        return err;
+    }
+    err = os_write_file_path(dest_path, &contents);
+    buf_deinit(&contents);
+    return err;
+}
+
+static int os_make_dir(Buf *path) {
+#if defined(ZIG_OS_WINDOWS)
+    int result = _mkdir(buf_ptr(path));
+#elif defined(ZIG_OS_POSIX)
+    int result = mkdir(buf_ptr(path), 0755);
+#else
+#error "missing os_make_dir implementation"
+#endif
+    if (result == -1) {
+        if (errno == EEXIST) {
+            return 0;
+        } else if (errno == EACCES) {
+            return ErrorAccess;
+        } else if (errno == ENOENT) {
+            return ErrorFileNotFound;
+        } else {
+            return ErrorFileSystem;
+        }
+    }
+    return 0;
+}
+
+// like `mkdir -p`
+int os_make_path(Buf *path) {
+    Buf dir_path = BUF_INIT;
+    for (int i = 1; i <= buf_len(path); i += 1) {
+        if (i == buf_len(path) || buf_ptr(path)[i] == '/') {
+            buf_init_from_mem(&dir_path, buf_ptr(path), i);
+            int err;
+            if ((err = os_make_dir(&dir_path))) {
+                buf_deinit(&dir_path);
+                return err;
+            }
+        }
+    }
+    buf_deinit(&dir_path);
+    return 0;
+}
+
+int os_get_pid(void) {
+#if defined(ZIG_OS_WINDOWS)
+    return _getpid();
+#elif defined(ZIG_OS_POSIX)
+    return getpid();
+#else
+#error "missing os_get_pid implementation"
+#endif
+}
+
+int os_get_app_cache_dir(Buf *out_path, const char *app_name) {
+#if defined(ZIG_OS_WINDOWS)
+    const char *local_app_data = getenv("LOCALAPPDATA");
+    if (!local_app_data) {
+        return ErrorFileNotFound;
+    }
+    buf_resize(out_path, 0);
+    buf_appendf(out_path, "%s/%s", local_app_data, app_name);
+    return 0;
+#elif defined(ZIG_OS_POSIX)
+    const char *xdg_cache_home = getenv("XDG_CACHE_HOME");
+    buf_resize(out_path, 0);
+    if (xdg_cache_home && xdg_cache_home[0] == '/') {
+        buf_appendf(out_path, "%s/%s", xdg_cache_home, app_name);
+        return 0;
+    }
+    const char *home = getenv("HOME");
+    if (!home) {
+        return ErrorFileNotFound;
+    }
+    buf_appendf(out_path, "%s/.cache/%s", home, app_name);
+    return 0;
+#else
+#error "missing os_get_app_cache_dir implementation"
+#endif
+}
+
+double os_get_time(void) {
+#if defined(ZIG_OS_WINDOWS)
+    LARGE_INTEGER frequency;
+    LARGE_INTEGER counter;
+    QueryPerformanceFrequency(&frequency);
+    QueryPerformanceCounter(&counter);
+    return (double)counter.QuadPart / (double)frequency.QuadPart;
+#elif defined(ZIG_OS_POSIX)
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1000000000.0;
+#else
+#error "missing os_get_time implementation"
+#endif
+}
+
+double os_get_cpu_time(void) {
+#if defined(ZIG_OS_WINDOWS)
+    FILETIME creation_time, exit_time, kernel_time, user_time;
+    if (!GetProcessTimes(GetCurrentProcess(), &creation_time, &exit_time, &kernel_time, &user_time))
+        return 0;
+    uint64_t kernel = ((uint64_t)kernel_time.dwHighDateTime << 32) | kernel_time.dwLowDateTime;
+    uint64_t user = ((uint64_t)user_time.dwHighDateTime << 32) | user_time.dwLowDateTime;
+    // 100 nanosecond units
+    return (kernel + user) / 10000000.0;
+#elif defined(ZIG_OS_POSIX)
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage))
+        return 0;
+    return usage.ru_utime.tv_sec + usage.ru_utime.tv_usec / 1000000.0 +
+        usage.ru_stime.tv_sec + usage.ru_stime.tv_usec / 1000000.0;
+#else
+#error "missing os_get_cpu_time implementation"
+#endif
+}
+
+size_t os_get_peak_rss(void) {
+#if defined(ZIG_OS_WINDOWS)
+    PROCESS_MEMORY_COUNTERS counters;
+    if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+        return 0;
+    return counters.PeakWorkingSetSize;
+#elif defined(ZIG_OS_POSIX)
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage))
+        return 0;
+#if defined(__APPLE__)
+    return usage.ru_maxrss;
+#else
+    // kilobytes everywhere else
+    return (size_t)usage.ru_maxrss * 1024;
+#endif
+#else
+#error "missing os_get_peak_rss implementation"
+#endif
+}
+
 void os_init(void) {
     srand(time(NULL));
 }
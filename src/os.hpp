@@ -23,10 +23,16 @@ void os_path_join(Buf *dirname, Buf *basename, Buf *out_full_path);
 int os_path_real(Buf *rel_path, Buf *out_abs_path);
 
 void os_write_file(Buf *full_path, Buf *contents);
+// like os_write_file, but returns an error instead of panicking
+int os_write_file_path(Buf *full_path, Buf *contents);
 
 
 int os_fetch_file(FILE *file, Buf *out_contents);
 int os_fetch_file_path(Buf *full_path, Buf *out_contents);
+// Like os_fetch_file_path, but may map the file into memory instead of
+// copying it. The result must never be resized or deinitialized, and the
+// file must not be truncated while the result is in use.
+int os_map_file_path(Buf *full_path, Buf *out_contents);
 
 int os_get_cwd(Buf *out_cwd);
 
@@ -35,4 +41,22 @@ bool os_stderr_tty(void);
 int os_buf_to_tmp_file(Buf *contents, Buf *suffix, Buf *out_tmp_path);
 int os_delete_file(Buf *path);
 
+bool os_file_exists(Buf *full_path);
+// the path of the running zig executable
+int os_self_exe_path(Buf *out_path);
+// the size of a file and its modification time, in nanoseconds since the epoch
+int os_file_stamp(Buf *path, uint64_t *out_size, uint64_t *out_mtime);
+int os_rename(Buf *src_path, Buf *dest_path);
+int os_copy_file(Buf *src_path, Buf *dest_path);
+int os_make_path(Buf *path);
+int os_get_pid(void);
+int os_get_app_cache_dir(Buf *out_path, const char *app_name);
+
+// in seconds. os_get_time is a monotonic wall clock and os_get_cpu_time is
+// the user plus system time of this process.
+double os_get_time(void);
+double os_get_cpu_time(void);
+// in bytes, 0 if unknown
+size_t os_get_peak_rss(void);
+
 #endif
@@ -8,6 +8,7 @@
 #include "parseh.hpp"
 #include "config.h"
 #include "os.hpp"
+#include "cache_hash.hpp"
 #include "error.hpp"
 #include "parser.hpp"
 #include "all_types.hpp"
@@ -16,8 +17,10 @@
 
 #include <clang/Frontend/ASTUnit.h>
 #include <clang/Frontend/CompilerInstance.h>
+#include <clang/Lex/Preprocessor.h>
 
 #include <string.h>
+#include <thread>
 
 using namespace clang;
 
@@ -50,6 +53,18 @@ struct Context {
     ZigList<MacroSymbol> macro_symbols;
     AstNode *source_node;
 
+    // for a c_import, the names which the zig code able to see it could
+    // refer to. only the declarations and macros with these names are
+    // translated. null means translate everything, as zig parseh does.
+    HashMap<Buf *, bool, buf_hash, buf_eql_buf> *wanted_names;
+    // every top level decl, and for each name, the indexes into decls of
+    // the ones which declare it
+    ZigList<const Decl *> decls;
+    HashMap<Buf *, ZigList<int>, buf_hash, buf_eql_buf> decl_index;
+    // macro definitions, which are translated once it is known which
+    // ones are wanted
+    ZigList<MacroSymbol> macro_defs;
+
     CodeGen *codegen;
     bool transform_extern_fn_ptr;
 };
@@ -59,6 +74,8 @@ static TypeTableEntry *resolve_qual_type_with_table(Context *c, QualType qt, con
 
 static TypeTableEntry *resolve_qual_type(Context *c, QualType qt, const Decl *decl);
 static TypeTableEntry *resolve_record_decl(Context *c, const RecordDecl *record_decl);
+static void visit_typedef_decl(Context *c, const TypedefNameDecl *typedef_decl);
+static void visit_enum_decl(Context *c, const EnumDecl *enum_decl);
 
 
 __attribute__ ((format (printf, 3, 4)))
@@ -94,7 +111,7 @@ static uint32_t get_next_node_index(Context *c) {
 }
 
 static AstNode *create_node(Context *c, NodeType type) {
-    AstNode *node = allocate<AstNode>(1);
+    AstNode *node = arena_allocate<AstNode>(c->import->arena, 1);
     node->type = type;
     node->owner = c->import;
     node->create_index = get_next_node_index(c);
@@ -103,14 +120,14 @@ static AstNode *create_node(Context *c, NodeType type) {
 
 static AstNode *create_symbol_node(Context *c, const char *type_name) {
     AstNode *node = create_node(c, NodeTypeSymbol);
-    buf_init_from_str(&node->data.symbol_expr.symbol, type_name);
+    node->data.symbol_expr.symbol = buf_intern_str(type_name);
     return node;
 }
 
 static AstNode *create_field_access_node(Context *c, const char *lhs, const char *rhs) {
     AstNode *node = create_node(c, NodeTypeFieldAccessExpr);
     node->data.field_access_expr.struct_expr = create_symbol_node(c, lhs);
-    buf_init_from_str(&node->data.field_access_expr.field_name, rhs);
+    node->data.field_access_expr.field_name = buf_intern_str(rhs);
     normalize_parent_ptrs(node);
     return node;
 }
@@ -119,7 +136,7 @@ static AstNode *create_typed_var_decl_node(Context *c, bool is_const, const char
         AstNode *type_node, AstNode *init_node)
 {
     AstNode *node = create_node(c, NodeTypeVariableDeclaration);
-    buf_init_from_str(&node->data.variable_declaration.symbol, var_name);
+    node->data.variable_declaration.symbol = buf_intern_str(var_name);
     node->data.variable_declaration.is_const = is_const;
     node->data.variable_declaration.visib_mod = c->visib_mod;
     node->data.variable_declaration.expr = init_node;
@@ -156,7 +173,7 @@ static AstNode *create_struct_field_node(Context *c, const char *name, AstNode *
 static AstNode *create_param_decl_node(Context *c, const char *name, AstNode *type_node, bool is_noalias) {
     assert(type_node);
     AstNode *node = create_node(c, NodeTypeParamDecl);
-    buf_init_from_str(&node->data.param_decl.name, name);
+    node->data.param_decl.name = buf_intern_str(name);
     node->data.param_decl.type = type_node;
     node->data.param_decl.is_noalias = is_noalias;
 
@@ -201,7 +218,7 @@ static AstNode *create_num_lit_signed(Context *c, int64_t x) {
 
 static AstNode *create_type_decl_node(Context *c, const char *name, AstNode *child_type_node) {
     AstNode *node = create_node(c, NodeTypeTypeDecl);
-    buf_init_from_str(&node->data.type_decl.symbol, name);
+    node->data.type_decl.symbol = buf_intern_str(name);
     node->data.type_decl.visib_mod = c->visib_mod;
     node->data.type_decl.child_type = child_type_node;
 
@@ -220,7 +237,7 @@ static AstNode *create_fn_proto_node(Context *c, Buf *name, TypeTableEntry *fn_t
     AstNode *node = create_node(c, NodeTypeFnProto);
     node->data.fn_proto.is_inline = true;
     node->data.fn_proto.visib_mod = c->visib_mod;
-    buf_init_from_buf(&node->data.fn_proto.name, name);
+    node->data.fn_proto.name = buf_intern(name);
     node->data.fn_proto.return_type = make_type_node(c, fn_type->data.fn.fn_type_id.return_type);
 
     for (int i = 0; i < fn_type->data.fn.fn_type_id.param_count; i += 1) {
@@ -253,7 +270,7 @@ static AstNode *create_inline_fn_node(Context *c, Buf *fn_name, Buf *var_name, T
     fn_call_node->data.fn_call_expr.fn_ref_expr = unwrap_node;
     for (int i = 0; i < fn_type->data.fn.fn_type_id.param_count; i += 1) {
         AstNode *decl_node = node->data.fn_def.fn_proto->data.fn_proto.params.at(i);
-        Buf *param_name = &decl_node->data.param_decl.name;
+        Buf *param_name = decl_node->data.param_decl.name;
         fn_call_node->data.fn_call_expr.params.append(create_symbol_node(c, buf_ptr(param_name)));
     }
 
@@ -443,6 +460,12 @@ static TypeTableEntry *resolve_type_with_table(Context *c, const Type *ty, const
                     return c->codegen->builtin_types.entry_usize;
                 } else {
                     auto entry = type_table->maybe_get(type_name);
+                    if (!entry && c->wanted_names) {
+                        // the zig code never named this typedef, but something
+                        // it did name needs it
+                        visit_typedef_decl(c, typedef_decl);
+                        entry = type_table->maybe_get(type_name);
+                    }
                     if (entry) {
                         if (get_underlying_type(entry->value)->id == TypeTableEntryIdInvalid) {
                             return c->codegen->builtin_types.entry_invalid;
@@ -576,6 +599,10 @@ static TypeTableEntry *resolve_type_with_table(Context *c, const Type *ty, const
                 }
 
                 auto entry = type_table->maybe_get(record_name);
+                if (!entry && c->wanted_names) {
+                    visit_enum_decl(c, enum_ty->getDecl());
+                    entry = type_table->maybe_get(record_name);
+                }
                 if (!entry) {
                     return c->codegen->builtin_types.entry_invalid;
                 }
@@ -674,7 +701,7 @@ static void visit_fn_decl(Context *c, const FunctionDecl *fn_decl) {
 
 
     AstNode *node = create_node(c, NodeTypeFnProto);
-    buf_init_from_buf(&node->data.fn_proto.name, &fn_name);
+    node->data.fn_proto.name = buf_intern(&fn_name);
 
     node->data.fn_proto.is_extern = fn_type->data.fn.fn_type_id.is_extern;
     node->data.fn_proto.visib_mod = c->visib_mod;
@@ -709,6 +736,12 @@ static void visit_typedef_decl(Context *c, const TypedefNameDecl *typedef_decl)
     QualType child_qt = typedef_decl->getUnderlyingType();
     Buf *type_name = buf_create_from_str(decl_name(typedef_decl));
 
+    if (c->global_type_table.maybe_get(type_name)) {
+        // already translated, because a type needed it or it was declared
+        // twice
+        return;
+    }
+
     if (buf_eql_str(type_name, "uint8_t") ||
         buf_eql_str(type_name, "int8_t") ||
         buf_eql_str(type_name, "uint16_t") ||
@@ -1189,6 +1222,137 @@ static bool decl_visitor(void *context, const Decl *decl) {
     return true;
 }
 
+static bool is_wanted(Context *c, Buf *name) {
+    return !c->wanted_names || c->wanted_names->maybe_get(name);
+}
+
+static void add_wanted_name(HashMap<Buf *, bool, buf_hash, buf_eql_buf> *names, const char *ptr, int len) {
+    Buf name = BUF_INIT;
+    buf_init_from_mem(&name, ptr, len);
+    if (!names->maybe_get(&name)) {
+        names->put(buf_create_from_buf(&name), true);
+    }
+    buf_deinit(&name);
+}
+
+// Every identifier in the source counts, even in comments and strings,
+// which only means that a few declarations get translated for nothing.
+static void add_wanted_names_from_source(HashMap<Buf *, bool, buf_hash, buf_eql_buf> *names, Buf *source) {
+    const char *ptr = buf_ptr(source);
+    const char *end = ptr + buf_len(source);
+    while (ptr < end) {
+        if (!valid_symbol_starter(*ptr)) {
+            ptr += 1;
+            continue;
+        }
+        const char *start = ptr;
+        while (ptr < end && (valid_symbol_starter(*ptr) || (*ptr >= '0' && *ptr <= '9'))) {
+            ptr += 1;
+        }
+        add_wanted_name(names, start, ptr - start);
+    }
+}
+
+static void index_decl_name(Context *c, Buf *name, int index) {
+    if (buf_len(name) == 0) {
+        return;
+    }
+    if (auto entry = c->decl_index.maybe_get(name)) {
+        entry->value.append(index);
+        return;
+    }
+    ZigList<int> indexes = {0};
+    indexes.append(index);
+    c->decl_index.put(name, indexes);
+}
+
+// Records the decl, and when only some names are wanted, every name under
+// which zig code could refer to it.
+static bool index_visitor(void *context, const Decl *decl) {
+    Context *c = (Context*)context;
+    int index = c->decls.length;
+    c->decls.append(decl);
+
+    if (!c->wanted_names) {
+        return true;
+    }
+
+    switch (decl->getKind()) {
+        case Decl::Function:
+        case Decl::Typedef:
+        case Decl::Var:
+            index_decl_name(c, buf_create_from_str(decl_name(decl)), index);
+            break;
+        case Decl::Enum:
+            {
+                const EnumDecl *enum_decl = static_cast<const EnumDecl *>(decl);
+                const char *raw_name = decl_name(enum_decl);
+                if (raw_name[0] == 0) {
+                    break;
+                }
+                index_decl_name(c, buf_create_from_str(raw_name), index);
+                index_decl_name(c, buf_sprintf("enum_%s", raw_name), index);
+                // the enum values are put in the global namespace too
+                const EnumDecl *enum_def = enum_decl->getDefinition();
+                if (enum_def) {
+                    for (auto it = enum_def->enumerator_begin(),
+                              it_end = enum_def->enumerator_end();
+                              it != it_end; ++it)
+                    {
+                        index_decl_name(c, buf_create_from_str(decl_name(*it)), index);
+                    }
+                }
+                break;
+            }
+        case Decl::Record:
+            {
+                const char *raw_name = decl_name(decl);
+                if (raw_name[0] == 0) {
+                    break;
+                }
+                index_decl_name(c, buf_create_from_str(raw_name), index);
+                index_decl_name(c, buf_sprintf("struct_%s", raw_name), index);
+                break;
+            }
+        default:
+            break;
+    }
+
+    return true;
+}
+
+static void visit_wanted_decls(Context *c) {
+    if (!c->wanted_names) {
+        for (int i = 0; i < c->decls.length; i += 1) {
+            decl_visitor(c, c->decls.at(i));
+        }
+        return;
+    }
+
+    bool *wanted = allocate<bool>(c->decls.length);
+    auto it = c->decl_index.entry_iterator();
+    for (;;) {
+        auto *entry = it.next();
+        if (!entry)
+            break;
+
+        if (!c->wanted_names->maybe_get(entry->key))
+            continue;
+
+        for (int i = 0; i < entry->value.length; i += 1) {
+            wanted[entry->value.at(i)] = true;
+        }
+    }
+
+    // in the order clang saw them, same as when everything is translated
+    for (int i = 0; i < c->decls.length; i += 1) {
+        if (wanted[i]) {
+            decl_visitor(c, c->decls.at(i));
+        }
+    }
+    free(wanted);
+}
+
 static bool name_exists(Context *c, Buf *name) {
     if (c->global_type_table.maybe_get(name)) {
         return true;
@@ -1225,7 +1389,7 @@ static void render_aliases(Context *c) {
     for (int i = 0; i < c->aliases.length; i += 1) {
         AstNode *alias_node = c->aliases.at(i);
         assert(alias_node->type == NodeTypeVariableDeclaration);
-        Buf *name = &alias_node->data.variable_declaration.symbol;
+        Buf *name = alias_node->data.variable_declaration.symbol;
         if (name_exists(c, name)) {
             continue;
         }
@@ -1473,6 +1637,20 @@ static void process_symbol_macros(Context *c) {
     }
 }
 
+static Buf *read_macro_value(Context *c, SourceLocation end_loc) {
+    const char *end_c = c->source_manager->getCharacterData(end_loc);
+    Buf *value = buf_alloc();
+    while (*end_c && *end_c != '\n') {
+        buf_append_char(value, *end_c);
+        if (end_c[0] == '\\' && end_c[1] == '\n') {
+            end_c += 2;
+        } else {
+            end_c += 1;
+        }
+    }
+    return value;
+}
+
 static void process_preprocessor_entities(Context *c, ASTUnit &unit) {
     for (PreprocessedEntity *entity : unit.getLocalPreprocessingEntities()) {
         switch (entity->getKind()) {
@@ -1494,63 +1672,111 @@ static void process_preprocessor_entities(Context *c, ASTUnit &unit) {
                         continue;
                     }
 
-                    const char *end_c = c->source_manager->getCharacterData(end_loc);
-                    Buf *value = buf_alloc();
-                    while (*end_c && *end_c != '\n') {
-                        buf_append_char(value, *end_c);
-                        if (end_c[0] == '\\' && end_c[1] == '\n') {
-                            end_c += 2;
-                        } else {
-                            end_c += 1;
-                        }
-                    }
-                    process_macro(c, buf_create_from_str(name), value);
+                    c->macro_defs.append({buf_create_from_str(name), read_macro_value(c, end_loc)});
                 }
         }
     }
 }
 
-int parse_h_buf(ImportTableEntry *import, ZigList<ErrorMsg *> *errors, Buf *source,
-        CodeGen *codegen, AstNode *source_node)
-{
-    int err;
-    Buf tmp_file_path = BUF_INIT;
-    if ((err = os_buf_to_tmp_file(source, buf_create_from_str(".h"), &tmp_file_path))) {
-        return err;
+// Looks up the macros for the wanted names which no decl declares, in the
+// preprocessor's own table, so no preprocessing record is needed.
+static void process_referenced_macros(Context *c, Preprocessor &pp) {
+    ZigList<Buf *> names = {0};
+    auto it = c->wanted_names->entry_iterator();
+    for (;;) {
+        auto *entry = it.next();
+        if (!entry)
+            break;
+
+        names.append(entry->key);
     }
 
-    err = parse_h_file(import, errors, buf_ptr(&tmp_file_path), codegen, source_node);
+    while (names.length > 0) {
+        Buf *name = names.pop();
+        if (c->decl_index.maybe_get(name)) {
+            continue;
+        }
+        IdentifierInfo *ident = pp.getIdentifierInfo(StringRef(buf_ptr(name), buf_len(name)));
+        const MacroInfo *macro = pp.getMacroInfo(ident);
+        if (!macro || macro->getDefinitionLoc() == macro->getDefinitionEndLoc()) {
+            continue;
+        }
+
+        Buf *value = read_macro_value(c, macro->getDefinitionEndLoc());
+        c->macro_defs.append({name, value});
+        if (is_simple_symbol(value) && !is_wanted(c, value)) {
+            c->wanted_names->put(value, true);
+            names.append(value);
+        }
+    }
+    names.deinit();
+}
 
-    os_delete_file(&tmp_file_path);
+static void process_macro_defs(Context *c) {
+    if (c->wanted_names) {
+        // a wanted macro which names something else makes that wanted too,
+        // so that process_symbol_macros can find it
+        bool progress = true;
+        while (progress) {
+            progress = false;
+            for (int i = 0; i < c->macro_defs.length; i += 1) {
+                MacroSymbol def = c->macro_defs.at(i);
+                if (is_wanted(c, def.name) && is_simple_symbol(def.value) && !is_wanted(c, def.value)) {
+                    c->wanted_names->put(def.value, true);
+                    progress = true;
+                }
+            }
+        }
+    }
 
-    return err;
+    for (int i = 0; i < c->macro_defs.length; i += 1) {
+        MacroSymbol def = c->macro_defs.at(i);
+        if (is_wanted(c, def.name)) {
+            process_macro(c, def.name, def.value);
+        }
+    }
 }
 
-int parse_h_file(ImportTableEntry *import, ZigList<ErrorMsg *> *errors, const char *target_file,
-        CodeGen *codegen, AstNode *source_node)
-{
-    Context context = {0};
-    Context *c = &context;
-    c->warnings_on = codegen->verbose;
-    c->import = import;
-    c->errors = errors;
-    c->visib_mod = VisibModPub;
-    c->global_type_table.init(8);
-    c->global_value_table.init(8);
-    c->enum_type_table.init(8);
-    c->struct_type_table.init(8);
-    c->struct_decl_table.init(8);
-    c->fn_table.init(8);
-    c->macro_table.init(8);
-    c->codegen = codegen;
-    c->source_node = source_node;
+struct ParseHJob {
+    ImportTableEntry *import;
+    CodeGen *codegen;
+    AstNode *source_node;
+    const char *target_file;
+    // for parse_h_buf, the contents of target_file, which exists only in
+    // memory
+    std::unique_ptr<llvm::MemoryBuffer> source_buffer;
+    ZigList<const char *> clang_argv;
+    // whether clang records every macro definition, for translating all of
+    // them. otherwise, referenced macros come from the preprocessor itself
+    bool macro_record;
+
+    // for parse_h_buf with the cache enabled. clang's AST for the source is
+    // saved to the cache, and loaded instead of parsing the headers again
+    // as long as none of them have changed
+    CacheHash *cache;
+    bool cache_hit;
+    std::string ast_path;
+    std::string ast_tmp_path;
+    bool ast_saved;
+    // the headers clang opened, other than target_file
+    ZigList<Buf *> header_files;
+
+    IntrusiveRefCntPtr<DiagnosticsEngine> diags;
+    std::unique_ptr<ASTUnit> ast_unit;
+    std::unique_ptr<ASTUnit> err_unit;
+    std::thread thread;
+};
 
-    ZigList<const char *> clang_argv = {0};
+// Everything which touches zig's data structures is done here, on the
+// calling thread, so that load_ast_unit can run on its own.
+static void init_clang_argv(ParseHJob *job) {
+    CodeGen *codegen = job->codegen;
+    ZigList<const char *> &clang_argv = job->clang_argv;
 
     clang_argv.append("-x");
     clang_argv.append("c");
 
-    if (c->codegen->is_native_target) {
+    if (codegen->is_native_target) {
         char *ZIG_PARSEH_CFLAGS = getenv("ZIG_NATIVE_PARSEH_CFLAGS");
         if (ZIG_PARSEH_CFLAGS) {
             Buf tmp_buf = BUF_INIT;
@@ -1582,22 +1808,41 @@ int parse_h_file(ImportTableEntry *import, ZigList<ErrorMsg *> *errors, const ch
     // we don't need spell checking and it slows things down
     clang_argv.append("-fno-spell-checking");
 
-    // this gives us access to preprocessing entities, presumably at
-    // the cost of performance
-    clang_argv.append("-Xclang");
-    clang_argv.append("-detailed-preprocessing-record");
+    // with no zig code to name anything, as for zig parseh, every macro
+    // counts as referenced
+    job->macro_record = codegen->c_macros == CMacrosAll ||
+        (codegen->c_macros == CMacrosReferenced && !job->source_node);
+    if (job->macro_record) {
+        // this gives us access to preprocessing entities, presumably at
+        // the cost of performance
+        clang_argv.append("-Xclang");
+        clang_argv.append("-detailed-preprocessing-record");
+    }
 
-    if (!c->codegen->is_native_target) {
+    if (!codegen->is_native_target) {
         clang_argv.append("-target");
-        clang_argv.append(buf_ptr(&c->codegen->triple_str));
+        clang_argv.append(buf_ptr(&codegen->triple_str));
     }
 
-    clang_argv.append(target_file);
+    clang_argv.append(job->target_file);
 
     // to make the [start...end] argument work
     clang_argv.append(nullptr);
+}
+
+static void get_remapped_files(ParseHJob *job, SmallVectorImpl<ASTUnit::RemappedFile> &out) {
+    if (job->source_buffer) {
+        // clang takes ownership of remapped buffers, so each gets a copy
+        out.push_back(std::make_pair(std::string(job->target_file),
+                    llvm::MemoryBuffer::getMemBufferCopy(job->source_buffer->getBuffer(),
+                        job->target_file).release()));
+    }
+}
 
-    IntrusiveRefCntPtr<DiagnosticsEngine> diags(CompilerInstance::createDiagnostics(new DiagnosticOptions));
+// Only uses clang, and each job has its own clang instance, so this can run
+// on a thread of its own.
+static void load_ast_unit(ParseHJob *job) {
+    job->diags = CompilerInstance::createDiagnostics(new DiagnosticOptions);
 
     std::shared_ptr<PCHContainerOperations> pch_container_ops = std::make_shared<PCHContainerOperations>();
 
@@ -1607,21 +1852,68 @@ int parse_h_file(ImportTableEntry *import, ZigList<ErrorMsg *> *errors, const ch
     bool user_files_are_volatile = true;
     bool allow_pch_with_compiler_errors = false;
     const char *resources_path = ZIG_HEADERS_DIR;
-    std::unique_ptr<ASTUnit> err_unit;
-    std::unique_ptr<ASTUnit> ast_unit(ASTUnit::LoadFromCommandLine(
-            &clang_argv.at(0), &clang_argv.last(),
-            pch_container_ops, diags, resources_path,
-            only_local_decls, capture_diagnostics, None, true, false, TU_Complete,
+
+    if (job->cache_hit) {
+        SmallVector<ASTUnit::RemappedFile, 1> remapped_files;
+        get_remapped_files(job, remapped_files);
+        job->ast_unit = ASTUnit::LoadFromASTFile(job->ast_path, pch_container_ops->getRawReader(),
+                job->diags, FileSystemOptions(), only_local_decls, remapped_files, capture_diagnostics,
+                allow_pch_with_compiler_errors, user_files_are_volatile);
+        if (job->ast_unit && job->diags->getClient()->getNumErrors() == 0) {
+            return;
+        }
+        // clang rejects AST files when, for example, a header was touched
+        // since. parse from scratch instead, which replaces the entry. the
+        // headers are found again by the new parse, so forget the ones the
+        // manifest listed or finish_cache would record them twice
+        job->ast_unit.reset();
+        job->cache_hit = false;
+        job->cache->files.clear();
+        job->diags = CompilerInstance::createDiagnostics(new DiagnosticOptions);
+    }
+
+    SmallVector<ASTUnit::RemappedFile, 1> remapped_files;
+    get_remapped_files(job, remapped_files);
+    job->ast_unit.reset(ASTUnit::LoadFromCommandLine(
+            &job->clang_argv.at(0), &job->clang_argv.last(),
+            pch_container_ops, job->diags, resources_path,
+            only_local_decls, capture_diagnostics, remapped_files, true, false, TU_Complete,
             false, false, allow_pch_with_compiler_errors, skip_function_bodies,
-            user_files_are_volatile, false, &err_unit));
+            user_files_are_volatile, false, &job->err_unit));
 
+    if (job->cache && job->ast_unit && job->diags->getClient()->getNumErrors() == 0) {
+        // Save returns true on failure
+        job->ast_saved = !job->ast_unit->Save(job->ast_tmp_path);
+    }
+}
+
+static int translate_ast_unit(ParseHJob *job, ZigList<ErrorMsg *> *errors) {
+    Context context = {0};
+    Context *c = &context;
+    c->warnings_on = job->codegen->verbose;
+    c->import = job->import;
+    c->errors = errors;
+    c->visib_mod = VisibModPub;
+    c->global_type_table.init(8);
+    c->global_value_table.init(8);
+    c->enum_type_table.init(8);
+    c->struct_type_table.init(8);
+    c->struct_decl_table.init(8);
+    c->fn_table.init(8);
+    c->macro_table.init(8);
+    c->codegen = job->codegen;
+    c->source_node = job->source_node;
+
+    CodeGen *codegen = job->codegen;
+    std::unique_ptr<ASTUnit> &ast_unit = job->ast_unit;
+    std::unique_ptr<ASTUnit> &err_unit = job->err_unit;
 
     // Early failures in LoadFromCommandLine may return with ErrUnit unset.
     if (!ast_unit && !err_unit) {
         return ErrorFileSystem;
     }
 
-    if (diags->getClient()->getNumErrors() > 0) {
+    if (job->diags->getClient()->getNumErrors() > 0) {
         if (ast_unit) {
             err_unit = std::move(ast_unit);
         }
@@ -1666,10 +1958,53 @@ int parse_h_file(ImportTableEntry *import, ZigList<ErrorMsg *> *errors, const ch
 
     c->source_manager = &ast_unit->getSourceManager();
 
+    // the build cache needs to know every header which went into this
+    if (job->cache_hit) {
+        // an AST file only opens headers as it needs them, so take the list
+        // from the cache manifest
+        for (int i = 0; i < job->cache->files.length; i += 1) {
+            job->header_files.append(job->cache->files.at(i).path);
+        }
+    } else {
+        for (SourceManager::fileinfo_iterator it = c->source_manager->fileinfo_begin(),
+                it_end = c->source_manager->fileinfo_end(); it != it_end; ++it)
+        {
+            const char *file_name = it->first->getName();
+            if (strcmp(file_name, job->target_file) != 0) {
+                job->header_files.append(buf_create_from_str(file_name));
+            }
+        }
+    }
+    if (codegen->cache_hash) {
+        for (int i = 0; i < job->header_files.length; i += 1) {
+            codegen->c_import_files.append(job->header_files.at(i));
+        }
+    }
+
+    // a c_import only translates what the zig code which can see it might
+    // use. macros are read first because they can name declarations.
+    HashMap<Buf *, bool, buf_hash, buf_eql_buf> wanted_names;
+    if (job->source_node) {
+        wanted_names.init(64);
+        c->wanted_names = &wanted_names;
+        c->decl_index.init(64);
+        for (int i = 0; i < job->import->importers.length; i += 1) {
+            ImportTableEntry *importer = job->import->importers.at(i).import;
+            add_wanted_names_from_source(&wanted_names, importer->source_code);
+        }
+    }
+
     c->root = create_node(c, NodeTypeRoot);
-    ast_unit->visitLocalTopLevelDecls(c, decl_visitor);
+    ast_unit->visitLocalTopLevelDecls(c, index_visitor);
+
+    if (job->macro_record) {
+        process_preprocessor_entities(c, *ast_unit);
+    } else if (codegen->c_macros == CMacrosReferenced) {
+        process_referenced_macros(c, ast_unit->getPreprocessor());
+    }
+    process_macro_defs(c);
 
-    process_preprocessor_entities(c, *ast_unit);
+    visit_wanted_decls(c);
 
     process_symbol_macros(c);
 
@@ -1677,7 +2012,159 @@ int parse_h_file(ImportTableEntry *import, ZigList<ErrorMsg *> *errors, const ch
     render_aliases(c);
 
     normalize_parent_ptrs(c->root);
-    import->root = c->root;
+    job->import->root = c->root;
 
+    if (c->wanted_names) {
+        wanted_names.deinit();
+    }
     return 0;
 }
+
+static ParseHJob *create_job(ImportTableEntry *import, CodeGen *codegen, AstNode *source_node) {
+    ParseHJob *job = new ParseHJob();
+    job->import = import;
+    job->codegen = codegen;
+    job->source_node = source_node;
+    return job;
+}
+
+static void init_cache(ParseHJob *job, Buf *source) {
+    CodeGen *codegen = job->codegen;
+    if (!codegen->enable_cache) {
+        return;
+    }
+
+    CacheHash *ch = allocate<CacheHash>(1);
+    cache_init(ch, codegen->cache_dir);
+    cache_compiler_id(ch);
+    cache_str(ch, "c_import");
+    cache_buf(ch, source);
+    // this covers the target, the libc include dir and any other flags
+    for (int i = 0; i < job->clang_argv.length - 1; i += 1) {
+        cache_str(ch, job->clang_argv.at(i));
+    }
+    cache_buf(ch, &codegen->triple_str);
+
+    bool hit;
+    if (cache_hit(ch, &hit)) {
+        return;
+    }
+    job->cache = ch;
+    job->cache_hit = hit;
+
+    Buf *ast_path = cache_artifact_path(ch, "c_import.ast");
+    job->ast_path = buf_ptr(ast_path);
+    job->ast_tmp_path = buf_ptr(cache_tmp_path(ast_path));
+    if (codegen->verbose && hit) {
+        fprintf(stderr, "\nusing cached %s\n", buf_ptr(ast_path));
+    }
+}
+
+// Puts the AST file written by load_ast_unit in place, and records the
+// headers it was made from.
+static void finish_cache(ParseHJob *job, bool ok) {
+    Buf *ast_tmp_path = buf_create_from_str(job->ast_tmp_path.c_str());
+    if (!ok) {
+        os_delete_file(ast_tmp_path);
+        return;
+    }
+
+    CacheHash *ch = job->cache;
+    int err;
+    for (int i = 0; i < job->header_files.length; i += 1) {
+        if ((err = cache_add_file_path(ch, job->header_files.at(i)))) {
+            // a header which can't be read can't be checked later either
+            os_delete_file(ast_tmp_path);
+            return;
+        }
+    }
+    if ((err = os_rename(ast_tmp_path, buf_create_from_str(job->ast_path.c_str()))) ||
+        (err = cache_final(ch)))
+    {
+        if (job->codegen->verbose) {
+            fprintf(stderr, "unable to add %s to the cache: %s\n", job->ast_path.c_str(), err_str(err));
+        }
+    }
+}
+
+static int finish_job(ParseHJob *job, ZigList<ErrorMsg *> *errors) {
+    if (job->thread.joinable()) {
+        job->thread.join();
+    }
+
+    int old_error_count = errors->length;
+    int err = translate_ast_unit(job, errors);
+
+    if (job->ast_saved) {
+        finish_cache(job, !err && errors->length == old_error_count);
+    }
+    job->header_files.deinit();
+    job->clang_argv.deinit();
+    delete job;
+    return err;
+}
+
+// The path clang is given for the source of a c_import. Clang looks for
+// a quoted #include in the directory of the file doing the including
+// before the include path, so the file is put next to the zig file with
+// the c_import: @c_include("foo.h") then finds the foo.h beside it, as
+// #include "foo.h" would in a C file there. The zig file's name is part of
+// it so that it can't be mistaken for a header that someone includes.
+static const char *c_import_file_path(ImportTableEntry *owner) {
+    Buf dirname = BUF_INIT;
+    Buf basename = BUF_INIT;
+    os_path_split(owner->path, &dirname, &basename);
+
+    Buf *abs_dirname = buf_alloc();
+    if (buf_len(&dirname) == 0 || os_path_real(&dirname, abs_dirname)) {
+        os_get_cwd(abs_dirname);
+    }
+
+    Buf *path = buf_alloc();
+    os_path_join(abs_dirname, buf_sprintf("%s.c_import.h", buf_ptr(&basename)), path);
+    buf_deinit(&dirname);
+    buf_deinit(&basename);
+    return buf_ptr(path);
+}
+
+ParseHJob *parse_h_buf_begin(ImportTableEntry *import, Buf *source, CodeGen *codegen, AstNode *source_node) {
+    ParseHJob *job = create_job(import, codegen, source_node);
+    // clang sees this file, but it is never written to disk
+    job->target_file = c_import_file_path(source_node ? source_node->owner : import);
+    job->source_buffer = llvm::MemoryBuffer::getMemBufferCopy(
+            StringRef(buf_ptr(source), buf_len(source)), job->target_file);
+    init_clang_argv(job);
+    init_cache(job, source);
+    job->thread = std::thread(load_ast_unit, job);
+    return job;
+}
+
+ParseHJob *parse_h_file_begin(ImportTableEntry *import, const char *target_file, CodeGen *codegen,
+        AstNode *source_node)
+{
+    ParseHJob *job = create_job(import, codegen, source_node);
+    job->target_file = target_file;
+    init_clang_argv(job);
+    job->thread = std::thread(load_ast_unit, job);
+    return job;
+}
+
+int parse_h_finish(ParseHJob *job, ZigList<ErrorMsg *> *errors) {
+    return finish_job(job, errors);
+}
+
+int parse_h_buf(ImportTableEntry *import, ZigList<ErrorMsg *> *errors, Buf *source,
+        CodeGen *codegen, AstNode *source_node)
+{
+    return parse_h_finish(parse_h_buf_begin(import, source, codegen, source_node), errors);
+}
+
+int parse_h_file(ImportTableEntry *import, ZigList<ErrorMsg *> *errors, const char *target_file,
+        CodeGen *codegen, AstNode *source_node)
+{
+    ParseHJob *job = create_job(import, codegen, source_node);
+    job->target_file = target_file;
+    init_clang_argv(job);
+    load_ast_unit(job);
+    return finish_job(job, errors);
+}
@@ -17,4 +17,13 @@ int parse_h_file(ImportTableEntry *import, ZigList<ErrorMsg *> *errors, const ch
 int parse_h_buf(ImportTableEntry *import, ZigList<ErrorMsg *> *errors, Buf *source,
         CodeGen *codegen, AstNode *source_node);
 
+// parse_h_buf and parse_h_file in two steps. begin starts clang on a
+// thread of its own and returns right away; parse_h_finish waits for it and
+// translates the result into import. Both must be called from the thread
+// which owns codegen.
+ParseHJob *parse_h_buf_begin(ImportTableEntry *import, Buf *source, CodeGen *codegen, AstNode *source_node);
+ParseHJob *parse_h_file_begin(ImportTableEntry *import, const char *target_file, CodeGen *codegen,
+        AstNode *source_node);
+int parse_h_finish(ParseHJob *job, ZigList<ErrorMsg *> *errors);
+
 #endif
@@ -17,11 +17,14 @@
 struct ParseContext {
     Buf *buf;
     AstNode *root;
-    ZigList<Token> *tokens;
+    TokenList *tokens;
     ImportTableEntry *owner;
     ErrColor err_color;
     bool parsed_root_export;
     uint32_t *next_node_index;
+    // statements and top level decls are collected here and then copied into
+    // a list of exactly the right size
+    ZigList<AstNode *> node_stack;
 };
 
 __attribute__ ((format (printf, 4, 5)))
@@ -46,24 +49,27 @@ static void ast_asm_error(ParseContext *pc, AstNode *node, int offset, const cha
 
 __attribute__ ((format (printf, 3, 4)))
 __attribute__ ((noreturn))
-static void ast_error(ParseContext *pc, Token *token, const char *format, ...) {
+static void ast_error(ParseContext *pc, int token, const char *format, ...) {
     va_list ap;
     va_start(ap, format);
     Buf *msg = buf_vprintf(format, ap);
     va_end(ap);
 
 
-    ErrorMsg *err = err_msg_create_with_line(pc->owner->path, token->start_line, token->start_column,
+    int line;
+    int column;
+    token_line_column(pc->tokens, token, &line, &column);
+    ErrorMsg *err = err_msg_create_with_line(pc->owner->path, line, column,
             pc->owner->source_code, pc->owner->line_offsets, msg);
-    err->line_start = token->start_line;
-    err->column_start = token->start_column;
+    err->line_start = line;
+    err->column_start = column;
 
     print_err_msg(err, pc->err_color);
     exit(EXIT_FAILURE);
 }
 
 static AstNode *ast_create_node_no_line_info(ParseContext *pc, NodeType type) {
-    AstNode *node = allocate<AstNode>(1);
+    AstNode *node = arena_allocate<AstNode>(pc->owner->arena, 1);
     node->type = type;
     node->owner = pc->owner;
     node->create_index = *pc->next_node_index;
@@ -71,25 +77,37 @@ static AstNode *ast_create_node_no_line_info(ParseContext *pc, NodeType type) {
     return node;
 }
 
-static void ast_update_node_line_info(AstNode *node, Token *first_token) {
-    node->line = first_token->start_line;
-    node->column = first_token->start_column;
+static void ast_update_node_line_info(ParseContext *pc, AstNode *node, int first_token) {
+    token_line_column(pc->tokens, first_token, &node->line, &node->column);
 }
 
-static AstNode *ast_create_node(ParseContext *pc, NodeType type, Token *first_token) {
+static AstNode *ast_create_node(ParseContext *pc, NodeType type, int first_token) {
     AstNode *node = ast_create_node_no_line_info(pc, type);
-    ast_update_node_line_info(node, first_token);
+    ast_update_node_line_info(pc, node, first_token);
     return node;
 }
 
-static AstNode *ast_create_void_type_node(ParseContext *pc, Token *token) {
+static AstNode *ast_create_void_type_node(ParseContext *pc, int token) {
     AstNode *node = ast_create_node(pc, NodeTypeSymbol, token);
-    buf_init_from_str(&node->data.symbol_expr.symbol, "void");
+    node->data.symbol_expr.symbol = buf_intern_str("void");
     return node;
 }
 
-static void ast_buf_from_token(ParseContext *pc, Token *token, Buf *buf) {
-    buf_init_from_mem(buf, buf_ptr(pc->buf) + token->start_pos, token->end_pos - token->start_pos);
+static void ast_pop_node_list(ParseContext *pc, int base, ZigList<AstNode *> *list) {
+    int count = pc->node_stack.length - base;
+    list->reserve(list->length + count);
+    for (int i = base; i < pc->node_stack.length; i += 1) {
+        list->append(pc->node_stack.at(i));
+    }
+    pc->node_stack.resize(base);
+}
+
+static void ast_buf_from_token(ParseContext *pc, int token, Buf *buf) {
+    buf_init_from_mem(buf, buf_ptr(pc->buf) + token_start_pos(pc->tokens, token), token_end_pos(pc->tokens, token) - token_start_pos(pc->tokens, token));
+}
+
+static Buf *ast_intern_token(ParseContext *pc, int token) {
+    return buf_intern_mem(buf_ptr(pc->buf) + token_start_pos(pc->tokens, token), token_end_pos(pc->tokens, token) - token_start_pos(pc->tokens, token));
 }
 
 static void parse_asm_template(ParseContext *pc, AstNode *node) {
@@ -175,13 +193,13 @@ static void parse_asm_template(ParseContext *pc, AstNode *node) {
     }
 }
 
-static uint8_t parse_char_literal(ParseContext *pc, Token *token) {
+static uint8_t parse_char_literal(ParseContext *pc, int token) {
     // skip the single quotes at beginning and end
     // convert escape sequences
     bool escape = false;
     int return_count = 0;
     uint8_t return_value;
-    for (int i = token->start_pos + 1; i < token->end_pos - 1; i += 1) {
+    for (int i = token_start_pos(pc->tokens, token) + 1; i < token_end_pos(pc->tokens, token) - 1; i += 1) {
         uint8_t c = *((uint8_t*)buf_ptr(pc->buf) + i);
         if (escape) {
             switch (c) {
@@ -224,7 +242,7 @@ static uint8_t parse_char_literal(ParseContext *pc, Token *token) {
     return return_value;
 }
 
-static void parse_string_literal(ParseContext *pc, Token *token, Buf *buf, bool *out_c_str,
+static void parse_string_literal(ParseContext *pc, int token, Buf *buf, bool *out_c_str,
         ZigList<SrcPos> *offset_map)
 {
     // skip the double quotes at beginning and end
@@ -234,10 +252,11 @@ static void parse_string_literal(ParseContext *pc, Token *token, Buf *buf, bool
     buf_resize(buf, 0);
     bool escape = false;
     bool skip_quote;
-    SrcPos pos = {token->start_line, token->start_column};
-    for (int i = token->start_pos; i < token->end_pos - 1; i += 1) {
+    SrcPos pos;
+    token_line_column(pc->tokens, token, &pos.line, &pos.column);
+    for (int i = token_start_pos(pc->tokens, token); i < token_end_pos(pc->tokens, token) - 1; i += 1) {
         uint8_t c = *((uint8_t*)buf_ptr(pc->buf) + i);
-        if (i == token->start_pos) {
+        if (i == token_start_pos(pc->tokens, token)) {
             skip_quote = (c == 'c');
             if (out_c_str) {
                 *out_c_str = skip_quote;
@@ -318,26 +337,28 @@ static unsigned long long parse_int_digits(ParseContext *pc, int digits_start, i
     return x;
 }
 
-static void parse_number_literal(ParseContext *pc, Token *token, AstNodeNumberLiteral *num_lit) {
-    assert(token->id == TokenIdNumberLiteral);
+static void parse_number_literal(ParseContext *pc, int token, AstNodeNumberLiteral *num_lit) {
+    assert(token_id(pc->tokens, token) == TokenIdNumberLiteral);
+    TokenNumLit *token_info = token_num_lit(pc->tokens, token);
+    int token_end = token_end_pos(pc->tokens, token);
 
-    int whole_number_start = token->start_pos;
-    if (token->radix != 10) {
+    int whole_number_start = token_start_pos(pc->tokens, token);
+    if (token_info->radix != 10) {
         // skip the "0x"
         whole_number_start += 2;
     }
 
-    int whole_number_end = token->decimal_point_pos;
+    int whole_number_end = token_info->decimal_point_pos;
     if (whole_number_end <= whole_number_start) {
         // TODO: error for empty whole number part
         num_lit->overflow = true;
         return;
     }
 
-    if (token->decimal_point_pos == token->end_pos) {
+    if (token_info->decimal_point_pos == token_end) {
         // integer
         unsigned long long whole_number = parse_int_digits(pc, whole_number_start, whole_number_end,
-            token->radix, -1, &num_lit->overflow);
+            token_info->radix, -1, &num_lit->overflow);
         if (num_lit->overflow) return;
 
         num_lit->data.x_uint = whole_number;
@@ -345,7 +366,7 @@ static void parse_number_literal(ParseContext *pc, Token *token, AstNodeNumberLi
     } else {
         // float
 
-        if (token->radix == 10) {
+        if (token_info->radix == 10) {
             // use a third-party base-10 float parser
             char *str_begin = buf_ptr(pc->buf) + whole_number_start;
             char *str_end;
@@ -356,16 +377,16 @@ static void parse_number_literal(ParseContext *pc, Token *token, AstNodeNumberLi
                 num_lit->overflow = true;
                 return;
             }
-            assert(str_end == buf_ptr(pc->buf) + token->end_pos);
+            assert(str_end == buf_ptr(pc->buf) + token_end);
             num_lit->data.x_float = x;
             num_lit->kind = NumLitFloat;
             return;
         }
 
-        if (token->decimal_point_pos < token->exponent_marker_pos) {
+        if (token_info->decimal_point_pos < token_info->exponent_marker_pos) {
             // fraction
-            int fraction_start = token->decimal_point_pos + 1;
-            int fraction_end = token->exponent_marker_pos;
+            int fraction_start = token_info->decimal_point_pos + 1;
+            int fraction_end = token_info->exponent_marker_pos;
             if (fraction_end <= fraction_start) {
                 // TODO: error for empty fraction part
                 num_lit->overflow = true;
@@ -375,17 +396,17 @@ static void parse_number_literal(ParseContext *pc, Token *token, AstNodeNumberLi
 
         // trim leading and trailing zeros in the significand digit sequence
         int significand_start = whole_number_start;
-        for (; significand_start < token->exponent_marker_pos; significand_start++) {
-            if (significand_start == token->decimal_point_pos)
+        for (; significand_start < token_info->exponent_marker_pos; significand_start++) {
+            if (significand_start == token_info->decimal_point_pos)
                 continue;
             uint8_t c = *((uint8_t*)buf_ptr(pc->buf) + significand_start);
             if (c != '0')
                 break;
         }
-        int significand_end = token->exponent_marker_pos;
+        int significand_end = token_info->exponent_marker_pos;
         for (; significand_end - 1 > significand_start; significand_end--) {
-            if (significand_end - 1 <= token->decimal_point_pos) {
-                significand_end = token->decimal_point_pos;
+            if (significand_end - 1 <= token_info->decimal_point_pos) {
+                significand_end = token_info->decimal_point_pos;
                 break;
             }
             uint8_t c = *((uint8_t*)buf_ptr(pc->buf) + significand_end - 1);
@@ -394,27 +415,27 @@ static void parse_number_literal(ParseContext *pc, Token *token, AstNodeNumberLi
         }
 
         unsigned long long significand_as_int = parse_int_digits(pc, significand_start, significand_end,
-            token->radix, token->decimal_point_pos, &num_lit->overflow);
+            token_info->radix, token_info->decimal_point_pos, &num_lit->overflow);
         if (num_lit->overflow) return;
 
         int exponent_in_bin_or_dec = 0;
-        if (significand_end > token->decimal_point_pos) {
-            exponent_in_bin_or_dec = token->decimal_point_pos + 1 - significand_end;
-            if (token->radix == 2) {
+        if (significand_end > token_info->decimal_point_pos) {
+            exponent_in_bin_or_dec = token_info->decimal_point_pos + 1 - significand_end;
+            if (token_info->radix == 2) {
                 // already good
-            } else if (token->radix == 8) {
+            } else if (token_info->radix == 8) {
                 exponent_in_bin_or_dec *= 3;
-            } else if (token->radix == 10) {
+            } else if (token_info->radix == 10) {
                 // already good
-            } else if (token->radix == 16) {
+            } else if (token_info->radix == 16) {
                 exponent_in_bin_or_dec *= 4;
             } else zig_unreachable();
         }
 
-        if (token->exponent_marker_pos < token->end_pos) {
+        if (token_info->exponent_marker_pos < token_end) {
             // exponent
-            int exponent_start = token->exponent_marker_pos + 1;
-            int exponent_end = token->end_pos;
+            int exponent_start = token_info->exponent_marker_pos + 1;
+            int exponent_end = token_end;
             if (exponent_end <= exponent_start) {
                 // TODO: error for empty exponent part
                 num_lit->overflow = true;
@@ -454,7 +475,7 @@ static void parse_number_literal(ParseContext *pc, Token *token, AstNodeNumberLi
         uint64_t exponent_bits;
         if (significand_as_int != 0) {
             // normalize the significand
-            if (token->radix == 10) {
+            if (token_info->radix == 10) {
                 zig_panic("TODO: decimal floats");
             } else {
                 int significand_magnitude_in_bin = __builtin_clzll(1) - __builtin_clzll(significand_as_int);
@@ -484,7 +505,7 @@ static void parse_number_literal(ParseContext *pc, Token *token, AstNodeNumberLi
 
 
 __attribute__ ((noreturn))
-static void ast_invalid_token_error(ParseContext *pc, Token *token) {
+static void ast_invalid_token_error(ParseContext *pc, int token) {
     Buf token_value = BUF_INIT;
     ast_buf_from_token(pc, token, &token_value);
     ast_error(pc, token, "invalid token: '%s'", buf_ptr(&token_value));
@@ -501,19 +522,19 @@ static AstNode *ast_parse_fn_proto(ParseContext *pc, int *token_index, bool mand
 static AstNode *ast_parse_return_expr(ParseContext *pc, int *token_index);
 static AstNode *ast_parse_grouped_expr(ParseContext *pc, int *token_index, bool mandatory);
 
-static void ast_expect_token(ParseContext *pc, Token *token, TokenId token_id) {
-    if (token->id == token_id) {
+static void ast_expect_token(ParseContext *pc, int token, TokenId expected_id) {
+    if (token_id(pc->tokens, token) == expected_id) {
         return;
     }
 
     Buf token_value = BUF_INIT;
     ast_buf_from_token(pc, token, &token_value);
-    ast_error(pc, token, "expected token '%s', found '%s'", token_name(token_id), token_name(token->id));
+    ast_error(pc, token, "expected token '%s', found '%s'", token_name(expected_id), token_name(token_id(pc->tokens, token)));
 }
 
-static Token *ast_eat_token(ParseContext *pc, int *token_index, TokenId token_id) {
-    Token *token = &pc->tokens->at(*token_index);
-    ast_expect_token(pc, token, token_id);
+static int ast_eat_token(ParseContext *pc, int *token_index, TokenId expected_id) {
+    int token = *token_index;
+    ast_expect_token(pc, token, expected_id);
     *token_index += 1;
     return token;
 }
@@ -522,11 +543,11 @@ static Token *ast_eat_token(ParseContext *pc, int *token_index, TokenId token_id
 Directive = "#" "Symbol" "(" Expression ")"
 */
 static AstNode *ast_parse_directive(ParseContext *pc, int *token_index) {
-    Token *number_sign = ast_eat_token(pc, token_index, TokenIdNumberSign);
+    int number_sign = ast_eat_token(pc, token_index, TokenIdNumberSign);
 
     AstNode *node = ast_create_node(pc, NodeTypeDirective, number_sign);
 
-    Token *name_symbol = ast_eat_token(pc, token_index, TokenIdSymbol);
+    int name_symbol = ast_eat_token(pc, token_index, TokenIdSymbol);
 
     ast_buf_from_token(pc, name_symbol, &node->data.directive.name);
 
@@ -540,8 +561,8 @@ static void ast_parse_directives(ParseContext *pc, int *token_index,
         ZigList<AstNode *> *directives)
 {
     for (;;) {
-        Token *token = &pc->tokens->at(*token_index);
-        if (token->id == TokenIdNumberSign) {
+        int token = *token_index;
+        if (token_id(pc->tokens, token) == TokenIdNumberSign) {
             AstNode *directive_node = ast_parse_directive(pc, token_index);
             directives->append(directive_node);
         } else {
@@ -555,27 +576,27 @@ static void ast_parse_directives(ParseContext *pc, int *token_index,
 ParamDecl = option("noalias") option("Symbol" ":") PrefixOpExpression | "..."
 */
 static AstNode *ast_parse_param_decl(ParseContext *pc, int *token_index) {
-    Token *token = &pc->tokens->at(*token_index);
+    int token = *token_index;
 
-    if (token->id == TokenIdEllipsis) {
+    if (token_id(pc->tokens, token) == TokenIdEllipsis) {
         *token_index += 1;
         return nullptr;
     }
 
     AstNode *node = ast_create_node(pc, NodeTypeParamDecl, token);
 
-    if (token->id == TokenIdKeywordNoAlias) {
+    if (token_id(pc->tokens, token) == TokenIdKeywordNoAlias) {
         node->data.param_decl.is_noalias = true;
         *token_index += 1;
-        token = &pc->tokens->at(*token_index);
+        token = *token_index;
     }
 
-    buf_resize(&node->data.param_decl.name, 0);
+    node->data.param_decl.name = buf_intern_str("");
 
-    if (token->id == TokenIdSymbol) {
-        Token *next_token = &pc->tokens->at(*token_index + 1);
-        if (next_token->id == TokenIdColon) {
-            ast_buf_from_token(pc, token, &node->data.param_decl.name);
+    if (token_id(pc->tokens, token) == TokenIdSymbol) {
+        int next_token = *token_index + 1;
+        if (token_id(pc->tokens, next_token) == TokenIdColon) {
+            node->data.param_decl.name = ast_intern_token(pc, token);
             *token_index += 2;
         }
     }
@@ -592,12 +613,12 @@ static void ast_parse_param_decl_list(ParseContext *pc, int *token_index,
 {
     *is_var_args = false;
 
-    Token *l_paren = &pc->tokens->at(*token_index);
+    int l_paren = *token_index;
     *token_index += 1;
     ast_expect_token(pc, l_paren, TokenIdLParen);
 
-    Token *token = &pc->tokens->at(*token_index);
-    if (token->id == TokenIdRParen) {
+    int token = *token_index;
+    if (token_id(pc->tokens, token) == TokenIdRParen) {
         *token_index += 1;
         return;
     }
@@ -612,9 +633,9 @@ static void ast_parse_param_decl_list(ParseContext *pc, int *token_index,
             expect_end = true;
         }
 
-        Token *token = &pc->tokens->at(*token_index);
+        int token = *token_index;
         *token_index += 1;
-        if (token->id == TokenIdRParen) {
+        if (token_id(pc->tokens, token) == TokenIdRParen) {
             return;
         } else if (expect_end) {
             ast_invalid_token_error(pc, token);
@@ -626,8 +647,8 @@ static void ast_parse_param_decl_list(ParseContext *pc, int *token_index,
 }
 
 static void ast_parse_fn_call_param_list(ParseContext *pc, int *token_index, ZigList<AstNode*> *params) {
-    Token *token = &pc->tokens->at(*token_index);
-    if (token->id == TokenIdRParen) {
+    int token = *token_index;
+    if (token_id(pc->tokens, token) == TokenIdRParen) {
         *token_index += 1;
         return;
     }
@@ -636,9 +657,9 @@ static void ast_parse_fn_call_param_list(ParseContext *pc, int *token_index, Zig
         AstNode *expr = ast_parse_expression(pc, token_index, true);
         params->append(expr);
 
-        Token *token = &pc->tokens->at(*token_index);
+        int token = *token_index;
         *token_index += 1;
-        if (token->id == TokenIdRParen) {
+        if (token_id(pc->tokens, token) == TokenIdRParen) {
             return;
         } else {
             ast_expect_token(pc, token, TokenIdComma);
@@ -651,8 +672,8 @@ static void ast_parse_fn_call_param_list(ParseContext *pc, int *token_index, Zig
 GroupedExpression : token(LParen) Expression token(RParen)
 */
 static AstNode *ast_parse_grouped_expr(ParseContext *pc, int *token_index, bool mandatory) {
-    Token *l_paren = &pc->tokens->at(*token_index);
-    if (l_paren->id != TokenIdLParen) {
+    int l_paren = *token_index;
+    if (token_id(pc->tokens, l_paren) != TokenIdLParen) {
         if (mandatory) {
             ast_expect_token(pc, l_paren, TokenIdLParen);
         } else {
@@ -664,7 +685,7 @@ static AstNode *ast_parse_grouped_expr(ParseContext *pc, int *token_index, bool
 
     AstNode *node = ast_parse_expression(pc, token_index, true);
 
-    Token *r_paren = &pc->tokens->at(*token_index);
+    int r_paren = *token_index;
     *token_index += 1;
     ast_expect_token(pc, r_paren, TokenIdRParen);
 
@@ -675,8 +696,8 @@ static AstNode *ast_parse_grouped_expr(ParseContext *pc, int *token_index, bool
 ArrayType : "[" option(Expression) "]" option("const") PrefixOpExpression
 */
 static AstNode *ast_parse_array_type_expr(ParseContext *pc, int *token_index, bool mandatory) {
-    Token *l_bracket = &pc->tokens->at(*token_index);
-    if (l_bracket->id != TokenIdLBracket) {
+    int l_bracket = *token_index;
+    if (token_id(pc->tokens, l_bracket) != TokenIdLBracket) {
         if (mandatory) {
             ast_expect_token(pc, l_bracket, TokenIdLBracket);
         } else {
@@ -691,8 +712,8 @@ static AstNode *ast_parse_array_type_expr(ParseContext *pc, int *token_index, bo
 
     ast_eat_token(pc, token_index, TokenIdRBracket);
 
-    Token *const_tok = &pc->tokens->at(*token_index);
-    if (const_tok->id == TokenIdKeywordConst) {
+    int const_tok = *token_index;
+    if (token_id(pc->tokens, const_tok) == TokenIdKeywordConst) {
         *token_index += 1;
         node->data.array_type.is_const = true;
     }
@@ -708,10 +729,10 @@ AsmInputItem : token(LBracket) token(Symbol) token(RBracket) token(String) token
 */
 static void ast_parse_asm_input_item(ParseContext *pc, int *token_index, AstNode *node) {
     ast_eat_token(pc, token_index, TokenIdLBracket);
-    Token *alias = ast_eat_token(pc, token_index, TokenIdSymbol);
+    int alias = ast_eat_token(pc, token_index, TokenIdSymbol);
     ast_eat_token(pc, token_index, TokenIdRBracket);
 
-    Token *constraint = ast_eat_token(pc, token_index, TokenIdStringLiteral);
+    int constraint = ast_eat_token(pc, token_index, TokenIdStringLiteral);
 
     ast_eat_token(pc, token_index, TokenIdLParen);
     AstNode *expr_node = ast_parse_expression(pc, token_index, true);
@@ -729,20 +750,20 @@ AsmOutputItem : "[" "Symbol" "]" "String" "(" ("Symbol" | "->" PrefixOpExpressio
 */
 static void ast_parse_asm_output_item(ParseContext *pc, int *token_index, AstNode *node) {
     ast_eat_token(pc, token_index, TokenIdLBracket);
-    Token *alias = ast_eat_token(pc, token_index, TokenIdSymbol);
+    int alias = ast_eat_token(pc, token_index, TokenIdSymbol);
     ast_eat_token(pc, token_index, TokenIdRBracket);
 
-    Token *constraint = ast_eat_token(pc, token_index, TokenIdStringLiteral);
+    int constraint = ast_eat_token(pc, token_index, TokenIdStringLiteral);
 
     AsmOutput *asm_output = allocate<AsmOutput>(1);
 
     ast_eat_token(pc, token_index, TokenIdLParen);
 
-    Token *token = &pc->tokens->at(*token_index);
+    int token = *token_index;
     *token_index += 1;
-    if (token->id == TokenIdSymbol) {
+    if (token_id(pc->tokens, token) == TokenIdSymbol) {
         ast_buf_from_token(pc, token, &asm_output->variable_name);
-    } else if (token->id == TokenIdArrow) {
+    } else if (token_id(pc->tokens, token) == TokenIdArrow) {
         asm_output->return_type = ast_parse_prefix_op_expr(pc, token_index, true);
     } else {
         ast_invalid_token_error(pc, token);
@@ -759,15 +780,15 @@ static void ast_parse_asm_output_item(ParseContext *pc, int *token_index, AstNod
 AsmClobbers: token(Colon) list(token(String), token(Comma))
 */
 static void ast_parse_asm_clobbers(ParseContext *pc, int *token_index, AstNode *node) {
-    Token *colon_tok = &pc->tokens->at(*token_index);
+    int colon_tok = *token_index;
 
-    if (colon_tok->id != TokenIdColon)
+    if (token_id(pc->tokens, colon_tok) != TokenIdColon)
         return;
 
     *token_index += 1;
 
     for (;;) {
-        Token *string_tok = &pc->tokens->at(*token_index);
+        int string_tok = *token_index;
         ast_expect_token(pc, string_tok, TokenIdStringLiteral);
         *token_index += 1;
 
@@ -775,9 +796,9 @@ static void ast_parse_asm_clobbers(ParseContext *pc, int *token_index, AstNode *
         parse_string_literal(pc, string_tok, clobber_buf, nullptr, nullptr);
         node->data.asm_expr.clobber_list.append(clobber_buf);
 
-        Token *comma = &pc->tokens->at(*token_index);
+        int comma = *token_index;
 
-        if (comma->id == TokenIdComma) {
+        if (token_id(pc->tokens, comma) == TokenIdComma) {
             *token_index += 1;
             continue;
         } else {
@@ -790,9 +811,9 @@ static void ast_parse_asm_clobbers(ParseContext *pc, int *token_index, AstNode *
 AsmInput : token(Colon) list(AsmInputItem, token(Comma)) option(AsmClobbers)
 */
 static void ast_parse_asm_input(ParseContext *pc, int *token_index, AstNode *node) {
-    Token *colon_tok = &pc->tokens->at(*token_index);
+    int colon_tok = *token_index;
 
-    if (colon_tok->id != TokenIdColon)
+    if (token_id(pc->tokens, colon_tok) != TokenIdColon)
         return;
 
     *token_index += 1;
@@ -800,9 +821,9 @@ static void ast_parse_asm_input(ParseContext *pc, int *token_index, AstNode *nod
     for (;;) {
         ast_parse_asm_input_item(pc, token_index, node);
 
-        Token *comma = &pc->tokens->at(*token_index);
+        int comma = *token_index;
 
-        if (comma->id == TokenIdComma) {
+        if (token_id(pc->tokens, comma) == TokenIdComma) {
             *token_index += 1;
             continue;
         } else {
@@ -817,9 +838,9 @@ static void ast_parse_asm_input(ParseContext *pc, int *token_index, AstNode *nod
 AsmOutput : token(Colon) list(AsmOutputItem, token(Comma)) option(AsmInput)
 */
 static void ast_parse_asm_output(ParseContext *pc, int *token_index, AstNode *node) {
-    Token *colon_tok = &pc->tokens->at(*token_index);
+    int colon_tok = *token_index;
 
-    if (colon_tok->id != TokenIdColon)
+    if (token_id(pc->tokens, colon_tok) != TokenIdColon)
         return;
 
     *token_index += 1;
@@ -827,9 +848,9 @@ static void ast_parse_asm_output(ParseContext *pc, int *token_index, AstNode *no
     for (;;) {
         ast_parse_asm_output_item(pc, token_index, node);
 
-        Token *comma = &pc->tokens->at(*token_index);
+        int comma = *token_index;
 
-        if (comma->id == TokenIdComma) {
+        if (token_id(pc->tokens, comma) == TokenIdComma) {
             *token_index += 1;
             continue;
         } else {
@@ -844,9 +865,9 @@ static void ast_parse_asm_output(ParseContext *pc, int *token_index, AstNode *no
 AsmExpression : token(Asm) option(token(Volatile)) token(LParen) token(String) option(AsmOutput) token(RParen)
 */
 static AstNode *ast_parse_asm_expr(ParseContext *pc, int *token_index, bool mandatory) {
-    Token *asm_token = &pc->tokens->at(*token_index);
+    int asm_token = *token_index;
 
-    if (asm_token->id != TokenIdKeywordAsm) {
+    if (token_id(pc->tokens, asm_token) != TokenIdKeywordAsm) {
         if (mandatory) {
             ast_expect_token(pc, asm_token, TokenIdKeywordAsm);
         } else {
@@ -857,19 +878,19 @@ static AstNode *ast_parse_asm_expr(ParseContext *pc, int *token_index, bool mand
     AstNode *node = ast_create_node(pc, NodeTypeAsmExpr, asm_token);
 
     *token_index += 1;
-    Token *lparen_tok = &pc->tokens->at(*token_index);
+    int lparen_tok = *token_index;
 
-    if (lparen_tok->id == TokenIdKeywordVolatile) {
+    if (token_id(pc->tokens, lparen_tok) == TokenIdKeywordVolatile) {
         node->data.asm_expr.is_volatile = true;
 
         *token_index += 1;
-        lparen_tok = &pc->tokens->at(*token_index);
+        lparen_tok = *token_index;
     }
 
     ast_expect_token(pc, lparen_tok, TokenIdLParen);
     *token_index += 1;
 
-    Token *template_tok = &pc->tokens->at(*token_index);
+    int template_tok = *token_index;
     ast_expect_token(pc, template_tok, TokenIdStringLiteral);
     *token_index += 1;
 
@@ -879,7 +900,7 @@ static AstNode *ast_parse_asm_expr(ParseContext *pc, int *token_index, bool mand
 
     ast_parse_asm_output(pc, token_index, node);
 
-    Token *rparen_tok = &pc->tokens->at(*token_index);
+    int rparen_tok = *token_index;
     ast_expect_token(pc, rparen_tok, TokenIdRParen);
     *token_index += 1;
 
@@ -892,67 +913,67 @@ PrimaryExpression = "Number" | "String" | "CharLiteral" | KeywordLiteral | Group
 KeywordLiteral = "true" | "false" | "null" | "break" | "continue" | "undefined" | "error" | "type"
 */
 static AstNode *ast_parse_primary_expr(ParseContext *pc, int *token_index, bool mandatory) {
-    Token *token = &pc->tokens->at(*token_index);
+    int token = *token_index;
 
-    if (token->id == TokenIdNumberLiteral) {
+    if (token_id(pc->tokens, token) == TokenIdNumberLiteral) {
         AstNode *node = ast_create_node(pc, NodeTypeNumberLiteral, token);
         parse_number_literal(pc, token, &node->data.number_literal);
         *token_index += 1;
         return node;
-    } else if (token->id == TokenIdStringLiteral) {
+    } else if (token_id(pc->tokens, token) == TokenIdStringLiteral) {
         AstNode *node = ast_create_node(pc, NodeTypeStringLiteral, token);
         parse_string_literal(pc, token, &node->data.string_literal.buf, &node->data.string_literal.c, nullptr);
         *token_index += 1;
         return node;
-    } else if (token->id == TokenIdCharLiteral) {
+    } else if (token_id(pc->tokens, token) == TokenIdCharLiteral) {
         AstNode *node = ast_create_node(pc, NodeTypeCharLiteral, token);
         node->data.char_literal.value = parse_char_literal(pc, token);
         *token_index += 1;
         return node;
-    } else if (token->id == TokenIdKeywordTrue) {
+    } else if (token_id(pc->tokens, token) == TokenIdKeywordTrue) {
         AstNode *node = ast_create_node(pc, NodeTypeBoolLiteral, token);
         node->data.bool_literal.value = true;
         *token_index += 1;
         return node;
-    } else if (token->id == TokenIdKeywordFalse) {
+    } else if (token_id(pc->tokens, token) == TokenIdKeywordFalse) {
         AstNode *node = ast_create_node(pc, NodeTypeBoolLiteral, token);
         node->data.bool_literal.value = false;
         *token_index += 1;
         return node;
-    } else if (token->id == TokenIdKeywordNull) {
+    } else if (token_id(pc->tokens, token) == TokenIdKeywordNull) {
         AstNode *node = ast_create_node(pc, NodeTypeNullLiteral, token);
         *token_index += 1;
         return node;
-    } else if (token->id == TokenIdKeywordBreak) {
+    } else if (token_id(pc->tokens, token) == TokenIdKeywordBreak) {
         AstNode *node = ast_create_node(pc, NodeTypeBreak, token);
         *token_index += 1;
         return node;
-    } else if (token->id == TokenIdKeywordContinue) {
+    } else if (token_id(pc->tokens, token) == TokenIdKeywordContinue) {
         AstNode *node = ast_create_node(pc, NodeTypeContinue, token);
         *token_index += 1;
         return node;
-    } else if (token->id == TokenIdKeywordUndefined) {
+    } else if (token_id(pc->tokens, token) == TokenIdKeywordUndefined) {
         AstNode *node = ast_create_node(pc, NodeTypeUndefinedLiteral, token);
         *token_index += 1;
         return node;
-    } else if (token->id == TokenIdKeywordType) {
+    } else if (token_id(pc->tokens, token) == TokenIdKeywordType) {
         AstNode *node = ast_create_node(pc, NodeTypeTypeLiteral, token);
         *token_index += 1;
         return node;
-    } else if (token->id == TokenIdKeywordError) {
+    } else if (token_id(pc->tokens, token) == TokenIdKeywordError) {
         AstNode *node = ast_create_node(pc, NodeTypeErrorType, token);
         *token_index += 1;
         return node;
-    } else if (token->id == TokenIdKeywordExtern) {
+    } else if (token_id(pc->tokens, token) == TokenIdKeywordExtern) {
         *token_index += 1;
         AstNode *node = ast_parse_fn_proto(pc, token_index, true, nullptr, VisibModPrivate);
         node->data.fn_proto.is_extern = true;
         return node;
-    } else if (token->id == TokenIdAtSign) {
+    } else if (token_id(pc->tokens, token) == TokenIdAtSign) {
         *token_index += 1;
-        Token *name_tok = ast_eat_token(pc, token_index, TokenIdSymbol);
+        int name_tok = ast_eat_token(pc, token_index, TokenIdSymbol);
         AstNode *name_node = ast_create_node(pc, NodeTypeSymbol, name_tok);
-        ast_buf_from_token(pc, name_tok, &name_node->data.symbol_expr.symbol);
+        name_node->data.symbol_expr.symbol = ast_intern_token(pc, name_tok);
 
         AstNode *node = ast_create_node(pc, NodeTypeFnCallExpr, token);
         node->data.fn_call_expr.fn_ref_expr = name_node;
@@ -962,16 +983,16 @@ static AstNode *ast_parse_primary_expr(ParseContext *pc, int *token_index, bool
 
         normalize_parent_ptrs(node);
         return node;
-    } else if (token->id == TokenIdSymbol) {
+    } else if (token_id(pc->tokens, token) == TokenIdSymbol) {
         *token_index += 1;
         AstNode *node = ast_create_node(pc, NodeTypeSymbol, token);
-        ast_buf_from_token(pc, token, &node->data.symbol_expr.symbol);
+        node->data.symbol_expr.symbol = ast_intern_token(pc, token);
         return node;
-    } else if (token->id == TokenIdKeywordGoto) {
+    } else if (token_id(pc->tokens, token) == TokenIdKeywordGoto) {
         AstNode *node = ast_create_node(pc, NodeTypeGoto, token);
         *token_index += 1;
 
-        Token *dest_symbol = &pc->tokens->at(*token_index);
+        int dest_symbol = *token_index;
         *token_index += 1;
         ast_expect_token(pc, dest_symbol, TokenIdSymbol);
 
@@ -1022,20 +1043,20 @@ static AstNode *ast_parse_curly_suffix_expr(ParseContext *pc, int *token_index,
     }
 
     while (true) {
-        Token *first_token = &pc->tokens->at(*token_index);
-        if (first_token->id == TokenIdLBrace) {
+        int first_token = *token_index;
+        if (token_id(pc->tokens, first_token) == TokenIdLBrace) {
             *token_index += 1;
 
             AstNode *node = ast_create_node(pc, NodeTypeContainerInitExpr, first_token);
             node->data.container_init_expr.type = prefix_op_expr;
 
-            Token *token = &pc->tokens->at(*token_index);
-            if (token->id == TokenIdDot) {
+            int token = *token_index;
+            if (token_id(pc->tokens, token) == TokenIdDot) {
                 node->data.container_init_expr.kind = ContainerInitKindStruct;
                 for (;;) {
-                    if (token->id == TokenIdDot) {
+                    if (token_id(pc->tokens, token) == TokenIdDot) {
                         ast_eat_token(pc, token_index, TokenIdDot);
-                        Token *field_name_tok = ast_eat_token(pc, token_index, TokenIdSymbol);
+                        int field_name_tok = ast_eat_token(pc, token_index, TokenIdSymbol);
                         ast_eat_token(pc, token_index, TokenIdEq);
 
                         AstNode *field_node = ast_create_node(pc, NodeTypeStructValueField, token);
@@ -1046,18 +1067,18 @@ static AstNode *ast_parse_curly_suffix_expr(ParseContext *pc, int *token_index,
                         normalize_parent_ptrs(field_node);
                         node->data.container_init_expr.entries.append(field_node);
 
-                        Token *comma_tok = &pc->tokens->at(*token_index);
-                        if (comma_tok->id == TokenIdComma) {
+                        int comma_tok = *token_index;
+                        if (token_id(pc->tokens, comma_tok) == TokenIdComma) {
                             *token_index += 1;
-                            token = &pc->tokens->at(*token_index);
+                            token = *token_index;
                             continue;
-                        } else if (comma_tok->id != TokenIdRBrace) {
+                        } else if (token_id(pc->tokens, comma_tok) != TokenIdRBrace) {
                             ast_expect_token(pc, comma_tok, TokenIdRBrace);
                         } else {
                             *token_index += 1;
                             break;
                         }
-                    } else if (token->id == TokenIdRBrace) {
+                    } else if (token_id(pc->tokens, token) == TokenIdRBrace) {
                         *token_index += 1;
                         break;
                     } else {
@@ -1068,19 +1089,19 @@ static AstNode *ast_parse_curly_suffix_expr(ParseContext *pc, int *token_index,
             } else {
                 node->data.container_init_expr.kind = ContainerInitKindArray;
                 for (;;) {
-                    if (token->id == TokenIdRBrace) {
+                    if (token_id(pc->tokens, token) == TokenIdRBrace) {
                         *token_index += 1;
                         break;
                     } else {
                         AstNode *elem_node = ast_parse_expression(pc, token_index, true);
                         node->data.container_init_expr.entries.append(elem_node);
 
-                        Token *comma_tok = &pc->tokens->at(*token_index);
-                        if (comma_tok->id == TokenIdComma) {
+                        int comma_tok = *token_index;
+                        if (token_id(pc->tokens, comma_tok) == TokenIdComma) {
                             *token_index += 1;
-                            token = &pc->tokens->at(*token_index);
+                            token = *token_index;
                             continue;
-                        } else if (comma_tok->id != TokenIdRBrace) {
+                        } else if (token_id(pc->tokens, comma_tok) != TokenIdRBrace) {
                             ast_expect_token(pc, comma_tok, TokenIdRBrace);
                         } else {
                             *token_index += 1;
@@ -1113,8 +1134,8 @@ static AstNode *ast_parse_suffix_op_expr(ParseContext *pc, int *token_index, boo
     }
 
     while (true) {
-        Token *first_token = &pc->tokens->at(*token_index);
-        if (first_token->id == TokenIdLParen) {
+        int first_token = *token_index;
+        if (token_id(pc->tokens, first_token) == TokenIdLParen) {
             *token_index += 1;
 
             AstNode *node = ast_create_node(pc, NodeTypeFnCallExpr, first_token);
@@ -1123,14 +1144,14 @@ static AstNode *ast_parse_suffix_op_expr(ParseContext *pc, int *token_index, boo
 
             normalize_parent_ptrs(node);
             primary_expr = node;
-        } else if (first_token->id == TokenIdLBracket) {
+        } else if (token_id(pc->tokens, first_token) == TokenIdLBracket) {
             *token_index += 1;
 
             AstNode *expr_node = ast_parse_expression(pc, token_index, true);
 
-            Token *ellipsis_or_r_bracket = &pc->tokens->at(*token_index);
+            int ellipsis_or_r_bracket = *token_index;
 
-            if (ellipsis_or_r_bracket->id == TokenIdEllipsis) {
+            if (token_id(pc->tokens, ellipsis_or_r_bracket) == TokenIdEllipsis) {
                 *token_index += 1;
 
                 AstNode *node = ast_create_node(pc, NodeTypeSliceExpr, first_token);
@@ -1140,15 +1161,15 @@ static AstNode *ast_parse_suffix_op_expr(ParseContext *pc, int *token_index, boo
 
                 ast_eat_token(pc, token_index, TokenIdRBracket);
 
-                Token *const_tok = &pc->tokens->at(*token_index);
-                if (const_tok->id == TokenIdKeywordConst) {
+                int const_tok = *token_index;
+                if (token_id(pc->tokens, const_tok) == TokenIdKeywordConst) {
                     *token_index += 1;
                     node->data.slice_expr.is_const = true;
                 }
 
                 normalize_parent_ptrs(node);
                 primary_expr = node;
-            } else if (ellipsis_or_r_bracket->id == TokenIdRBracket) {
+            } else if (token_id(pc->tokens, ellipsis_or_r_bracket) == TokenIdRBracket) {
                 *token_index += 1;
 
                 AstNode *node = ast_create_node(pc, NodeTypeArrayAccessExpr, first_token);
@@ -1160,14 +1181,14 @@ static AstNode *ast_parse_suffix_op_expr(ParseContext *pc, int *token_index, boo
             } else {
                 ast_invalid_token_error(pc, first_token);
             }
-        } else if (first_token->id == TokenIdDot) {
+        } else if (token_id(pc->tokens, first_token) == TokenIdDot) {
             *token_index += 1;
 
-            Token *name_token = ast_eat_token(pc, token_index, TokenIdSymbol);
+            int name_token = ast_eat_token(pc, token_index, TokenIdSymbol);
 
             AstNode *node = ast_create_node(pc, NodeTypeFieldAccessExpr, first_token);
             node->data.field_access_expr.struct_expr = primary_expr;
-            ast_buf_from_token(pc, name_token, &node->data.field_access_expr.field_name);
+            node->data.field_access_expr.field_name = ast_intern_token(pc, name_token);
 
             normalize_parent_ptrs(node);
             primary_expr = node;
@@ -1177,8 +1198,8 @@ static AstNode *ast_parse_suffix_op_expr(ParseContext *pc, int *token_index, boo
     }
 }
 
-static PrefixOp tok_to_prefix_op(Token *token) {
-    switch (token->id) {
+static PrefixOp tok_to_prefix_op(TokenId id) {
+    switch (id) {
         case TokenIdBang: return PrefixOpBoolNot;
         case TokenIdDash: return PrefixOpNegation;
         case TokenIdTilde: return PrefixOpBinNot;
@@ -1198,15 +1219,15 @@ PrefixOpExpression : PrefixOp PrefixOpExpression | SuffixOpExpression
 PrefixOp : token(Not) | token(Dash) | token(Tilde) | token(Star) | (token(Ampersand) option(token(Const)))
 */
 static AstNode *ast_parse_prefix_op_expr(ParseContext *pc, int *token_index, bool mandatory) {
-    Token *token = &pc->tokens->at(*token_index);
-    PrefixOp prefix_op = tok_to_prefix_op(token);
+    int token = *token_index;
+    PrefixOp prefix_op = tok_to_prefix_op(token_id(pc->tokens, token));
     if (prefix_op == PrefixOpInvalid) {
         return ast_parse_suffix_op_expr(pc, token_index, mandatory);
     }
 
     if (prefix_op == PrefixOpError || prefix_op == PrefixOpMaybe) {
-        Token *maybe_return = &pc->tokens->at(*token_index + 1);
-        if (maybe_return->id == TokenIdKeywordReturn) {
+        int maybe_return = *token_index + 1;
+        if (token_id(pc->tokens, maybe_return) == TokenIdKeywordReturn) {
             return ast_parse_return_expr(pc, token_index);
         }
     }
@@ -1216,7 +1237,7 @@ static AstNode *ast_parse_prefix_op_expr(ParseContext *pc, int *token_index, boo
 
     AstNode *node = ast_create_node(pc, NodeTypePrefixOpExpr, token);
     AstNode *parent_node = node;
-    if (token->id == TokenIdBoolAnd) {
+    if (token_id(pc->tokens, token) == TokenIdBoolAnd) {
         // pretend that we got 2 ampersand tokens
 
         parent_node = ast_create_node(pc, NodeTypePrefixOpExpr, token);
@@ -1227,8 +1248,8 @@ static AstNode *ast_parse_prefix_op_expr(ParseContext *pc, int *token_index, boo
     }
 
     if (prefix_op == PrefixOpAddressOf) {
-        Token *token = &pc->tokens->at(*token_index);
-        if (token->id == TokenIdKeywordConst) {
+        int token = *token_index;
+        if (token_id(pc->tokens, token) == TokenIdKeywordConst) {
             *token_index += 1;
             prefix_op = PrefixOpConstAddressOf;
         }
@@ -1244,8 +1265,8 @@ static AstNode *ast_parse_prefix_op_expr(ParseContext *pc, int *token_index, boo
 }
 
 
-static BinOpType tok_to_mult_op(Token *token) {
-    switch (token->id) {
+static BinOpType tok_to_mult_op(TokenId id) {
+    switch (id) {
         case TokenIdStar: return BinOpTypeMult;
         case TokenIdSlash: return BinOpTypeDiv;
         case TokenIdPercent: return BinOpTypeMod;
@@ -1257,8 +1278,8 @@ static BinOpType tok_to_mult_op(Token *token) {
 MultiplyOperator : token(Star) | token(Slash) | token(Percent)
 */
 static BinOpType ast_parse_mult_op(ParseContext *pc, int *token_index, bool mandatory) {
-    Token *token = &pc->tokens->at(*token_index);
-    BinOpType result = tok_to_mult_op(token);
+    int token = *token_index;
+    BinOpType result = tok_to_mult_op(token_id(pc->tokens, token));
     if (result == BinOpTypeInvalid) {
         if (mandatory) {
             ast_invalid_token_error(pc, token);
@@ -1279,7 +1300,7 @@ static AstNode *ast_parse_mult_expr(ParseContext *pc, int *token_index, bool man
         return nullptr;
 
     while (true) {
-        Token *token = &pc->tokens->at(*token_index);
+        int token = *token_index;
         BinOpType mult_op = ast_parse_mult_op(pc, token_index, false);
         if (mult_op == BinOpTypeInvalid)
             return operand_1;
@@ -1296,8 +1317,8 @@ static AstNode *ast_parse_mult_expr(ParseContext *pc, int *token_index, bool man
     }
 }
 
-static BinOpType tok_to_add_op(Token *token) {
-    switch (token->id) {
+static BinOpType tok_to_add_op(TokenId id) {
+    switch (id) {
         case TokenIdPlus: return BinOpTypeAdd;
         case TokenIdDash: return BinOpTypeSub;
         case TokenIdPlusPlus: return BinOpTypeStrCat;
@@ -1309,8 +1330,8 @@ static BinOpType tok_to_add_op(Token *token) {
 AdditionOperator : "+" | "-" | "++"
 */
 static BinOpType ast_parse_add_op(ParseContext *pc, int *token_index, bool mandatory) {
-    Token *token = &pc->tokens->at(*token_index);
-    BinOpType result = tok_to_add_op(token);
+    int token = *token_index;
+    BinOpType result = tok_to_add_op(token_id(pc->tokens, token));
     if (result == BinOpTypeInvalid) {
         if (mandatory) {
             ast_invalid_token_error(pc, token);
@@ -1331,7 +1352,7 @@ static AstNode *ast_parse_add_expr(ParseContext *pc, int *token_index, bool mand
         return nullptr;
 
     while (true) {
-        Token *token = &pc->tokens->at(*token_index);
+        int token = *token_index;
         BinOpType add_op = ast_parse_add_op(pc, token_index, false);
         if (add_op == BinOpTypeInvalid)
             return operand_1;
@@ -1348,8 +1369,8 @@ static AstNode *ast_parse_add_expr(ParseContext *pc, int *token_index, bool mand
     }
 }
 
-static BinOpType tok_to_bit_shift_op(Token *token) {
-    switch (token->id) {
+static BinOpType tok_to_bit_shift_op(TokenId id) {
+    switch (id) {
         case TokenIdBitShiftLeft: return BinOpTypeBitShiftLeft;
         case TokenIdBitShiftRight: return BinOpTypeBitShiftRight;
         default: return BinOpTypeInvalid;
@@ -1360,8 +1381,8 @@ static BinOpType tok_to_bit_shift_op(Token *token) {
 BitShiftOperator : token(BitShiftLeft) | token(BitShiftRight)
 */
 static BinOpType ast_parse_bit_shift_op(ParseContext *pc, int *token_index, bool mandatory) {
-    Token *token = &pc->tokens->at(*token_index);
-    BinOpType result = tok_to_bit_shift_op(token);
+    int token = *token_index;
+    BinOpType result = tok_to_bit_shift_op(token_id(pc->tokens, token));
     if (result == BinOpTypeInvalid) {
         if (mandatory) {
             ast_invalid_token_error(pc, token);
@@ -1382,7 +1403,7 @@ static AstNode *ast_parse_bit_shift_expr(ParseContext *pc, int *token_index, boo
         return nullptr;
 
     while (true) {
-        Token *token = &pc->tokens->at(*token_index);
+        int token = *token_index;
         BinOpType bit_shift_op = ast_parse_bit_shift_op(pc, token_index, false);
         if (bit_shift_op == BinOpTypeInvalid)
             return operand_1;
@@ -1409,8 +1430,8 @@ static AstNode *ast_parse_bin_and_expr(ParseContext *pc, int *token_index, bool
         return nullptr;
 
     while (true) {
-        Token *token = &pc->tokens->at(*token_index);
-        if (token->id != TokenIdAmpersand)
+        int token = *token_index;
+        if (token_id(pc->tokens, token) != TokenIdAmpersand)
             return operand_1;
         *token_index += 1;
 
@@ -1435,8 +1456,8 @@ static AstNode *ast_parse_bin_xor_expr(ParseContext *pc, int *token_index, bool
         return nullptr;
 
     while (true) {
-        Token *token = &pc->tokens->at(*token_index);
-        if (token->id != TokenIdBinXor)
+        int token = *token_index;
+        if (token_id(pc->tokens, token) != TokenIdBinXor)
             return operand_1;
         *token_index += 1;
 
@@ -1461,8 +1482,8 @@ static AstNode *ast_parse_bin_or_expr(ParseContext *pc, int *token_index, bool m
         return nullptr;
 
     while (true) {
-        Token *token = &pc->tokens->at(*token_index);
-        if (token->id != TokenIdBinOr)
+        int token = *token_index;
+        if (token_id(pc->tokens, token) != TokenIdBinOr)
             return operand_1;
         *token_index += 1;
 
@@ -1478,8 +1499,8 @@ static AstNode *ast_parse_bin_or_expr(ParseContext *pc, int *token_index, bool m
     }
 }
 
-static BinOpType tok_to_cmp_op(Token *token) {
-    switch (token->id) {
+static BinOpType tok_to_cmp_op(TokenId id) {
+    switch (id) {
         case TokenIdCmpEq: return BinOpTypeCmpEq;
         case TokenIdCmpNotEq: return BinOpTypeCmpNotEq;
         case TokenIdCmpLessThan: return BinOpTypeCmpLessThan;
@@ -1491,8 +1512,8 @@ static BinOpType tok_to_cmp_op(Token *token) {
 }
 
 static BinOpType ast_parse_comparison_operator(ParseContext *pc, int *token_index, bool mandatory) {
-    Token *token = &pc->tokens->at(*token_index);
-    BinOpType result = tok_to_cmp_op(token);
+    int token = *token_index;
+    BinOpType result = tok_to_cmp_op(token_id(pc->tokens, token));
     if (result == BinOpTypeInvalid) {
         if (mandatory) {
             ast_invalid_token_error(pc, token);
@@ -1512,7 +1533,7 @@ static AstNode *ast_parse_comparison_expr(ParseContext *pc, int *token_index, bo
     if (!operand_1)
         return nullptr;
 
-    Token *token = &pc->tokens->at(*token_index);
+    int token = *token_index;
     BinOpType cmp_op = ast_parse_comparison_operator(pc, token_index, false);
     if (cmp_op == BinOpTypeInvalid)
         return operand_1;
@@ -1537,8 +1558,8 @@ static AstNode *ast_parse_bool_and_expr(ParseContext *pc, int *token_index, bool
         return nullptr;
 
     while (true) {
-        Token *token = &pc->tokens->at(*token_index);
-        if (token->id != TokenIdBoolAnd)
+        int token = *token_index;
+        if (token_id(pc->tokens, token) != TokenIdBoolAnd)
             return operand_1;
         *token_index += 1;
 
@@ -1558,9 +1579,9 @@ static AstNode *ast_parse_bool_and_expr(ParseContext *pc, int *token_index, bool
 Else : token(Else) Expression
 */
 static AstNode *ast_parse_else(ParseContext *pc, int *token_index, bool mandatory) {
-    Token *else_token = &pc->tokens->at(*token_index);
+    int else_token = *token_index;
 
-    if (else_token->id != TokenIdKeywordElse) {
+    if (token_id(pc->tokens, else_token) != TokenIdKeywordElse) {
         if (mandatory) {
             ast_expect_token(pc, else_token, TokenIdKeywordElse);
         } else {
@@ -1578,8 +1599,8 @@ IfBoolExpression : token(If) token(LParen) Expression token(RParen) Expression o
 IfVarExpression : token(If) token(LParen) (token(Const) | token(Var)) token(Symbol) option(Expression) Token(MaybeAssign) Expression token(RParen) Expression Option(Else)
 */
 static AstNode *ast_parse_if_expr(ParseContext *pc, int *token_index, bool mandatory) {
-    Token *if_tok = &pc->tokens->at(*token_index);
-    if (if_tok->id != TokenIdKeywordIf) {
+    int if_tok = *token_index;
+    if (token_id(pc->tokens, if_tok) != TokenIdKeywordIf) {
         if (mandatory) {
             ast_expect_token(pc, if_tok, TokenIdKeywordIf);
         } else {
@@ -1590,20 +1611,20 @@ static AstNode *ast_parse_if_expr(ParseContext *pc, int *token_index, bool manda
 
     ast_eat_token(pc, token_index, TokenIdLParen);
 
-    Token *token = &pc->tokens->at(*token_index);
-    if (token->id == TokenIdKeywordConst || token->id == TokenIdKeywordVar) {
+    int token = *token_index;
+    if (token_id(pc->tokens, token) == TokenIdKeywordConst || token_id(pc->tokens, token) == TokenIdKeywordVar) {
         AstNode *node = ast_create_node(pc, NodeTypeIfVarExpr, if_tok);
-        node->data.if_var_expr.var_decl.is_const = (token->id == TokenIdKeywordConst);
+        node->data.if_var_expr.var_decl.is_const = (token_id(pc->tokens, token) == TokenIdKeywordConst);
         *token_index += 1;
 
-        Token *name_token = ast_eat_token(pc, token_index, TokenIdSymbol);
-        ast_buf_from_token(pc, name_token, &node->data.if_var_expr.var_decl.symbol);
+        int name_token = ast_eat_token(pc, token_index, TokenIdSymbol);
+        node->data.if_var_expr.var_decl.symbol = ast_intern_token(pc, name_token);
 
-        Token *eq_or_colon = &pc->tokens->at(*token_index);
-        if (eq_or_colon->id == TokenIdMaybeAssign) {
+        int eq_or_colon = *token_index;
+        if (token_id(pc->tokens, eq_or_colon) == TokenIdMaybeAssign) {
             *token_index += 1;
             node->data.if_var_expr.var_decl.expr = ast_parse_expression(pc, token_index, true);
-        } else if (eq_or_colon->id == TokenIdColon) {
+        } else if (token_id(pc->tokens, eq_or_colon) == TokenIdColon) {
             *token_index += 1;
             node->data.if_var_expr.var_decl.type = ast_parse_prefix_op_expr(pc, token_index, true);
 
@@ -1634,30 +1655,30 @@ static AstNode *ast_parse_if_expr(ParseContext *pc, int *token_index, bool manda
 ReturnExpression : option("%" | "?") "return" option(Expression)
 */
 static AstNode *ast_parse_return_expr(ParseContext *pc, int *token_index) {
-    Token *token = &pc->tokens->at(*token_index);
+    int token = *token_index;
 
     NodeType node_type;
     ReturnKind kind;
 
-    if (token->id == TokenIdPercent) {
-        Token *next_token = &pc->tokens->at(*token_index + 1);
-        if (next_token->id == TokenIdKeywordReturn) {
+    if (token_id(pc->tokens, token) == TokenIdPercent) {
+        int next_token = *token_index + 1;
+        if (token_id(pc->tokens, next_token) == TokenIdKeywordReturn) {
             kind = ReturnKindError;
             node_type = NodeTypeReturnExpr;
             *token_index += 2;
         } else {
             return nullptr;
         }
-    } else if (token->id == TokenIdMaybe) {
-        Token *next_token = &pc->tokens->at(*token_index + 1);
-        if (next_token->id == TokenIdKeywordReturn) {
+    } else if (token_id(pc->tokens, token) == TokenIdMaybe) {
+        int next_token = *token_index + 1;
+        if (token_id(pc->tokens, next_token) == TokenIdKeywordReturn) {
             kind = ReturnKindMaybe;
             node_type = NodeTypeReturnExpr;
             *token_index += 2;
         } else {
             return nullptr;
         }
-    } else if (token->id == TokenIdKeywordReturn) {
+    } else if (token_id(pc->tokens, token) == TokenIdKeywordReturn) {
         kind = ReturnKindUnconditional;
         node_type = NodeTypeReturnExpr;
         *token_index += 1;
@@ -1677,30 +1698,30 @@ static AstNode *ast_parse_return_expr(ParseContext *pc, int *token_index) {
 Defer = option("%" | "?") "defer" option(Expression)
 */
 static AstNode *ast_parse_defer_expr(ParseContext *pc, int *token_index) {
-    Token *token = &pc->tokens->at(*token_index);
+    int token = *token_index;
 
     NodeType node_type;
     ReturnKind kind;
 
-    if (token->id == TokenIdPercent) {
-        Token *next_token = &pc->tokens->at(*token_index + 1);
-        if (next_token->id == TokenIdKeywordDefer) {
+    if (token_id(pc->tokens, token) == TokenIdPercent) {
+        int next_token = *token_index + 1;
+        if (token_id(pc->tokens, next_token) == TokenIdKeywordDefer) {
             kind = ReturnKindError;
             node_type = NodeTypeDefer;
             *token_index += 2;
         } else {
             return nullptr;
         }
-    } else if (token->id == TokenIdMaybe) {
-        Token *next_token = &pc->tokens->at(*token_index + 1);
-        if (next_token->id == TokenIdKeywordDefer) {
+    } else if (token_id(pc->tokens, token) == TokenIdMaybe) {
+        int next_token = *token_index + 1;
+        if (token_id(pc->tokens, next_token) == TokenIdKeywordDefer) {
             kind = ReturnKindMaybe;
             node_type = NodeTypeDefer;
             *token_index += 2;
         } else {
             return nullptr;
         }
-    } else if (token->id == TokenIdKeywordDefer) {
+    } else if (token_id(pc->tokens, token) == TokenIdKeywordDefer) {
         kind = ReturnKindUnconditional;
         node_type = NodeTypeDefer;
         *token_index += 1;
@@ -1722,13 +1743,13 @@ VariableDeclaration : ("var" | "const") "Symbol" ("=" Expression | ":" PrefixOpE
 static AstNode *ast_parse_variable_declaration_expr(ParseContext *pc, int *token_index, bool mandatory,
         ZigList<AstNode*> *directives, VisibMod visib_mod)
 {
-    Token *first_token = &pc->tokens->at(*token_index);
+    int first_token = *token_index;
 
     bool is_const;
 
-    if (first_token->id == TokenIdKeywordVar) {
+    if (token_id(pc->tokens, first_token) == TokenIdKeywordVar) {
         is_const = false;
-    } else if (first_token->id == TokenIdKeywordConst) {
+    } else if (token_id(pc->tokens, first_token) == TokenIdKeywordConst) {
         is_const = true;
     } else if (mandatory) {
         ast_invalid_token_error(pc, first_token);
@@ -1744,20 +1765,20 @@ static AstNode *ast_parse_variable_declaration_expr(ParseContext *pc, int *token
     node->data.variable_declaration.visib_mod = visib_mod;
     node->data.variable_declaration.directives = directives;
 
-    Token *name_token = ast_eat_token(pc, token_index, TokenIdSymbol);
-    ast_buf_from_token(pc, name_token, &node->data.variable_declaration.symbol);
+    int name_token = ast_eat_token(pc, token_index, TokenIdSymbol);
+    node->data.variable_declaration.symbol = ast_intern_token(pc, name_token);
 
-    Token *eq_or_colon = &pc->tokens->at(*token_index);
+    int eq_or_colon = *token_index;
     *token_index += 1;
-    if (eq_or_colon->id == TokenIdEq) {
+    if (token_id(pc->tokens, eq_or_colon) == TokenIdEq) {
         node->data.variable_declaration.expr = ast_parse_expression(pc, token_index, true);
 
         normalize_parent_ptrs(node);
         return node;
-    } else if (eq_or_colon->id == TokenIdColon) {
+    } else if (token_id(pc->tokens, eq_or_colon) == TokenIdColon) {
         node->data.variable_declaration.type = ast_parse_prefix_op_expr(pc, token_index, true);
-        Token *eq_token = &pc->tokens->at(*token_index);
-        if (eq_token->id == TokenIdEq) {
+        int eq_token = *token_index;
+        if (token_id(pc->tokens, eq_token) == TokenIdEq) {
             *token_index += 1;
 
             node->data.variable_declaration.expr = ast_parse_expression(pc, token_index, true);
@@ -1779,8 +1800,8 @@ static AstNode *ast_parse_bool_or_expr(ParseContext *pc, int *token_index, bool
         return nullptr;
 
     while (true) {
-        Token *token = &pc->tokens->at(*token_index);
-        if (token->id != TokenIdBoolOr)
+        int token = *token_index;
+        if (token_id(pc->tokens, token) != TokenIdBoolOr)
             return operand_1;
         *token_index += 1;
 
@@ -1800,9 +1821,9 @@ static AstNode *ast_parse_bool_or_expr(ParseContext *pc, int *token_index, bool
 WhileExpression : token(While) token(LParen) Expression token(RParen) Expression
 */
 static AstNode *ast_parse_while_expr(ParseContext *pc, int *token_index, bool mandatory) {
-    Token *token = &pc->tokens->at(*token_index);
+    int token = *token_index;
 
-    if (token->id != TokenIdKeywordWhile) {
+    if (token_id(pc->tokens, token) != TokenIdKeywordWhile) {
         if (mandatory) {
             ast_expect_token(pc, token, TokenIdKeywordWhile);
         } else {
@@ -1825,9 +1846,9 @@ static AstNode *ast_parse_while_expr(ParseContext *pc, int *token_index, bool ma
 }
 
 static AstNode *ast_parse_symbol(ParseContext *pc, int *token_index) {
-    Token *token = ast_eat_token(pc, token_index, TokenIdSymbol);
+    int token = ast_eat_token(pc, token_index, TokenIdSymbol);
     AstNode *node = ast_create_node(pc, NodeTypeSymbol, token);
-    ast_buf_from_token(pc, token, &node->data.symbol_expr.symbol);
+    node->data.symbol_expr.symbol = ast_intern_token(pc, token);
     return node;
 }
 
@@ -1835,9 +1856,9 @@ static AstNode *ast_parse_symbol(ParseContext *pc, int *token_index) {
 ForExpression = "for" "(" Expression ")" option("|" "Symbol" option("," "Symbol") "|") Expression
 */
 static AstNode *ast_parse_for_expr(ParseContext *pc, int *token_index, bool mandatory) {
-    Token *token = &pc->tokens->at(*token_index);
+    int token = *token_index;
 
-    if (token->id != TokenIdKeywordFor) {
+    if (token_id(pc->tokens, token) != TokenIdKeywordFor) {
         if (mandatory) {
             ast_expect_token(pc, token, TokenIdKeywordFor);
         } else {
@@ -1852,13 +1873,13 @@ static AstNode *ast_parse_for_expr(ParseContext *pc, int *token_index, bool mand
     node->data.for_expr.array_expr = ast_parse_expression(pc, token_index, true);
     ast_eat_token(pc, token_index, TokenIdRParen);
 
-    Token *maybe_bar = &pc->tokens->at(*token_index);
-    if (maybe_bar->id == TokenIdBinOr) {
+    int maybe_bar = *token_index;
+    if (token_id(pc->tokens, maybe_bar) == TokenIdBinOr) {
         *token_index += 1;
         node->data.for_expr.elem_node = ast_parse_symbol(pc, token_index);
 
-        Token *maybe_comma = &pc->tokens->at(*token_index);
-        if (maybe_comma->id == TokenIdComma) {
+        int maybe_comma = *token_index;
+        if (token_id(pc->tokens, maybe_comma) == TokenIdComma) {
             *token_index += 1;
 
             node->data.for_expr.index_node = ast_parse_symbol(pc, token_index);
@@ -1879,9 +1900,9 @@ SwitchProng = (list(SwitchItem, ",") | "else") "=>" option("|" "Symbol" "|") Exp
 SwitchItem : Expression | (Expression "..." Expression)
 */
 static AstNode *ast_parse_switch_expr(ParseContext *pc, int *token_index, bool mandatory) {
-    Token *token = &pc->tokens->at(*token_index);
+    int token = *token_index;
 
-    if (token->id != TokenIdKeywordSwitch) {
+    if (token_id(pc->tokens, token) != TokenIdKeywordSwitch) {
         if (mandatory) {
             ast_expect_token(pc, token, TokenIdKeywordSwitch);
         } else {
@@ -1898,9 +1919,9 @@ static AstNode *ast_parse_switch_expr(ParseContext *pc, int *token_index, bool m
     ast_eat_token(pc, token_index, TokenIdLBrace);
 
     for (;;) {
-        Token *token = &pc->tokens->at(*token_index);
+        int token = *token_index;
 
-        if (token->id == TokenIdRBrace) {
+        if (token_id(pc->tokens, token) == TokenIdRBrace) {
             *token_index += 1;
 
             normalize_parent_ptrs(node);
@@ -1910,12 +1931,12 @@ static AstNode *ast_parse_switch_expr(ParseContext *pc, int *token_index, bool m
         AstNode *prong_node = ast_create_node(pc, NodeTypeSwitchProng, token);
         node->data.switch_expr.prongs.append(prong_node);
 
-        if (token->id == TokenIdKeywordElse) {
+        if (token_id(pc->tokens, token) == TokenIdKeywordElse) {
             *token_index += 1;
         } else for (;;) {
             AstNode *expr1 = ast_parse_expression(pc, token_index, true);
-            Token *ellipsis_tok = &pc->tokens->at(*token_index);
-            if (ellipsis_tok->id == TokenIdEllipsis) {
+            int ellipsis_tok = *token_index;
+            if (token_id(pc->tokens, ellipsis_tok) == TokenIdEllipsis) {
                 *token_index += 1;
 
                 AstNode *range_node = ast_create_node(pc, NodeTypeSwitchRange, ellipsis_tok);
@@ -1928,8 +1949,8 @@ static AstNode *ast_parse_switch_expr(ParseContext *pc, int *token_index, bool m
             } else {
                 prong_node->data.switch_prong.items.append(expr1);
             }
-            Token *comma_tok = &pc->tokens->at(*token_index);
-            if (comma_tok->id == TokenIdComma) {
+            int comma_tok = *token_index;
+            if (token_id(pc->tokens, comma_tok) == TokenIdComma) {
                 *token_index += 1;
                 continue;
             }
@@ -1938,8 +1959,8 @@ static AstNode *ast_parse_switch_expr(ParseContext *pc, int *token_index, bool m
 
         ast_eat_token(pc, token_index, TokenIdFatArrow);
 
-        Token *maybe_bar = &pc->tokens->at(*token_index);
-        if (maybe_bar->id == TokenIdBinOr) {
+        int maybe_bar = *token_index;
+        if (token_id(pc->tokens, maybe_bar) == TokenIdBinOr) {
             *token_index += 1;
             prong_node->data.switch_prong.var_symbol = ast_parse_symbol(pc, token_index);
             ast_eat_token(pc, token_index, TokenIdBinOr);
@@ -1956,7 +1977,7 @@ static AstNode *ast_parse_switch_expr(ParseContext *pc, int *token_index, bool m
 BlockExpression : IfExpression | Block | WhileExpression | ForExpression | SwitchExpression
 */
 static AstNode *ast_parse_block_expr(ParseContext *pc, int *token_index, bool mandatory) {
-    Token *token = &pc->tokens->at(*token_index);
+    int token = *token_index;
 
     AstNode *if_expr = ast_parse_if_expr(pc, token_index, false);
     if (if_expr)
@@ -1984,8 +2005,8 @@ static AstNode *ast_parse_block_expr(ParseContext *pc, int *token_index, bool ma
     return nullptr;
 }
 
-static BinOpType tok_to_ass_op(Token *token) {
-    switch (token->id) {
+static BinOpType tok_to_ass_op(TokenId id) {
+    switch (id) {
         case TokenIdEq: return BinOpTypeAssign;
         case TokenIdTimesEq: return BinOpTypeAssignTimes;
         case TokenIdDivEq: return BinOpTypeAssignDiv;
@@ -2007,8 +2028,8 @@ static BinOpType tok_to_ass_op(Token *token) {
 AssignmentOperator : token(Eq) | token(TimesEq) | token(DivEq) | token(ModEq) | token(PlusEq) | token(MinusEq) | token(BitShiftLeftEq) | token(BitShiftRightEq) | token(BitAndEq) | token(BitXorEq) | token(BitOrEq) | token(BoolAndEq) | token(BoolOrEq)
 */
 static BinOpType ast_parse_ass_op(ParseContext *pc, int *token_index, bool mandatory) {
-    Token *token = &pc->tokens->at(*token_index);
-    BinOpType result = tok_to_ass_op(token);
+    int token = *token_index;
+    BinOpType result = tok_to_ass_op(token_id(pc->tokens, token));
     if (result == BinOpTypeInvalid) {
         if (mandatory) {
             ast_invalid_token_error(pc, token);
@@ -2030,9 +2051,9 @@ static AstNode *ast_parse_unwrap_expr(ParseContext *pc, int *token_index, bool m
     if (!lhs)
         return nullptr;
 
-    Token *token = &pc->tokens->at(*token_index);
+    int token = *token_index;
 
-    if (token->id == TokenIdDoubleQuestion) {
+    if (token_id(pc->tokens, token) == TokenIdDoubleQuestion) {
         *token_index += 1;
 
         AstNode *rhs = ast_parse_expression(pc, token_index, true);
@@ -2044,14 +2065,14 @@ static AstNode *ast_parse_unwrap_expr(ParseContext *pc, int *token_index, bool m
 
         normalize_parent_ptrs(node);
         return node;
-    } else if (token->id == TokenIdPercentPercent) {
+    } else if (token_id(pc->tokens, token) == TokenIdPercentPercent) {
         *token_index += 1;
 
         AstNode *node = ast_create_node(pc, NodeTypeUnwrapErrorExpr, token);
         node->data.unwrap_err_expr.op1 = lhs;
 
-        Token *maybe_bar_tok = &pc->tokens->at(*token_index);
-        if (maybe_bar_tok->id == TokenIdBinOr) {
+        int maybe_bar_tok = *token_index;
+        if (token_id(pc->tokens, maybe_bar_tok) == TokenIdBinOr) {
             *token_index += 1;
             node->data.unwrap_err_expr.symbol = ast_parse_symbol(pc, token_index);
             ast_eat_token(pc, token_index, TokenIdBinOr);
@@ -2073,7 +2094,7 @@ static AstNode *ast_parse_ass_expr(ParseContext *pc, int *token_index, bool mand
     if (!lhs)
         return nullptr;
 
-    Token *token = &pc->tokens->at(*token_index);
+    int token = *token_index;
     BinOpType ass_op = ast_parse_ass_op(pc, token_index, false);
     if (ass_op == BinOpTypeInvalid)
         return lhs;
@@ -2093,7 +2114,7 @@ static AstNode *ast_parse_ass_expr(ParseContext *pc, int *token_index, bool mand
 NonBlockExpression : ReturnExpression | AssignmentExpression
 */
 static AstNode *ast_parse_non_block_expr(ParseContext *pc, int *token_index, bool mandatory) {
-    Token *token = &pc->tokens->at(*token_index);
+    int token = *token_index;
 
     AstNode *return_expr = ast_parse_return_expr(pc, token_index);
     if (return_expr)
@@ -2113,7 +2134,7 @@ static AstNode *ast_parse_non_block_expr(ParseContext *pc, int *token_index, boo
 Expression : BlockExpression | NonBlockExpression
 */
 static AstNode *ast_parse_expression(ParseContext *pc, int *token_index, bool mandatory) {
-    Token *token = &pc->tokens->at(*token_index);
+    int token = *token_index;
 
     AstNode *block_expr = ast_parse_block_expr(pc, token_index, false);
     if (block_expr)
@@ -2133,8 +2154,8 @@ static AstNode *ast_parse_expression(ParseContext *pc, int *token_index, bool ma
 Label: token(Symbol) token(Colon)
 */
 static AstNode *ast_parse_label(ParseContext *pc, int *token_index, bool mandatory) {
-    Token *symbol_token = &pc->tokens->at(*token_index);
-    if (symbol_token->id != TokenIdSymbol) {
+    int symbol_token = *token_index;
+    if (token_id(pc->tokens, symbol_token) != TokenIdSymbol) {
         if (mandatory) {
             ast_expect_token(pc, symbol_token, TokenIdSymbol);
         } else {
@@ -2142,8 +2163,8 @@ static AstNode *ast_parse_label(ParseContext *pc, int *token_index, bool mandato
         }
     }
 
-    Token *colon_token = &pc->tokens->at(*token_index + 1);
-    if (colon_token->id != TokenIdColon) {
+    int colon_token = *token_index + 1;
+    if (token_id(pc->tokens, colon_token) != TokenIdColon) {
         if (mandatory) {
             ast_expect_token(pc, colon_token, TokenIdColon);
         } else {
@@ -2158,11 +2179,11 @@ static AstNode *ast_parse_label(ParseContext *pc, int *token_index, bool mandato
     return node;
 }
 
-static AstNode *ast_create_void_expr(ParseContext *pc, Token *token) {
+static AstNode *ast_create_void_expr(ParseContext *pc, int token) {
     AstNode *node = ast_create_node(pc, NodeTypeContainerInitExpr, token);
     node->data.container_init_expr.type = ast_create_node(pc, NodeTypeSymbol, token);
     node->data.container_init_expr.kind = ContainerInitKindArray;
-    buf_init_from_str(&node->data.container_init_expr.type->data.symbol_expr.symbol, "void");
+    node->data.container_init_expr.type->data.symbol_expr.symbol = buf_intern_str("void");
     normalize_parent_ptrs(node);
     return node;
 }
@@ -2172,9 +2193,9 @@ Block : token(LBrace) list(option(Statement), token(Semicolon)) token(RBrace)
 Statement = Label | VariableDeclaration ";" | Defer ";" | NonBlockExpression ";" | BlockExpression
 */
 static AstNode *ast_parse_block(ParseContext *pc, int *token_index, bool mandatory) {
-    Token *last_token = &pc->tokens->at(*token_index);
+    int last_token = *token_index;
 
-    if (last_token->id != TokenIdLBrace) {
+    if (token_id(pc->tokens, last_token) != TokenIdLBrace) {
         if (mandatory) {
             ast_expect_token(pc, last_token, TokenIdLBrace);
         } else {
@@ -2184,6 +2205,7 @@ static AstNode *ast_parse_block(ParseContext *pc, int *token_index, bool mandato
     *token_index += 1;
 
     AstNode *node = ast_create_node(pc, NodeTypeBlock, last_token);
+    int stack_base = pc->node_stack.length;
 
     // {}   -> {void}
     // {;}  -> {void;void}
@@ -2214,17 +2236,18 @@ static AstNode *ast_parse_block(ParseContext *pc, int *token_index, bool mandato
                 }
             }
         }
-        node->data.block.statements.append(statement_node);
+        pc->node_stack.append(statement_node);
 
-        last_token = &pc->tokens->at(*token_index);
-        if (last_token->id == TokenIdRBrace) {
+        last_token = *token_index;
+        if (token_id(pc->tokens, last_token) == TokenIdRBrace) {
             *token_index += 1;
 
+            ast_pop_node_list(pc, stack_base, &node->data.block.statements);
             normalize_parent_ptrs(node);
             return node;
         } else if (!semicolon_expected) {
             continue;
-        } else if (last_token->id == TokenIdSemicolon) {
+        } else if (token_id(pc->tokens, last_token) == TokenIdSemicolon) {
             *token_index += 1;
         } else {
             ast_invalid_token_error(pc, last_token);
@@ -2239,9 +2262,9 @@ FnProto : "fn" option("Symbol") ParamDeclList option("->" PrefixOpExpression)
 static AstNode *ast_parse_fn_proto(ParseContext *pc, int *token_index, bool mandatory,
         ZigList<AstNode*> *directives, VisibMod visib_mod)
 {
-    Token *first_token = &pc->tokens->at(*token_index);
+    int first_token = *token_index;
 
-    if (first_token->id != TokenIdKeywordFn) {
+    if (token_id(pc->tokens, first_token) != TokenIdKeywordFn) {
         if (mandatory) {
             ast_expect_token(pc, first_token, TokenIdKeywordFn);
         } else {
@@ -2254,18 +2277,18 @@ static AstNode *ast_parse_fn_proto(ParseContext *pc, int *token_index, bool mand
     node->data.fn_proto.visib_mod = visib_mod;
     node->data.fn_proto.directives = directives;
 
-    Token *fn_name = &pc->tokens->at(*token_index);
-    if (fn_name->id == TokenIdSymbol) {
+    int fn_name = *token_index;
+    if (token_id(pc->tokens, fn_name) == TokenIdSymbol) {
         *token_index += 1;
-        ast_buf_from_token(pc, fn_name, &node->data.fn_proto.name);
+        node->data.fn_proto.name = ast_intern_token(pc, fn_name);
     } else {
-        buf_resize(&node->data.fn_proto.name, 0);
+        node->data.fn_proto.name = buf_intern_str("");
     }
 
     ast_parse_param_decl_list(pc, token_index, &node->data.fn_proto.params, &node->data.fn_proto.is_var_args);
 
-    Token *next_token = &pc->tokens->at(*token_index);
-    if (next_token->id == TokenIdArrow) {
+    int next_token = *token_index;
+    if (token_id(pc->tokens, next_token) == TokenIdArrow) {
         *token_index += 1;
         node->data.fn_proto.return_type = ast_parse_prefix_op_expr(pc, token_index, false);
     } else {
@@ -2282,9 +2305,9 @@ FnDef = option("inline") FnProto Block
 static AstNode *ast_parse_fn_def(ParseContext *pc, int *token_index, bool mandatory,
         ZigList<AstNode*> *directives, VisibMod visib_mod)
 {
-    Token *first_token = &pc->tokens->at(*token_index);
+    int first_token = *token_index;
     bool is_inline;
-    if (first_token->id == TokenIdKeywordInline) {
+    if (token_id(pc->tokens, first_token) == TokenIdKeywordInline) {
         *token_index += 1;
         is_inline = true;
     } else {
@@ -2310,8 +2333,8 @@ ExternDecl = "extern" (FnProto | VariableDeclaration) ";"
 static AstNode *ast_parse_extern_decl(ParseContext *pc, int *token_index, bool mandatory,
         ZigList<AstNode *> *directives, VisibMod visib_mod)
 {
-    Token *extern_kw = &pc->tokens->at(*token_index);
-    if (extern_kw->id != TokenIdKeywordExtern) {
+    int extern_kw = *token_index;
+    if (token_id(pc->tokens, extern_kw) != TokenIdKeywordExtern) {
         if (mandatory) {
             ast_expect_token(pc, extern_kw, TokenIdKeywordExtern);
         } else {
@@ -2340,7 +2363,7 @@ static AstNode *ast_parse_extern_decl(ParseContext *pc, int *token_index, bool m
         return var_decl_node;
     }
 
-    Token *token = &pc->tokens->at(*token_index);
+    int token = *token_index;
     ast_invalid_token_error(pc, token);
 }
 
@@ -2350,8 +2373,8 @@ RootExportDecl : "export" "Symbol" "String" ";"
 static AstNode *ast_parse_root_export_decl(ParseContext *pc, int *token_index,
         ZigList<AstNode*> *directives)
 {
-    Token *export_type = &pc->tokens->at(*token_index);
-    if (export_type->id != TokenIdSymbol)
+    int export_type = *token_index;
+    if (token_id(pc->tokens, export_type) != TokenIdSymbol)
         return nullptr;
 
     *token_index += 1;
@@ -2361,13 +2384,13 @@ static AstNode *ast_parse_root_export_decl(ParseContext *pc, int *token_index,
 
     ast_buf_from_token(pc, export_type, &node->data.root_export_decl.type);
 
-    Token *export_name = &pc->tokens->at(*token_index);
+    int export_name = *token_index;
     *token_index += 1;
     ast_expect_token(pc, export_name, TokenIdStringLiteral);
 
     parse_string_literal(pc, export_name, &node->data.root_export_decl.name, nullptr, nullptr);
 
-    Token *semicolon = &pc->tokens->at(*token_index);
+    int semicolon = *token_index;
     *token_index += 1;
     ast_expect_token(pc, semicolon, TokenIdSemicolon);
 
@@ -2381,12 +2404,12 @@ Import : "import" "String" ";"
 static AstNode *ast_parse_import(ParseContext *pc, int *token_index,
         ZigList<AstNode*> *directives, VisibMod visib_mod)
 {
-    Token *import_kw = &pc->tokens->at(*token_index);
-    if (import_kw->id != TokenIdKeywordImport)
+    int import_kw = *token_index;
+    if (token_id(pc->tokens, import_kw) != TokenIdKeywordImport)
         return nullptr;
     *token_index += 1;
 
-    Token *import_name = ast_eat_token(pc, token_index, TokenIdStringLiteral);
+    int import_name = ast_eat_token(pc, token_index, TokenIdStringLiteral);
 
     ast_eat_token(pc, token_index, TokenIdSemicolon);
 
@@ -2405,8 +2428,8 @@ CImportDecl : "c_import" Block
 static AstNode *ast_parse_c_import(ParseContext *pc, int *token_index,
         ZigList<AstNode*> *directives, VisibMod visib_mod)
 {
-    Token *c_import_kw = &pc->tokens->at(*token_index);
-    if (c_import_kw->id != TokenIdKeywordCImport)
+    int c_import_kw = *token_index;
+    if (token_id(pc->tokens, c_import_kw) != TokenIdKeywordCImport)
         return nullptr;
     *token_index += 1;
 
@@ -2427,20 +2450,20 @@ StructField : "Symbol" option(":" Expression) ",")
 static AstNode *ast_parse_struct_decl(ParseContext *pc, int *token_index,
         ZigList<AstNode*> *directives, VisibMod visib_mod)
 {
-    Token *first_token = &pc->tokens->at(*token_index);
+    int first_token = *token_index;
 
     ContainerKind kind;
 
-    if (first_token->id == TokenIdKeywordStruct) {
+    if (token_id(pc->tokens, first_token) == TokenIdKeywordStruct) {
         kind = ContainerKindStruct;
-    } else if (first_token->id == TokenIdKeywordEnum) {
+    } else if (token_id(pc->tokens, first_token) == TokenIdKeywordEnum) {
         kind = ContainerKindEnum;
     } else {
         return nullptr;
     }
     *token_index += 1;
 
-    Token *struct_name = ast_eat_token(pc, token_index, TokenIdSymbol);
+    int struct_name = ast_eat_token(pc, token_index, TokenIdSymbol);
 
     AstNode *node = ast_create_node(pc, NodeTypeStructDecl, first_token);
     node->data.struct_decl.kind = kind;
@@ -2451,16 +2474,16 @@ static AstNode *ast_parse_struct_decl(ParseContext *pc, int *token_index,
     ast_eat_token(pc, token_index, TokenIdLBrace);
 
     for (;;) {
-        Token *directive_token = &pc->tokens->at(*token_index);
+        int directive_token = *token_index;
         ZigList<AstNode *> *directive_list = allocate<ZigList<AstNode*>>(1);
         ast_parse_directives(pc, token_index, directive_list);
 
-        Token *visib_tok = &pc->tokens->at(*token_index);
+        int visib_tok = *token_index;
         VisibMod visib_mod;
-        if (visib_tok->id == TokenIdKeywordPub) {
+        if (token_id(pc->tokens, visib_tok) == TokenIdKeywordPub) {
             *token_index += 1;
             visib_mod = VisibModPub;
-        } else if (visib_tok->id == TokenIdKeywordExport) {
+        } else if (token_id(pc->tokens, visib_tok) == TokenIdKeywordExport) {
             *token_index += 1;
             visib_mod = VisibModExport;
         } else {
@@ -2473,16 +2496,16 @@ static AstNode *ast_parse_struct_decl(ParseContext *pc, int *token_index,
             continue;
         }
 
-        Token *token = &pc->tokens->at(*token_index);
+        int token = *token_index;
 
-        if (token->id == TokenIdRBrace) {
+        if (token_id(pc->tokens, token) == TokenIdRBrace) {
             if (directive_list->length > 0) {
                 ast_error(pc, directive_token, "invalid directive");
             }
 
             *token_index += 1;
             break;
-        } else if (token->id == TokenIdSymbol) {
+        } else if (token_id(pc->tokens, token) == TokenIdSymbol) {
             AstNode *field_node = ast_create_node(pc, NodeTypeStructField, token);
             *token_index += 1;
 
@@ -2491,8 +2514,8 @@ static AstNode *ast_parse_struct_decl(ParseContext *pc, int *token_index,
 
             ast_buf_from_token(pc, token, &field_node->data.struct_field.name);
 
-            Token *expr_or_comma = &pc->tokens->at(*token_index);
-            if (expr_or_comma->id == TokenIdComma) {
+            int expr_or_comma = *token_index;
+            if (token_id(pc->tokens, expr_or_comma) == TokenIdComma) {
                 field_node->data.struct_field.type = ast_create_void_type_node(pc, expr_or_comma);
                 *token_index += 1;
             } else {
@@ -2518,14 +2541,14 @@ ErrorValueDecl : "error" "Symbol" ";"
 static AstNode *ast_parse_error_value_decl(ParseContext *pc, int *token_index,
         ZigList<AstNode*> *directives, VisibMod visib_mod)
 {
-    Token *first_token = &pc->tokens->at(*token_index);
+    int first_token = *token_index;
 
-    if (first_token->id != TokenIdKeywordError) {
+    if (token_id(pc->tokens, first_token) != TokenIdKeywordError) {
         return nullptr;
     }
     *token_index += 1;
 
-    Token *name_tok = ast_eat_token(pc, token_index, TokenIdSymbol);
+    int name_tok = ast_eat_token(pc, token_index, TokenIdSymbol);
     ast_eat_token(pc, token_index, TokenIdSemicolon);
 
     AstNode *node = ast_create_node(pc, NodeTypeErrorValueDecl, first_token);
@@ -2543,18 +2566,18 @@ TypeDecl = "type" "Symbol" "=" TypeExpr ";"
 static AstNode *ast_parse_type_decl(ParseContext *pc, int *token_index,
         ZigList<AstNode*> *directives, VisibMod visib_mod)
 {
-    Token *first_token = &pc->tokens->at(*token_index);
+    int first_token = *token_index;
 
-    if (first_token->id != TokenIdKeywordType) {
+    if (token_id(pc->tokens, first_token) != TokenIdKeywordType) {
         return nullptr;
     }
     *token_index += 1;
 
-    Token *name_tok = ast_eat_token(pc, token_index, TokenIdSymbol);
+    int name_tok = ast_eat_token(pc, token_index, TokenIdSymbol);
     ast_eat_token(pc, token_index, TokenIdEq);
 
     AstNode *node = ast_create_node(pc, NodeTypeTypeDecl, first_token);
-    ast_buf_from_token(pc, name_tok, &node->data.type_decl.symbol);
+    node->data.type_decl.symbol = ast_intern_token(pc, name_tok);
     node->data.type_decl.child_type = ast_parse_prefix_op_expr(pc, token_index, true);
 
     ast_eat_token(pc, token_index, TokenIdSemicolon);
@@ -2570,17 +2593,18 @@ static AstNode *ast_parse_type_decl(ParseContext *pc, int *token_index,
 TopLevelDecl = many(Directive) option(VisibleMod) (FnDef | ExternDecl | RootExportDecl | Import | ContainerDecl | GlobalVarDecl | ErrorValueDecl | CImportDecl | TypeDecl)
 */
 static void ast_parse_top_level_decls(ParseContext *pc, int *token_index, ZigList<AstNode *> *top_level_decls) {
+    int stack_base = pc->node_stack.length;
     for (;;) {
-        Token *directive_token = &pc->tokens->at(*token_index);
+        int directive_token = *token_index;
         ZigList<AstNode *> *directives = allocate<ZigList<AstNode*>>(1);
         ast_parse_directives(pc, token_index, directives);
 
-        Token *visib_tok = &pc->tokens->at(*token_index);
+        int visib_tok = *token_index;
         VisibMod visib_mod;
-        if (visib_tok->id == TokenIdKeywordPub) {
+        if (token_id(pc->tokens, visib_tok) == TokenIdKeywordPub) {
             *token_index += 1;
             visib_mod = VisibModPub;
-        } else if (visib_tok->id == TokenIdKeywordExport) {
+        } else if (token_id(pc->tokens, visib_tok) == TokenIdKeywordExport) {
             *token_index += 1;
             visib_mod = VisibModExport;
         } else {
@@ -2593,38 +2617,38 @@ static void ast_parse_top_level_decls(ParseContext *pc, int *token_index, ZigLis
         if (try_to_parse_root_export) {
             AstNode *root_export_decl_node = ast_parse_root_export_decl(pc, token_index, directives);
             if (root_export_decl_node) {
-                top_level_decls->append(root_export_decl_node);
+                pc->node_stack.append(root_export_decl_node);
                 continue;
             }
         }
 
         AstNode *fn_def_node = ast_parse_fn_def(pc, token_index, false, directives, visib_mod);
         if (fn_def_node) {
-            top_level_decls->append(fn_def_node);
+            pc->node_stack.append(fn_def_node);
             continue;
         }
 
         AstNode *fn_proto_node = ast_parse_extern_decl(pc, token_index, false, directives, visib_mod);
         if (fn_proto_node) {
-            top_level_decls->append(fn_proto_node);
+            pc->node_stack.append(fn_proto_node);
             continue;
         }
 
         AstNode *import_node = ast_parse_import(pc, token_index, directives, visib_mod);
         if (import_node) {
-            top_level_decls->append(import_node);
+            pc->node_stack.append(import_node);
             continue;
         }
 
         AstNode *c_import_node = ast_parse_c_import(pc, token_index, directives, visib_mod);
         if (c_import_node) {
-            top_level_decls->append(c_import_node);
+            pc->node_stack.append(c_import_node);
             continue;
         }
 
         AstNode *struct_node = ast_parse_struct_decl(pc, token_index, directives, visib_mod);
         if (struct_node) {
-            top_level_decls->append(struct_node);
+            pc->node_stack.append(struct_node);
             continue;
         }
 
@@ -2632,19 +2656,19 @@ static void ast_parse_top_level_decls(ParseContext *pc, int *token_index, ZigLis
                 directives, visib_mod);
         if (var_decl_node) {
             ast_eat_token(pc, token_index, TokenIdSemicolon);
-            top_level_decls->append(var_decl_node);
+            pc->node_stack.append(var_decl_node);
             continue;
         }
 
         AstNode *error_value_node = ast_parse_error_value_decl(pc, token_index, directives, visib_mod);
         if (error_value_node) {
-            top_level_decls->append(error_value_node);
+            pc->node_stack.append(error_value_node);
             continue;
         }
 
         AstNode *type_decl_node = ast_parse_type_decl(pc, token_index, directives, visib_mod);
         if (type_decl_node) {
-            top_level_decls->append(type_decl_node);
+            pc->node_stack.append(type_decl_node);
             continue;
         }
 
@@ -2652,6 +2676,7 @@ static void ast_parse_top_level_decls(ParseContext *pc, int *token_index, ZigLis
             ast_error(pc, directive_token, "invalid directive");
         }
 
+        ast_pop_node_list(pc, stack_base, top_level_decls);
         return;
     }
     zig_unreachable();
@@ -2661,19 +2686,19 @@ static void ast_parse_top_level_decls(ParseContext *pc, int *token_index, ZigLis
 Root : many(TopLevelDecl) token(EOF)
  */
 static AstNode *ast_parse_root(ParseContext *pc, int *token_index) {
-    AstNode *node = ast_create_node(pc, NodeTypeRoot, &pc->tokens->at(*token_index));
+    AstNode *node = ast_create_node(pc, NodeTypeRoot, *token_index);
 
     ast_parse_top_level_decls(pc, token_index, &node->data.root.top_level_decls);
 
-    if (*token_index != pc->tokens->length - 1) {
-        ast_invalid_token_error(pc, &pc->tokens->at(*token_index));
+    if (*token_index != token_count(pc->tokens) - 1) {
+        ast_invalid_token_error(pc, *token_index);
     }
 
     normalize_parent_ptrs(node);
     return node;
 }
 
-AstNode *ast_parse(Buf *buf, ZigList<Token> *tokens, ImportTableEntry *owner,
+AstNode *ast_parse(Buf *buf, TokenList *tokens, ImportTableEntry *owner,
         ErrColor err_color, uint32_t *next_node_index)
 {
     ParseContext pc = {0};
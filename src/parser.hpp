@@ -12,12 +12,8 @@
 #include "tokenizer.hpp"
 #include "errmsg.hpp"
 
-__attribute__ ((format (printf, 2, 3)))
-void ast_token_error(Token *token, const char *format, ...);
-
-
 // This function is provided by generated code, generated by parsergen.cpp
-AstNode * ast_parse(Buf *buf, ZigList<Token> *tokens, ImportTableEntry *owner, ErrColor err_color,
+AstNode * ast_parse(Buf *buf, TokenList *tokens, ImportTableEntry *owner, ErrColor err_color,
         uint32_t *next_node_index);
 
 const char *node_type_str(NodeType node_type);
@@ -0,0 +1,131 @@
+/*
+ * Copyright (c) 2016 Andrew Kelley
+ *
+ * This file is part of zig, which is MIT licensed.
+ * See http://opensource.org/licenses/MIT
+ */
+
+#include "timing.hpp"
+#include "os.hpp"
+#include "error.hpp"
+
+Timing *timing_create(void) {
+    Timing *timing = allocate<Timing>(1);
+    timing->events.reserve(64);
+    timing->start_time = os_get_time();
+    return timing;
+}
+
+static void begin_event(Timing *timing, const char *name, Buf *detail, bool is_detail) {
+    // the depth in the report, which leaves out detail events
+    int depth = 0;
+    for (int i = 0; i < timing->open_events.length; i += 1) {
+        if (!timing->events.at(timing->open_events.at(i)).is_detail)
+            depth += 1;
+    }
+
+    timing->open_events.append(timing->events.length);
+    timing->events.add_one();
+    TimingEvent *event = &timing->events.last();
+    event->name = name;
+    event->detail = detail;
+    event->depth = depth;
+    event->is_detail = is_detail;
+    event->wall_start = os_get_time();
+    event->cpu_start = os_get_cpu_time();
+}
+
+static void end_event(Timing *timing) {
+    TimingEvent *event = &timing->events.at(timing->open_events.pop());
+    event->wall_end = os_get_time();
+    event->cpu_end = os_get_cpu_time();
+    event->peak_rss = os_get_peak_rss();
+}
+
+void timing_begin(Timing *timing, const char *name, Buf *detail) {
+    if (timing)
+        begin_event(timing, name, detail, false);
+}
+
+void timing_end(Timing *timing) {
+    if (timing)
+        end_event(timing);
+}
+
+void timing_begin_detail(Timing *timing, const char *name, Buf *detail) {
+    if (timing && timing->record_details)
+        begin_event(timing, name, detail, true);
+}
+
+void timing_end_detail(Timing *timing) {
+    if (timing && timing->record_details)
+        end_event(timing);
+}
+
+void timing_print_report(Timing *timing, FILE *f) {
+    assert(timing->open_events.length == 0);
+
+    fprintf(f, "\nTime Report:\n");
+    fprintf(f, "--------------\n");
+    fprintf(f, "%10s %10s %10s  %s\n", "wall ms", "cpu ms", "peak MiB", "phase");
+    for (int i = 0; i < timing->events.length; i += 1) {
+        TimingEvent *event = &timing->events.at(i);
+        if (event->is_detail)
+            continue;
+        fprintf(f, "%10.2f %10.2f %10.1f  %*s%s",
+                (event->wall_end - event->wall_start) * 1000.0,
+                (event->cpu_end - event->cpu_start) * 1000.0,
+                event->peak_rss / (1024.0 * 1024.0),
+                event->depth * 2, "", event->name);
+        if (event->detail) {
+            fprintf(f, " %s", buf_ptr(event->detail));
+        }
+        fprintf(f, "\n");
+    }
+}
+
+static void write_json_string(FILE *f, const char *str) {
+    fputc('"', f);
+    for (const char *ptr = str; *ptr; ptr += 1) {
+        uint8_t c = *ptr;
+        if (c == '"' || c == '\\') {
+            fprintf(f, "\\%c", c);
+        } else if (c < 0x20) {
+            fprintf(f, "\\u%04x", c);
+        } else {
+            fputc(c, f);
+        }
+    }
+    fputc('"', f);
+}
+
+int timing_write_trace(Timing *timing, Buf *path) {
+    assert(timing->open_events.length == 0);
+
+    FILE *f = fopen(buf_ptr(path), "wb");
+    if (!f)
+        return ErrorFileSystem;
+
+    int pid = os_get_pid();
+    fprintf(f, "{\"traceEvents\":[\n");
+    for (int i = 0; i < timing->events.length; i += 1) {
+        TimingEvent *event = &timing->events.at(i);
+        // complete events, with times in microseconds
+        fprintf(f, "{\"name\":");
+        write_json_string(f, event->name);
+        fprintf(f, ",\"cat\":\"zig\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":%d,\"tid\":1",
+                (event->wall_start - timing->start_time) * 1000000.0,
+                (event->wall_end - event->wall_start) * 1000000.0, pid);
+        if (event->detail) {
+            fprintf(f, ",\"args\":{\"detail\":");
+            write_json_string(f, buf_ptr(event->detail));
+            fprintf(f, "}");
+        }
+        fprintf(f, "}%s\n", (i + 1 < timing->events.length) ? "," : "");
+    }
+    fprintf(f, "]}\n");
+
+    if (fclose(f))
+        return ErrorFileSystem;
+    return 0;
+}
@@ -0,0 +1,59 @@
+/*
+ * Copyright (c) 2016 Andrew Kelley
+ *
+ * This file is part of zig, which is MIT licensed.
+ * See http://opensource.org/licenses/MIT
+ */
+
+#ifndef ZIG_TIMING_HPP
+#define ZIG_TIMING_HPP
+
+#include "buffer.hpp"
+#include "list.hpp"
+
+#include <stdio.h>
+
+struct TimingEvent {
+    const char *name;
+    // what the event applies to, such as a file name. may be null
+    Buf *detail;
+    // how many report events enclose this one
+    int depth;
+    double wall_start;
+    double wall_end;
+    double cpu_start;
+    double cpu_end;
+    // peak resident set size of the process when the event ended
+    size_t peak_rss;
+    // too fine grained for the report, only written to traces
+    bool is_detail;
+};
+
+// Records nested compiler phases for --time-report and --trace-out. Events
+// are kept in the order they began, so a parent always comes before its
+// children.
+struct Timing {
+    ZigList<TimingEvent> events;
+    // indexes of the events which have begun but not ended
+    ZigList<int> open_events;
+    double start_time;
+    // whether to record timing_begin_detail events
+    bool record_details;
+};
+
+Timing *timing_create(void);
+
+// both do nothing when timing is null, so that call sites need not check
+void timing_begin(Timing *timing, const char *name, Buf *detail);
+void timing_end(Timing *timing);
+
+// for events such as individual declarations and functions, of which there
+// are too many to be worth recording unless a trace was asked for
+void timing_begin_detail(Timing *timing, const char *name, Buf *detail);
+void timing_end_detail(Timing *timing);
+
+void timing_print_report(Timing *timing, FILE *f);
+// writes the events in the Chrome trace event format
+int timing_write_trace(Timing *timing, Buf *path);
+
+#endif
@@ -12,6 +12,10 @@
 #include <stdlib.h>
 #include <stdio.h>
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
 #define WHITESPACE \
          ' ': \
     case '\n'
@@ -97,21 +101,126 @@
     ALPHA: \
     case '_'
 
-const char * zig_keywords[] = {
-    "true", "false", "null", "fn", "return", "var", "const", "extern",
-    "pub", "export", "import", "c_import", "if", "else", "goto", "asm",
-    "volatile", "struct", "enum", "while", "for", "continue", "break",
-    "null", "noalias", "switch", "undefined", "error", "type", "inline",
-    "defer",
-};
+// Keywords are found by switching on the length and then the first
+// character, so a symbol is compared against at most two keywords.
+static TokenId get_keyword_id(const char *mem, int len) {
+    switch (len) {
+        case 2:
+            switch (mem[0]) {
+                case 'f':
+                    if (memcmp(mem, "fn", 2) == 0) return TokenIdKeywordFn;
+                    break;
+                case 'i':
+                    if (memcmp(mem, "if", 2) == 0) return TokenIdKeywordIf;
+                    break;
+            }
+            break;
+        case 3:
+            switch (mem[0]) {
+                case 'a':
+                    if (memcmp(mem, "asm", 3) == 0) return TokenIdKeywordAsm;
+                    break;
+                case 'f':
+                    if (memcmp(mem, "for", 3) == 0) return TokenIdKeywordFor;
+                    break;
+                case 'p':
+                    if (memcmp(mem, "pub", 3) == 0) return TokenIdKeywordPub;
+                    break;
+                case 'v':
+                    if (memcmp(mem, "var", 3) == 0) return TokenIdKeywordVar;
+                    break;
+            }
+            break;
+        case 4:
+            switch (mem[0]) {
+                case 'e':
+                    if (memcmp(mem, "else", 4) == 0) return TokenIdKeywordElse;
+                    if (memcmp(mem, "enum", 4) == 0) return TokenIdKeywordEnum;
+                    break;
+                case 'g':
+                    if (memcmp(mem, "goto", 4) == 0) return TokenIdKeywordGoto;
+                    break;
+                case 'n':
+                    if (memcmp(mem, "null", 4) == 0) return TokenIdKeywordNull;
+                    break;
+                case 't':
+                    if (memcmp(mem, "true", 4) == 0) return TokenIdKeywordTrue;
+                    if (memcmp(mem, "type", 4) == 0) return TokenIdKeywordType;
+                    break;
+            }
+            break;
+        case 5:
+            switch (mem[0]) {
+                case 'b':
+                    if (memcmp(mem, "break", 5) == 0) return TokenIdKeywordBreak;
+                    break;
+                case 'c':
+                    if (memcmp(mem, "const", 5) == 0) return TokenIdKeywordConst;
+                    break;
+                case 'd':
+                    if (memcmp(mem, "defer", 5) == 0) return TokenIdKeywordDefer;
+                    break;
+                case 'e':
+                    if (memcmp(mem, "error", 5) == 0) return TokenIdKeywordError;
+                    break;
+                case 'f':
+                    if (memcmp(mem, "false", 5) == 0) return TokenIdKeywordFalse;
+                    break;
+                case 'w':
+                    if (memcmp(mem, "while", 5) == 0) return TokenIdKeywordWhile;
+                    break;
+            }
+            break;
+        case 6:
+            switch (mem[0]) {
+                case 'e':
+                    if (memcmp(mem, "extern", 6) == 0) return TokenIdKeywordExtern;
+                    if (memcmp(mem, "export", 6) == 0) return TokenIdKeywordExport;
+                    break;
+                case 'i':
+                    if (memcmp(mem, "import", 6) == 0) return TokenIdKeywordImport;
+                    if (memcmp(mem, "inline", 6) == 0) return TokenIdKeywordInline;
+                    break;
+                case 'r':
+                    if (memcmp(mem, "return", 6) == 0) return TokenIdKeywordReturn;
+                    break;
+                case 's':
+                    if (memcmp(mem, "struct", 6) == 0) return TokenIdKeywordStruct;
+                    if (memcmp(mem, "switch", 6) == 0) return TokenIdKeywordSwitch;
+                    break;
+            }
+            break;
+        case 7:
+            switch (mem[0]) {
+                case 'n':
+                    if (memcmp(mem, "noalias", 7) == 0) return TokenIdKeywordNoAlias;
+                    break;
+            }
+            break;
+        case 8:
+            switch (mem[0]) {
+                case 'c':
+                    if (memcmp(mem, "c_import", 8) == 0) return TokenIdKeywordCImport;
+                    if (memcmp(mem, "continue", 8) == 0) return TokenIdKeywordContinue;
+                    break;
+                case 'v':
+                    if (memcmp(mem, "volatile", 8) == 0) return TokenIdKeywordVolatile;
+                    break;
+            }
+            break;
+        case 9:
+            switch (mem[0]) {
+                case 'u':
+                    if (memcmp(mem, "undefined", 9) == 0) return TokenIdKeywordUndefined;
+                    break;
+            }
+            break;
+    }
+    return TokenIdSymbol;
+}
 
 bool is_zig_keyword(Buf *buf) {
-    for (int i = 0; i < array_length(zig_keywords); i += 1) {
-        if (buf_eql_str(buf, zig_keywords[i])) {
-            return true;
-        }
-    }
-    return false;
+    return get_keyword_id(buf_ptr(buf), buf_len(buf)) != TokenIdSymbol;
 }
 
 enum TokenizeState {
@@ -152,18 +261,151 @@ enum TokenizeState {
 };
 
 
+// The token which is currently being tokenized. end_token adds it to the
+// TokenList.
+struct Token {
+    TokenId id;
+    int start_pos;
+    int end_pos;
+    int start_line;
+    int start_column;
+
+    // for id == TokenIdNumberLiteral
+    int radix;
+    int decimal_point_pos;
+    int exponent_marker_pos;
+};
+
 struct Tokenize {
     Buf *buf;
     int pos;
     TokenizeState state;
-    ZigList<Token> *tokens;
+    TokenList *tokens;
     int line;
     int column;
+    // points to tok while a token is in progress, otherwise null
     Token *cur_tok;
+    Token tok;
     int multi_line_comment_count;
     Tokenization *out;
 };
 
+// The states below spend most of their time looking at bytes which don't
+// change the state. skip_bytes moves t->pos forward over such bytes, up to the
+// next byte that the state machine needs to see. Newlines that are skipped
+// are recorded in line_offsets here rather than one at a time in the main loop.
+enum SkipKind {
+    SkipKindWhitespace, // stop at anything but ' ' and '\n'
+    SkipKindSymbol, // stop at anything that is not a SYMBOL_CHAR
+    SkipKindLineComment, // stop at '\n'
+    SkipKindMultiLineComment, // stop at '*' or '/'
+    SkipKindString, // stop at '"'
+    SkipKindCharLiteral, // stop at '\''
+};
+
+static inline bool is_symbol_char(uint8_t c) {
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_';
+}
+
+static inline bool skip_stops_at(SkipKind kind, uint8_t c) {
+    switch (kind) {
+        case SkipKindWhitespace:
+            return c != ' ' && c != '\n';
+        case SkipKindSymbol:
+            return !is_symbol_char(c);
+        case SkipKindLineComment:
+            return c == '\n';
+        case SkipKindMultiLineComment:
+            return c == '*' || c == '/';
+        case SkipKindString:
+            return c == '"';
+        case SkipKindCharLiteral:
+            return c == '\'';
+    }
+    zig_unreachable();
+}
+
+#if defined(__SSE2__)
+// bit i is set if byte i of chunk is in [lo, hi]
+static inline int sse2_range_mask(__m128i chunk, char lo, char hi) {
+    __m128i offset = _mm_sub_epi8(chunk, _mm_set1_epi8(lo));
+    __m128i above = _mm_subs_epu8(offset, _mm_set1_epi8(hi - lo));
+    return _mm_movemask_epi8(_mm_cmpeq_epi8(above, _mm_setzero_si128()));
+}
+
+static inline int sse2_eq_mask(__m128i chunk, char c) {
+    return _mm_movemask_epi8(_mm_cmpeq_epi8(chunk, _mm_set1_epi8(c)));
+}
+
+static inline int sse2_stop_mask(SkipKind kind, __m128i chunk) {
+    switch (kind) {
+        case SkipKindWhitespace:
+            return ~(sse2_eq_mask(chunk, ' ') | sse2_eq_mask(chunk, '\n')) & 0xffff;
+        case SkipKindSymbol:
+            {
+                __m128i lower = _mm_or_si128(chunk, _mm_set1_epi8(0x20));
+                int symbol_mask = sse2_range_mask(lower, 'a', 'z') |
+                    sse2_range_mask(chunk, '0', '9') | sse2_eq_mask(chunk, '_');
+                return ~symbol_mask & 0xffff;
+            }
+        case SkipKindLineComment:
+            return sse2_eq_mask(chunk, '\n');
+        case SkipKindMultiLineComment:
+            return sse2_eq_mask(chunk, '*') | sse2_eq_mask(chunk, '/');
+        case SkipKindString:
+            return sse2_eq_mask(chunk, '"');
+        case SkipKindCharLiteral:
+            return sse2_eq_mask(chunk, '\'');
+    }
+    zig_unreachable();
+}
+#endif
+
+static void skip_bytes(Tokenize *t, SkipKind kind) {
+    const uint8_t *ptr = (const uint8_t *)buf_ptr(t->buf);
+    int end = buf_len(t->buf);
+    int pos = t->pos;
+    // position just after the last newline we skipped, or -1 if none
+    int line_start = -1;
+
+#if defined(__SSE2__)
+    while (pos + 16 <= end) {
+        __m128i chunk = _mm_loadu_si128((const __m128i *)(ptr + pos));
+        int stop_mask = sse2_stop_mask(kind, chunk);
+        int len = stop_mask ? __builtin_ctz(stop_mask) : 16;
+        int newline_mask = sse2_eq_mask(chunk, '\n') & ((1 << len) - 1);
+        while (newline_mask) {
+            int i = __builtin_ctz(newline_mask);
+            newline_mask &= newline_mask - 1;
+            line_start = pos + i + 1;
+            t->out->line_offsets->append(line_start);
+            t->line += 1;
+        }
+        pos += len;
+        if (stop_mask)
+            break;
+    }
+#endif
+
+    for (; pos < end; pos += 1) {
+        uint8_t c = ptr[pos];
+        if (skip_stops_at(kind, c))
+            break;
+        if (c == '\n') {
+            line_start = pos + 1;
+            t->out->line_offsets->append(line_start);
+            t->line += 1;
+        }
+    }
+
+    if (line_start == -1) {
+        t->column += pos - t->pos;
+    } else {
+        t->column = pos - line_start;
+    }
+    t->pos = pos;
+}
+
 __attribute__ ((format (printf, 2, 3)))
 static void tokenize_error(Tokenize *t, const char *format, ...) {
     t->state = TokenizeStateError;
@@ -184,8 +426,7 @@ static void tokenize_error(Tokenize *t, const char *format, ...) {
 
 static void begin_token(Tokenize *t, TokenId id) {
     assert(!t->cur_tok);
-    t->tokens->add_one();
-    Token *token = &t->tokens->last();
+    Token *token = &t->tok;
     token->start_line = t->line;
     token->start_column = t->column;
     token->id = id;
@@ -197,7 +438,6 @@ static void begin_token(Tokenize *t, TokenId id) {
 }
 
 static void cancel_token(Tokenize *t) {
-    t->tokens->pop();
     t->cur_tok = nullptr;
 }
 
@@ -218,66 +458,21 @@ static void end_token(Tokenize *t) {
     char *token_mem = buf_ptr(t->buf) + t->cur_tok->start_pos;
     int token_len = t->cur_tok->end_pos - t->cur_tok->start_pos;
 
-    if (mem_eql_str(token_mem, token_len, "fn")) {
-        t->cur_tok->id = TokenIdKeywordFn;
-    } else if (mem_eql_str(token_mem, token_len, "return")) {
-        t->cur_tok->id = TokenIdKeywordReturn;
-    } else if (mem_eql_str(token_mem, token_len, "var")) {
-        t->cur_tok->id = TokenIdKeywordVar;
-    } else if (mem_eql_str(token_mem, token_len, "const")) {
-        t->cur_tok->id = TokenIdKeywordConst;
-    } else if (mem_eql_str(token_mem, token_len, "extern")) {
-        t->cur_tok->id = TokenIdKeywordExtern;
-    } else if (mem_eql_str(token_mem, token_len, "pub")) {
-        t->cur_tok->id = TokenIdKeywordPub;
-    } else if (mem_eql_str(token_mem, token_len, "export")) {
-        t->cur_tok->id = TokenIdKeywordExport;
-    } else if (mem_eql_str(token_mem, token_len, "c_import")) {
-        t->cur_tok->id = TokenIdKeywordCImport;
-    } else if (mem_eql_str(token_mem, token_len, "import")) {
-        t->cur_tok->id = TokenIdKeywordImport;
-    } else if (mem_eql_str(token_mem, token_len, "true")) {
-        t->cur_tok->id = TokenIdKeywordTrue;
-    } else if (mem_eql_str(token_mem, token_len, "false")) {
-        t->cur_tok->id = TokenIdKeywordFalse;
-    } else if (mem_eql_str(token_mem, token_len, "if")) {
-        t->cur_tok->id = TokenIdKeywordIf;
-    } else if (mem_eql_str(token_mem, token_len, "else")) {
-        t->cur_tok->id = TokenIdKeywordElse;
-    } else if (mem_eql_str(token_mem, token_len, "goto")) {
-        t->cur_tok->id = TokenIdKeywordGoto;
-    } else if (mem_eql_str(token_mem, token_len, "volatile")) {
-        t->cur_tok->id = TokenIdKeywordVolatile;
-    } else if (mem_eql_str(token_mem, token_len, "asm")) {
-        t->cur_tok->id = TokenIdKeywordAsm;
-    } else if (mem_eql_str(token_mem, token_len, "struct")) {
-        t->cur_tok->id = TokenIdKeywordStruct;
-    } else if (mem_eql_str(token_mem, token_len, "enum")) {
-        t->cur_tok->id = TokenIdKeywordEnum;
-    } else if (mem_eql_str(token_mem, token_len, "for")) {
-        t->cur_tok->id = TokenIdKeywordFor;
-    } else if (mem_eql_str(token_mem, token_len, "while")) {
-        t->cur_tok->id = TokenIdKeywordWhile;
-    } else if (mem_eql_str(token_mem, token_len, "continue")) {
-        t->cur_tok->id = TokenIdKeywordContinue;
-    } else if (mem_eql_str(token_mem, token_len, "break")) {
-        t->cur_tok->id = TokenIdKeywordBreak;
-    } else if (mem_eql_str(token_mem, token_len, "null")) {
-        t->cur_tok->id = TokenIdKeywordNull;
-    } else if (mem_eql_str(token_mem, token_len, "noalias")) {
-        t->cur_tok->id = TokenIdKeywordNoAlias;
-    } else if (mem_eql_str(token_mem, token_len, "switch")) {
-        t->cur_tok->id = TokenIdKeywordSwitch;
-    } else if (mem_eql_str(token_mem, token_len, "undefined")) {
-        t->cur_tok->id = TokenIdKeywordUndefined;
-    } else if (mem_eql_str(token_mem, token_len, "error")) {
-        t->cur_tok->id = TokenIdKeywordError;
-    } else if (mem_eql_str(token_mem, token_len, "type")) {
-        t->cur_tok->id = TokenIdKeywordType;
-    } else if (mem_eql_str(token_mem, token_len, "inline")) {
-        t->cur_tok->id = TokenIdKeywordInline;
-    } else if (mem_eql_str(token_mem, token_len, "defer")) {
-        t->cur_tok->id = TokenIdKeywordDefer;
+    if (t->cur_tok->id == TokenIdSymbol) {
+        t->cur_tok->id = get_keyword_id(token_mem, token_len);
+    }
+
+    int token_index = token_count(t->tokens);
+    t->tokens->ids.append((uint8_t)t->cur_tok->id);
+    t->tokens->start_pos.append(t->cur_tok->start_pos);
+    t->tokens->end_pos.append(t->cur_tok->end_pos);
+    if (t->cur_tok->id == TokenIdNumberLiteral) {
+        t->tokens->num_lits.append({
+            token_index,
+            t->cur_tok->radix,
+            t->cur_tok->decimal_point_pos,
+            t->cur_tok->exponent_marker_pos,
+        });
     }
 
     t->cur_tok = nullptr;
@@ -307,13 +502,55 @@ int get_digit_value(uint8_t c) {
 void tokenize(Buf *buf, Tokenization *out) {
     Tokenize t = {0};
     t.out = out;
-    t.tokens = out->tokens = allocate<ZigList<Token>>(1);
+    t.tokens = out->tokens = allocate<TokenList>(1);
     t.buf = buf;
 
     out->line_offsets = allocate<ZigList<int>>(1);
+    t.tokens->line_offsets = out->line_offsets;
+
+    // Size the lists up front so that large files don't keep reallocating
+    // and copying them. Source code averages about 5 bytes per token; the
+    // estimate assumes 4 so that denser code rarely outgrows it.
+    int newline_count = 0;
+    const char *newline_ptr = buf_ptr(buf);
+    const char *buf_end = buf_ptr(buf) + buf_len(buf);
+    while ((newline_ptr = (const char *)memchr(newline_ptr, '\n', buf_end - newline_ptr))) {
+        newline_count += 1;
+        newline_ptr += 1;
+    }
+    out->line_offsets->reserve(newline_count + 1);
+    int token_estimate = buf_len(buf) / 4 + 1;
+    t.tokens->ids.reserve(token_estimate);
+    t.tokens->start_pos.reserve(token_estimate);
+    t.tokens->end_pos.reserve(token_estimate);
 
     out->line_offsets->append(0);
     for (t.pos = 0; t.pos < buf_len(t.buf); t.pos += 1) {
+        switch (t.state) {
+            case TokenizeStateStart:
+                skip_bytes(&t, SkipKindWhitespace);
+                break;
+            case TokenizeStateSymbol:
+                skip_bytes(&t, SkipKindSymbol);
+                break;
+            case TokenizeStateLineComment:
+                skip_bytes(&t, SkipKindLineComment);
+                break;
+            case TokenizeStateMultiLineComment:
+                skip_bytes(&t, SkipKindMultiLineComment);
+                break;
+            case TokenizeStateString:
+                skip_bytes(&t, SkipKindString);
+                break;
+            case TokenizeStateCharLiteral:
+                skip_bytes(&t, SkipKindCharLiteral);
+                break;
+            default:
+                break;
+        }
+        if (t.pos >= buf_len(t.buf))
+            break;
+
         uint8_t c = buf_ptr(t.buf)[t.pos];
         switch (t.state) {
             case TokenizeStateError:
@@ -1046,11 +1283,10 @@ void tokenize(Buf *buf, Tokenization *out) {
             break;
     }
     if (t.state != TokenizeStateError) {
-        if (t.tokens->length > 0) {
-            Token *last_token = &t.tokens->last();
-            t.line = last_token->start_line;
-            t.column = last_token->start_column;
-            t.pos = last_token->start_pos;
+        if (token_count(t.tokens) > 0) {
+            int last_token = token_count(t.tokens) - 1;
+            token_line_column(t.tokens, last_token, &t.line, &t.column);
+            t.pos = token_start_pos(t.tokens, last_token);
         } else {
             t.pos = 0;
         }
@@ -1155,17 +1391,54 @@ const char * token_name(TokenId id) {
     return "(invalid token)";
 }
 
-void print_tokens(Buf *buf, ZigList<Token> *tokens) {
-    for (int i = 0; i < tokens->length; i += 1) {
-        Token *token = &tokens->at(i);
-        fprintf(stderr, "%s ", token_name(token->id));
-        if (token->start_pos >= 0) {
-            fwrite(buf_ptr(buf) + token->start_pos, 1, token->end_pos - token->start_pos, stderr);
+void print_tokens(Buf *buf, TokenList *tokens) {
+    for (int i = 0; i < token_count(tokens); i += 1) {
+        int start_pos = token_start_pos(tokens, i);
+        int end_pos = token_end_pos(tokens, i);
+        fprintf(stderr, "%s ", token_name(token_id(tokens, i)));
+        if (start_pos >= 0) {
+            fwrite(buf_ptr(buf) + start_pos, 1, end_pos - start_pos, stderr);
         }
         fprintf(stderr, "\n");
     }
 }
 
+void token_line_column(TokenList *tokens, int index, int *out_line, int *out_column) {
+    // find the last line which starts at or before the token
+    int pos = token_start_pos(tokens, index);
+    ZigList<int> *line_offsets = tokens->line_offsets;
+    int lo = 0;
+    int hi = line_offsets->length - 1;
+    while (lo < hi) {
+        int mid = lo + (hi - lo + 1) / 2;
+        if (line_offsets->at(mid) <= pos) {
+            lo = mid;
+        } else {
+            hi = mid - 1;
+        }
+    }
+    *out_line = lo;
+    *out_column = pos - line_offsets->at(lo);
+}
+
+TokenNumLit *token_num_lit(TokenList *tokens, int index) {
+    assert(token_id(tokens, index) == TokenIdNumberLiteral);
+    int lo = 0;
+    int hi = tokens->num_lits.length - 1;
+    while (lo <= hi) {
+        int mid = lo + (hi - lo) / 2;
+        TokenNumLit *num_lit = &tokens->num_lits.at(mid);
+        if (num_lit->token_index == index) {
+            return num_lit;
+        } else if (num_lit->token_index < index) {
+            lo = mid + 1;
+        } else {
+            hi = mid - 1;
+        }
+    }
+    zig_unreachable();
+}
+
 bool valid_symbol_starter(uint8_t c) {
     switch (c) {
         case SYMBOL_START:
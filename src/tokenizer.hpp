@@ -102,21 +102,50 @@ enum TokenId {
     TokenIdPercentDot,
 };
 
-struct Token {
-    TokenId id;
-    int start_pos;
-    int end_pos;
-    int start_line;
-    int start_column;
-
-    // for id == TokenIdNumberLiteral
+// Only number literals need these, so they are kept in a side table rather
+// than in every token.
+struct TokenNumLit {
+    int token_index;
     int radix; // if != 10, then skip the first 2 characters
     int decimal_point_pos; // either exponent_marker_pos or the position of the '.'
     int exponent_marker_pos; // either end_pos or the position of the 'e'/'p'
 };
 
+// Tokens are stored as parallel arrays indexed by token index, so that
+// looking ahead at token ids touches one byte per token. The line and column
+// of a token are not stored; they are computed from line_offsets when needed,
+// which is only for error messages and AST node positions.
+struct TokenList {
+    ZigList<uint8_t> ids;
+    ZigList<int> start_pos;
+    ZigList<int> end_pos;
+    // sorted by token_index
+    ZigList<TokenNumLit> num_lits;
+    ZigList<int> *line_offsets;
+};
+
+static inline int token_count(TokenList *tokens) {
+    return tokens->ids.length;
+}
+
+static inline TokenId token_id(TokenList *tokens, int index) {
+    return (TokenId)tokens->ids.at(index);
+}
+
+static inline int token_start_pos(TokenList *tokens, int index) {
+    return tokens->start_pos.at(index);
+}
+
+static inline int token_end_pos(TokenList *tokens, int index) {
+    return tokens->end_pos.at(index);
+}
+
+// one search of the line table for both
+void token_line_column(TokenList *tokens, int index, int *out_line, int *out_column);
+TokenNumLit *token_num_lit(TokenList *tokens, int index);
+
 struct Tokenization {
-    ZigList<Token> *tokens;
+    TokenList *tokens;
     ZigList<int> *line_offsets;
 
     // if an error occurred
@@ -127,7 +156,7 @@ struct Tokenization {
 
 void tokenize(Buf *buf, Tokenization *out_tokenization);
 
-void print_tokens(Buf *buf, ZigList<Token> *tokens);
+void print_tokens(Buf *buf, TokenList *tokens);
 
 int get_digit_value(uint8_t c);
 
@@ -20,6 +20,37 @@ void zig_panic(const char *format, ...) {
     abort();
 }
 
+static const size_t arena_chunk_size = 64 * 1024;
+
+Arena *arena_create(void) {
+    return allocate<Arena>(1);
+}
+
+void *arena_alloc_slow(Arena *arena, size_t size, size_t align) {
+    size_t header_size = (sizeof(ArenaChunk) + align - 1) & ~(align - 1);
+    size_t chunk_size = max(arena_chunk_size, header_size + size);
+    // calloc rather than malloc so that large chunks come straight from
+    // zeroed pages and we don't have to clear anything ourselves
+    ArenaChunk *chunk = reinterpret_cast<ArenaChunk *>(calloc(1, chunk_size));
+    if (!chunk)
+        zig_panic("allocation failed");
+
+    char *chunk_end = (char *)chunk + chunk_size;
+    char *result = (char *)chunk + header_size;
+    if (chunk_size > arena_chunk_size && arena->chunk) {
+        // an oversized allocation; keep bumping in the current chunk
+        chunk->prev = arena->chunk->prev;
+        arena->chunk->prev = chunk;
+        return result;
+    }
+
+    chunk->prev = arena->chunk;
+    arena->chunk = chunk;
+    arena->ptr = result + size;
+    arena->end = chunk_end;
+    return result;
+}
+
 uint32_t int_hash(int i) {
     return (uint32_t)(i % UINT32_MAX);
 }
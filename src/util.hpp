@@ -52,6 +52,37 @@ static inline T *reallocate_nonzero(T * old, size_t new_count) {
     return ptr;
 }
 
+// Bump allocator for compiler objects which live until the process exits.
+// Memory comes from zeroed chunks, so like allocate<T> the result is zero
+// initialized, but there is no per-object malloc header and objects created
+// together end up next to each other in memory.
+struct ArenaChunk {
+    ArenaChunk *prev;
+};
+
+struct Arena {
+    ArenaChunk *chunk;
+    char *ptr;
+    char *end;
+};
+
+Arena *arena_create(void);
+void *arena_alloc_slow(Arena *arena, size_t size, size_t align);
+
+static inline void *arena_alloc_bytes(Arena *arena, size_t size, size_t align) {
+    uintptr_t addr = ((uintptr_t)arena->ptr + (align - 1)) & ~((uintptr_t)align - 1);
+    if (arena->ptr && addr + size <= (uintptr_t)arena->end) {
+        arena->ptr = (char *)(addr + size);
+        return (void *)addr;
+    }
+    return arena_alloc_slow(arena, size, align);
+}
+
+template<typename T>
+__attribute__((malloc)) static inline T *arena_allocate(Arena *arena, size_t count) {
+    return reinterpret_cast<T*>(arena_alloc_bytes(arena, count * sizeof(T), alignof(T)));
+}
+
 template <typename T, long n>
 constexpr long array_length(const T (&)[n]) {
     return n;
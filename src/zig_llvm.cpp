@@ -25,8 +25,11 @@
 #include <llvm/InitializePasses.h>
 #include <llvm/PassRegistry.h>
 #include <llvm/MC/SubtargetFeature.h>
+#include <llvm/Bitcode/ReaderWriter.h>
+#include <llvm/Object/SymbolicFile.h>
 #include <llvm/Support/raw_ostream.h>
 #include <llvm/Support/FileSystem.h>
+#include <llvm/Support/TargetRegistry.h>
 #include <llvm/Support/TargetParser.h>
 #include <llvm/Target/TargetMachine.h>
 #include <llvm/IR/LegacyPassManager.h>
@@ -41,6 +44,9 @@
 #include <llvm/Transforms/IPO.h>
 #include <llvm/Transforms/IPO/PassManagerBuilder.h>
 #include <llvm/Transforms/Scalar.h>
+#include <llvm/Transforms/Utils/Cloning.h>
+
+#include <thread>
 
 using namespace llvm;
 
@@ -78,6 +84,10 @@ static void addAddDiscriminatorsPass(const PassManagerBuilder &Builder, legacy::
 }
 
 
+void LLVMZigEnableTimePasses(void) {
+    TimePassesIsEnabled = true;
+}
+
 void LLVMZigOptimizeModule(LLVMTargetMachineRef targ_machine_ref, LLVMModuleRef module_ref) {
     TargetMachine* target_machine = reinterpret_cast<TargetMachine*>(targ_machine_ref);
     Module* module = unwrap(module_ref);
@@ -735,3 +745,164 @@ Buf *get_dynamic_linker(LLVMTargetMachineRef target_machine_ref) {
     }
 }
 
+#if defined(ZIG_HAVE_LLD)
+#include <lld/Driver/Driver.h>
+#endif
+
+bool ZigLLDIsAvailable(void) {
+#if defined(ZIG_HAVE_LLD)
+    return true;
+#else
+    return false;
+#endif
+}
+
+bool ZigLLDLinkELF(const char **args, int arg_count, Buf *out_diag) {
+#if defined(ZIG_HAVE_LLD)
+    std::vector<const char *> argv;
+    argv.push_back("ld.lld");
+    argv.insert(argv.end(), args, args + arg_count);
+
+    std::string diag;
+    raw_string_ostream diag_stream(diag);
+    bool ok = lld::GnuLdDriver::linkELF(argv, diag_stream);
+    diag_stream.flush();
+    buf_init_from_mem(out_diag, diag.data(), diag.size());
+    return ok;
+#else
+    buf_init_from_str(out_diag, "zig was built without LLD");
+    return false;
+#endif
+}
+
+bool ZigLLVMGetObjectSymbols(Buf *object, ZigList<Buf *> *out_symbols) {
+    MemoryBufferRef mem_buf(StringRef(buf_ptr(object), buf_len(object)), "");
+    ErrorOr<std::unique_ptr<object::SymbolicFile>> obj_or_err =
+        object::SymbolicFile::createSymbolicFile(mem_buf);
+    if (!obj_or_err)
+        return false;
+
+    for (const object::BasicSymbolRef &sym : (*obj_or_err)->symbols()) {
+        uint32_t flags = sym.getFlags();
+        if (!(flags & object::BasicSymbolRef::SF_Global) ||
+            (flags & object::BasicSymbolRef::SF_Undefined) ||
+            (flags & object::BasicSymbolRef::SF_FormatSpecific))
+        {
+            continue;
+        }
+        std::string name;
+        raw_string_ostream name_stream(name);
+        if (sym.printName(name_stream))
+            return false;
+        name_stream.flush();
+        out_symbols->append(buf_create_from_mem(name.data(), name.size()));
+    }
+    return true;
+}
+
+// So that a part can refer to what another part defines, the same as
+// SplitModule does in later versions of LLVM.
+static void externalize(GlobalValue *global_value) {
+    if (global_value->hasLocalLinkage()) {
+        global_value->setLinkage(GlobalValue::ExternalLinkage);
+        global_value->setVisibility(GlobalValue::HiddenVisibility);
+    }
+    if (!global_value->hasName()) {
+        global_value->setName("__zig_split_unnamed");
+    }
+}
+
+bool ZigLLVMEmitObjectsParallel(LLVMTargetMachineRef targ_machine_ref, LLVMModuleRef module_ref,
+        int part_count, bool optimize, ZigList<Buf *> *out_objects, Buf *out_err)
+{
+    TargetMachine *target_machine = reinterpret_cast<TargetMachine*>(targ_machine_ref);
+
+    std::unique_ptr<Module> module(CloneModule(unwrap(module_ref)));
+    for (Function &fn : *module) {
+        externalize(&fn);
+    }
+    for (GlobalVariable &global_var : module->globals()) {
+        externalize(&global_var);
+    }
+
+    // each part is a copy of the module with the definitions of the other
+    // parts turned into declarations. functions and global variables are
+    // dealt out in turn, in module order.
+    // an LLVMContext may only be used by one thread at a time, so the parts
+    // are handed to their threads as bitcode and read into new contexts
+    std::vector<SmallString<0>> bitcodes(part_count);
+    for (int part_index = 0; part_index < part_count; part_index += 1) {
+        std::unique_ptr<Module> part(CloneModule(module.get()));
+        int fn_index = 0;
+        for (Function &fn : *part) {
+            if (fn.isDeclaration())
+                continue;
+            if (fn_index % part_count != part_index) {
+                fn.deleteBody();
+                fn.setComdat(nullptr);
+            }
+            fn_index += 1;
+        }
+        int var_index = 0;
+        for (GlobalVariable &global_var : part->globals()) {
+            if (global_var.isDeclaration())
+                continue;
+            if (var_index % part_count != part_index) {
+                global_var.setInitializer(nullptr);
+                global_var.setLinkage(GlobalValue::ExternalLinkage);
+                global_var.setComdat(nullptr);
+            }
+            var_index += 1;
+        }
+
+        raw_svector_ostream bitcode_stream(bitcodes[part_index]);
+        WriteBitcodeToFile(part.get(), bitcode_stream);
+    }
+
+    std::vector<SmallString<0>> objects(bitcodes.size());
+    std::vector<std::string> errors(bitcodes.size());
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < bitcodes.size(); i += 1) {
+        threads.emplace_back([&, i]() {
+            LLVMContext context;
+            ErrorOr<std::unique_ptr<Module>> part_or_err =
+                parseBitcodeFile(MemoryBufferRef(bitcodes[i].str(), "split"), context);
+            if (!part_or_err) {
+                errors[i] = part_or_err.getError().message();
+                return;
+            }
+            Module *part = part_or_err->get();
+
+            // target machines are not safe to share between threads either
+            std::unique_ptr<TargetMachine> part_machine(target_machine->getTarget().createTargetMachine(
+                    part->getTargetTriple(), target_machine->getTargetCPU(),
+                    target_machine->getTargetFeatureString(), target_machine->Options,
+                    target_machine->getRelocationModel(), target_machine->getCodeModel(),
+                    target_machine->getOptLevel()));
+
+            if (optimize) {
+                LLVMZigOptimizeModule(reinterpret_cast<LLVMTargetMachineRef>(part_machine.get()), wrap(part));
+            }
+
+            raw_svector_ostream object_stream(objects[i]);
+            legacy::PassManager pass_manager;
+            if (part_machine->addPassesToEmitFile(pass_manager, object_stream, TargetMachine::CGFT_ObjectFile)) {
+                errors[i] = "target machine cannot emit object files";
+                return;
+            }
+            pass_manager.run(*part);
+        });
+    }
+    for (size_t i = 0; i < threads.size(); i += 1) {
+        threads[i].join();
+    }
+
+    for (size_t i = 0; i < objects.size(); i += 1) {
+        if (!errors[i].empty()) {
+            buf_init_from_mem(out_err, errors[i].data(), errors[i].size());
+            return false;
+        }
+        out_objects->append(buf_create_from_mem(objects[i].data(), objects[i].size()));
+    }
+    return true;
+}
@@ -35,6 +35,8 @@ char *LLVMZigGetHostCPUName(void);
 char *LLVMZigGetNativeFeatures(void);
 
 void LLVMZigOptimizeModule(LLVMTargetMachineRef targ_machine_ref, LLVMModuleRef module_ref);
+// LLVM prints the pass timings to stderr when LLVMShutdown is called
+void LLVMZigEnableTimePasses(void);
 
 LLVMValueRef LLVMZigBuildCall(LLVMBuilderRef B, LLVMValueRef Fn, LLVMValueRef *Args,
         unsigned NumArgs, unsigned CC, const char *Name);
@@ -307,4 +309,23 @@ void ZigLLVMGetTargetTriple(Buf *out_buf, ZigLLVM_ArchType arch_type, ZigLLVM_Su
 
 Buf *get_dynamic_linker(LLVMTargetMachineRef target_machine);
 
+// Links with LLD's ELF driver inside this process. args are what would be
+// passed to an external `ld`, not including argv[0]. On failure, returns
+// false with LLD's diagnostics in out_diag.
+bool ZigLLDIsAvailable(void);
+bool ZigLLDLinkELF(const char **args, int arg_count, Buf *out_diag);
+
+// Appends the names of the global symbols which the object file defines, as
+// needed for an archive's symbol index. Returns false if the object cannot be
+// read.
+template<typename T> struct ZigList;
+bool ZigLLVMGetObjectSymbols(Buf *object, ZigList<Buf *> *out_symbols);
+
+// Splits the module into part_count modules, each with its own LLVMContext,
+// then optimizes them if asked and emits them as objects on part_count
+// threads. The module itself is left unchanged. Objects are appended to
+// out_objects; on failure, returns false with the reason in out_err.
+bool ZigLLVMEmitObjectsParallel(LLVMTargetMachineRef targ_machine_ref, LLVMModuleRef module_ref,
+        int part_count, bool optimize, ZigList<Buf *> *out_objects, Buf *out_err);
+
 #endif
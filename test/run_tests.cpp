@@ -13,32 +13,57 @@
 #include <stdio.h>
 #include <stdarg.h>
 
+#if !defined(_WIN32)
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <sys/wait.h>
+#endif
+
 struct TestSourceFile {
     const char *relative_path;
     const char *source_code;
 };
 
+// a file the compile writes, which must contain the text
+struct TestExpectedFile {
+    const char *relative_path;
+    const char *text;
+};
+
 struct TestCase {
     const char *case_name;
     const char *output;
     ZigList<TestSourceFile> source_files;
     ZigList<const char *> compile_errors;
     ZigList<const char *> compiler_args;
+    // zig is run with these first, in the same directory, when the case
+    // needs something built before the compile it checks
+    ZigList<const char *> prepare_args;
     ZigList<const char *> program_args;
+    ZigList<TestExpectedFile> expected_files;
     bool is_parseh;
     bool is_self_hosted;
+    // set by batch_compile_tests, which leaves zig.stdout and zig.stderr in
+    // the case's directory
+    bool batch_compiled;
+    int batch_return_code;
 };
 
 static ZigList<TestCase*> test_cases = {0};
 static const char *tmp_source_path = ".tmp_source.zig";
 static const char *tmp_h_path = ".tmp_header.h";
+static const char *tmp_batch_path = ".tmp_batch";
 
 #if defined(_WIN32)
 static const char *tmp_exe_path = "./.tmp_exe.exe";
+static const char *tmp_prepare_exe_path = "./.tmp_prepare_exe.exe";
 static const char *zig_exe = "./zig.exe";
 #define NL "\r\n"
 #else
 static const char *tmp_exe_path = "./.tmp_exe";
+static const char *tmp_prepare_exe_path = "./.tmp_prepare_exe";
 static const char *zig_exe = "./zig";
 #define NL "\n"
 #endif
@@ -1116,6 +1141,154 @@ export fn main(args: c_int, argv: &&u8) -> c_int {
 
 
 
+    add_simple_case("c_import function using a typedef the zig code never names", R"SOURCE(
+#link("c")
+export executable "test";
+
+c_import {
+    @c_include("stdio.h");
+    @c_include("string.h");
+}
+
+export fn main(argc: c_int, argv: &&u8) -> c_int {
+    if (strncmp(c"abc", c"abd", 2) == 0) {
+        puts(c"equal");
+    }
+    return 0;
+}
+    )SOURCE", "equal" NL);
+
+    add_simple_case("c_import macros", R"SOURCE(
+#link("c")
+export executable "test";
+
+c_import {
+    @c_include("stdio.h");
+    @c_include("stdlib.h");
+}
+
+export fn main(argc: c_int, argv: &&u8) -> c_int {
+    if (EXIT_FAILURE != 1) {
+        abort();
+    }
+    puts(c"macro");
+    return EXIT_SUCCESS;
+}
+    )SOURCE", "macro" NL);
+
+    {
+        // the first build fills the cache; the one that's checked must
+        // still link the #link library from the cached link info
+        const char *source = R"SOURCE(
+#link("c")
+export executable "test";
+
+c_import {
+    @c_include("stdio.h");
+}
+
+export fn main(argc: c_int, argv: &&u8) -> c_int {
+    puts(c"cached");
+    return 0;
+}
+    )SOURCE";
+        TestCase *tc = add_simple_case("building the same code twice reuses the cache", source, "cached" NL);
+        tc->prepare_args.append("build");
+        tc->prepare_args.append(tmp_source_path);
+        tc->prepare_args.append("--export");
+        tc->prepare_args.append("exe");
+        tc->prepare_args.append("--name");
+        tc->prepare_args.append("test");
+        tc->prepare_args.append("--output");
+        tc->prepare_args.append(tmp_prepare_exe_path);
+        tc->prepare_args.append("--release");
+        tc->prepare_args.append("--strip");
+        tc->prepare_args.append("--cache");
+        tc->prepare_args.append("on");
+        tc->compiler_args.append("--cache");
+        tc->compiler_args.append("on");
+    }
+
+    {
+        // the library doesn't link libc, so it carries the builtin and
+        // compiler_rt objects itself
+        TestCase *tc = add_simple_case("link against a static library", R"SOURCE(
+#link("c")
+#link("mathtest")
+export executable "test";
+
+c_import {
+    @c_include("stdio.h");
+}
+
+extern fn add_three(x: i32) -> i32;
+
+export fn main(argc: c_int, argv: &&u8) -> c_int {
+    if (add_three(39) == 42) {
+        puts(c"static lib");
+    }
+    return 0;
+}
+    )SOURCE", "static lib" NL);
+
+        add_source_file(tc, ".tmp_lib.zig", R"SOURCE(
+export library "mathtest";
+
+export fn add_three(x: i32) -> i32 {
+    x + 3
+}
+        )SOURCE");
+
+        tc->prepare_args.append("build");
+        tc->prepare_args.append(".tmp_lib.zig");
+        tc->prepare_args.append("--export");
+        tc->prepare_args.append("lib");
+        tc->prepare_args.append("--static");
+        tc->prepare_args.append("--release");
+        tc->prepare_args.append("--strip");
+        tc->compiler_args.append("--library-path");
+        tc->compiler_args.append(".");
+    }
+
+    {
+        // functions are handed out to the parts in turn, so these calls and
+        // the uses of the file-local global cross from one part to the other
+        TestCase *tc = add_simple_case("optimized in two parts", R"SOURCE(
+#link("c")
+export executable "test";
+
+c_import {
+    @c_include("stdio.h");
+}
+
+var counter: i32 = 0;
+
+fn bump(n: i32) {
+    counter += n;
+}
+
+fn bump_twice(n: i32) {
+    bump(n);
+    bump(n);
+}
+
+fn get_counter() -> i32 {
+    counter
+}
+
+export fn main(argc: c_int, argv: &&u8) -> c_int {
+    bump_twice(20);
+    bump(2);
+    if (get_counter() == 42) {
+        puts(c"parts");
+    }
+    return 0;
+}
+    )SOURCE", "parts" NL);
+        tc->compiler_args.append("--codegen-threads");
+        tc->compiler_args.append("2");
+    }
+
     add_simple_case("casting between float and integer types", R"SOURCE(
 #link("c")
 export executable "test";
@@ -1941,6 +2114,25 @@ extern void (*fn_ptr)(void);
     add_parseh_case("__cdecl doesn't mess up function pointers", R"SOURCE(
 void foo(void (__cdecl *fn_ptr)(void));
     )SOURCE", 1, "pub extern fn foo(fn_ptr: ?extern fn());");
+
+    {
+        TestCase *tc = add_parseh_case("parseh-batch writes each header's output", R"SOURCE(
+int foo(int a);
+    )SOURCE", 0);
+        add_source_file(tc, ".tmp_header_2.h", R"SOURCE(
+#define BAR 1234
+    )SOURCE");
+        add_source_file(tc, ".tmp_parseh_batch", ".tmp_header.h .tmp_header.zig\n.tmp_header_2.h .tmp_header_2.zig\n");
+
+        tc->compiler_args.clear();
+        tc->compiler_args.append("parseh-batch");
+        tc->compiler_args.append(".tmp_parseh_batch");
+        tc->compiler_args.append("-j");
+        tc->compiler_args.append("2");
+
+        tc->expected_files.append({".tmp_header.zig", "pub extern fn foo(a: c_int) -> c_int;"});
+        tc->expected_files.append({".tmp_header_2.zig", "pub const BAR = 1234;"});
+    }
 }
 
 static void run_self_hosted_test(void) {
@@ -1975,24 +2167,58 @@ static void print_compiler_invocation(TestCase *test_case) {
     printf("\n");
 }
 
+static void run_prepare(TestCase *test_case) {
+    Buf zig_stderr = BUF_INIT;
+    Buf zig_stdout = BUF_INIT;
+    int return_code;
+    int err;
+    if ((err = os_exec_process(zig_exe, test_case->prepare_args, &return_code, &zig_stderr, &zig_stdout))) {
+        fprintf(stderr, "Unable to exec %s: %s\n", zig_exe, err_str(err));
+        exit(1);
+    }
+    if (return_code != 0) {
+        printf("\nPreparing the case failed with return code %d:\n", return_code);
+        printf("%s", zig_exe);
+        for (int i = 0; i < test_case->prepare_args.length; i += 1) {
+            printf(" %s", test_case->prepare_args.at(i));
+        }
+        printf("\n%s\n", buf_ptr(&zig_stderr));
+        exit(1);
+    }
+}
+
 static void run_test(TestCase *test_case) {
     if (test_case->is_self_hosted) {
         return run_self_hosted_test();
     }
 
-    for (int i = 0; i < test_case->source_files.length; i += 1) {
-        TestSourceFile *test_source = &test_case->source_files.at(i);
-        os_write_file(
-                buf_create_from_str(test_source->relative_path),
-                buf_create_from_str(test_source->source_code));
-    }
-
     Buf zig_stderr = BUF_INIT;
     Buf zig_stdout = BUF_INIT;
     int return_code;
     int err;
-    if ((err = os_exec_process(zig_exe, test_case->compiler_args, &return_code, &zig_stderr, &zig_stdout))) {
-        fprintf(stderr, "Unable to exec %s: %s\n", zig_exe, err_str(err));
+    if (test_case->batch_compiled) {
+        return_code = test_case->batch_return_code;
+        if ((err = os_fetch_file_path(buf_create_from_str("zig.stderr"), &zig_stderr)) ||
+            (err = os_fetch_file_path(buf_create_from_str("zig.stdout"), &zig_stdout)))
+        {
+            fprintf(stderr, "Unable to read zig output: %s\n", err_str(err));
+            exit(1);
+        }
+    } else {
+        for (int i = 0; i < test_case->source_files.length; i += 1) {
+            TestSourceFile *test_source = &test_case->source_files.at(i);
+            os_write_file(
+                    buf_create_from_str(test_source->relative_path),
+                    buf_create_from_str(test_source->source_code));
+        }
+
+        if (test_case->prepare_args.length) {
+            run_prepare(test_case);
+        }
+
+        if ((err = os_exec_process(zig_exe, test_case->compiler_args, &return_code, &zig_stderr, &zig_stdout))) {
+            fprintf(stderr, "Unable to exec %s: %s\n", zig_exe, err_str(err));
+        }
     }
 
     if (!test_case->is_parseh && test_case->compile_errors.length) {
@@ -2046,6 +2272,27 @@ static void run_test(TestCase *test_case) {
                 exit(1);
             }
         }
+
+        for (int i = 0; i < test_case->expected_files.length; i += 1) {
+            TestExpectedFile *expected = &test_case->expected_files.at(i);
+            Buf contents = BUF_INIT;
+            if ((err = os_fetch_file_path(buf_create_from_str(expected->relative_path), &contents))) {
+                printf("\nUnable to read %s: %s\n", expected->relative_path, err_str(err));
+                print_compiler_invocation(test_case);
+                exit(1);
+            }
+            if (!strstr(buf_ptr(&contents), expected->text)) {
+                printf("\n");
+                printf("========= Expected %s to contain: =========\n", expected->relative_path);
+                printf("%s\n", expected->text);
+                printf("================================================\n");
+                print_compiler_invocation(test_case);
+                printf("%s\n", buf_ptr(&contents));
+                exit(1);
+            }
+            buf_deinit(&contents);
+            remove(expected->relative_path);
+        }
     } else {
         Buf program_stderr = BUF_INIT;
         Buf program_stdout = BUF_INIT;
@@ -2105,22 +2352,238 @@ static void run_all_tests(bool reverse) {
     printf("%d tests passed.\n", test_cases.length);
 }
 
+#if !defined(_WIN32)
+// Each case runs in a child process of our own, inside its own temporary
+// directory, so that the fixed file names above don't collide and the
+// .o files zig leaves in the current directory stay separate.
+struct TestJob {
+    pid_t pid;
+    bool done;
+    int status;
+    Buf *dir;
+    Buf *log_path;
+};
+
+static Buf *test_case_dir(int index) {
+    return buf_sprintf(".tmp_test_%d", index);
+}
+
+static void remove_tmp_dir(Buf *dir) {
+    DIR *d = opendir(buf_ptr(dir));
+    if (!d)
+        return;
+    struct dirent *entry;
+    while ((entry = readdir(d))) {
+        if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0)
+            continue;
+        Buf path = BUF_INIT;
+        os_path_join(dir, buf_create_from_str(entry->d_name), &path);
+        remove(buf_ptr(&path));
+        buf_deinit(&path);
+    }
+    closedir(d);
+    rmdir(buf_ptr(dir));
+}
+
+static void start_test_job(TestCase *test_case, TestJob *job) {
+    int err;
+    if ((err = os_make_path(job->dir))) {
+        fprintf(stderr, "Unable to create %s: %s\n", buf_ptr(job->dir), err_str(err));
+        exit(1);
+    }
+
+    fflush(stdout);
+    fflush(stderr);
+    job->pid = fork();
+    if (job->pid == -1) {
+        fprintf(stderr, "fork failed: %s\n", strerror(errno));
+        exit(1);
+    }
+    if (job->pid != 0)
+        return;
+
+    // child: everything run_test prints goes to the log, which the parent
+    // shows if the case fails
+    int log_fd = open(buf_ptr(job->log_path), O_WRONLY|O_CREAT|O_TRUNC, 0644);
+    if (log_fd == -1 || dup2(log_fd, STDOUT_FILENO) == -1 || dup2(log_fd, STDERR_FILENO) == -1)
+        _exit(1);
+    close(log_fd);
+
+    // the self hosted test refers to ../test, relative to the build directory
+    if (!test_case->is_self_hosted && chdir(buf_ptr(job->dir)) == -1)
+        _exit(1);
+
+    run_test(test_case);
+    fflush(stdout);
+    _exit(0);
+}
+
+// Compiles every case up front with a single `zig batch`, which forks its
+// compilations from one process instead of starting zig from scratch for
+// each case. run_test then only checks the output and runs the programs.
+// Cases with prepare_args are left for run_test to compile.
+static bool can_batch_compile(TestCase *test_case) {
+    return !test_case->is_self_hosted && test_case->prepare_args.length == 0;
+}
+
+static void batch_compile_tests(int job_count) {
+    Buf manifest = BUF_INIT;
+    buf_resize(&manifest, 0);
+    for (int i = 0; i < test_cases.length; i += 1) {
+        TestCase *test_case = test_cases.at(i);
+        if (!can_batch_compile(test_case))
+            continue;
+
+        Buf *dir = test_case_dir(i);
+        int err;
+        if ((err = os_make_path(dir))) {
+            fprintf(stderr, "Unable to create %s: %s\n", buf_ptr(dir), err_str(err));
+            exit(1);
+        }
+        for (int file_i = 0; file_i < test_case->source_files.length; file_i += 1) {
+            TestSourceFile *test_source = &test_case->source_files.at(file_i);
+            Buf path = BUF_INIT;
+            os_path_join(dir, buf_create_from_str(test_source->relative_path), &path);
+            os_write_file(&path, buf_create_from_str(test_source->source_code));
+        }
+
+        buf_append_buf(&manifest, dir);
+        for (int arg_i = 0; arg_i < test_case->compiler_args.length; arg_i += 1) {
+            buf_appendf(&manifest, " %s", test_case->compiler_args.at(arg_i));
+        }
+        buf_append_char(&manifest, '\n');
+    }
+    os_write_file(buf_create_from_str(tmp_batch_path), &manifest);
+
+    ZigList<const char *> args = {0};
+    args.append("batch");
+    args.append(tmp_batch_path);
+    args.append("-j");
+    args.append(buf_ptr(buf_sprintf("%d", job_count)));
+    Buf zig_stderr = BUF_INIT;
+    Buf zig_stdout = BUF_INIT;
+    int return_code;
+    int err;
+    if ((err = os_exec_process(zig_exe, args, &return_code, &zig_stderr, &zig_stdout))) {
+        fprintf(stderr, "Unable to exec %s: %s\n", zig_exe, err_str(err));
+        exit(1);
+    }
+    if (return_code != 0) {
+        printf("\nzig batch failed with return code %d:\n", return_code);
+        printf("%s\n", buf_ptr(&zig_stderr));
+        exit(1);
+    }
+
+    // one line per case, in the order of the batch file
+    char *line = buf_ptr(&zig_stdout);
+    for (int i = 0; i < test_cases.length; i += 1) {
+        TestCase *test_case = test_cases.at(i);
+        if (!can_batch_compile(test_case))
+            continue;
+        if (!line || sscanf(line, "%*s %d", &test_case->batch_return_code) != 1) {
+            printf("\nUnexpected output from zig batch:\n%s\n", buf_ptr(&zig_stdout));
+            exit(1);
+        }
+        test_case->batch_compiled = true;
+        line = strchr(line, '\n');
+        if (line)
+            line += 1;
+    }
+}
+
+static void run_all_tests_parallel(bool reverse, int job_count) {
+    TestJob *jobs = allocate<TestJob>(test_cases.length);
+    for (int i = 0; i < test_cases.length; i += 1) {
+        jobs[i].dir = test_case_dir(i);
+        jobs[i].log_path = buf_sprintf(".tmp_test_%d/log", i);
+    }
+
+    // the same order run_all_tests uses
+    ZigList<int> order = {0};
+    for (int i = 0; i < test_cases.length; i += 1) {
+        order.append(reverse ? (test_cases.length - 1 - i) : i);
+    }
+
+    int next_start = 0;
+    int next_report = 0;
+    int running = 0;
+    bool failed = false;
+    while (next_report < order.length) {
+        while (!failed && running < job_count && next_start < order.length) {
+            int i = order.at(next_start);
+            start_test_job(test_cases.at(i), &jobs[i]);
+            next_start += 1;
+            running += 1;
+        }
+
+        int status;
+        pid_t pid = waitpid(-1, &status, 0);
+        if (pid == -1) {
+            if (errno == EINTR)
+                continue;
+            fprintf(stderr, "waitpid failed: %s\n", strerror(errno));
+            exit(1);
+        }
+        running -= 1;
+        for (int i = 0; i < test_cases.length; i += 1) {
+            if (jobs[i].pid == pid) {
+                jobs[i].done = true;
+                jobs[i].status = status;
+                break;
+            }
+        }
+
+        // report finished cases in order, so that the output is the same
+        // no matter which jobs finish first
+        while (!failed && next_report < order.length && jobs[order.at(next_report)].done) {
+            int i = order.at(next_report);
+            TestJob *job = &jobs[i];
+            printf("Test %d/%d %s...", i + 1, test_cases.length, test_cases.at(i)->case_name);
+            if (WIFEXITED(job->status) && WEXITSTATUS(job->status) == 0) {
+                printf("OK\n");
+                remove_tmp_dir(job->dir);
+                next_report += 1;
+            } else {
+                Buf log = BUF_INIT;
+                if (os_fetch_file_path(job->log_path, &log) == 0)
+                    fwrite(buf_ptr(&log), 1, buf_len(&log), stdout);
+                failed = true;
+            }
+        }
+        if (failed && running == 0)
+            exit(1);
+    }
+    printf("%d tests passed.\n", test_cases.length);
+}
+#endif
+
 static void cleanup(void) {
     remove(tmp_source_path);
     remove(tmp_h_path);
     remove(tmp_exe_path);
+    remove(tmp_prepare_exe_path);
+    remove(tmp_batch_path);
 }
 
 static int usage(const char *arg0) {
-    fprintf(stderr, "Usage: %s [--reverse]\n", arg0);
+    fprintf(stderr, "Usage: %s [--reverse] [-j N] [--batch]\n", arg0);
     return 1;
 }
 
 int main(int argc, char **argv) {
     bool reverse = false;
+    int job_count = 1;
+    bool batch = false;
     for (int i = 1; i < argc; i += 1) {
         if (strcmp(argv[i], "--reverse") == 0) {
             reverse = true;
+        } else if (strcmp(argv[i], "--batch") == 0) {
+            batch = true;
+        } else if (strcmp(argv[i], "-j") == 0 && i + 1 < argc) {
+            i += 1;
+            job_count = atoi(argv[i]);
+            if (job_count < 1)
+                return usage(argv[0]);
         } else {
             return usage(argv[0]);
         }
@@ -2129,6 +2592,25 @@ int main(int argc, char **argv) {
     add_compile_failure_test_cases();
     add_parseh_test_cases();
     add_self_hosted_tests();
-    run_all_tests(reverse);
+    if (job_count > 1 || batch) {
+#if defined(_WIN32)
+        fprintf(stderr, "-j and --batch are not supported on Windows\n");
+        return 1;
+#else
+        // the jobs run in their own directories
+        Buf *abs_zig_exe = buf_alloc();
+        int err;
+        if ((err = os_path_real(buf_create_from_str(zig_exe), abs_zig_exe))) {
+            fprintf(stderr, "Unable to find %s: %s\n", zig_exe, err_str(err));
+            return 1;
+        }
+        zig_exe = buf_ptr(abs_zig_exe);
+        if (batch)
+            batch_compile_tests(job_count);
+        run_all_tests_parallel(reverse, job_count);
+#endif
+    } else {
+        run_all_tests(reverse);
+    }
     cleanup();
 }